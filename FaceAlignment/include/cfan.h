@@ -31,6 +31,7 @@
  
 #pragma once
 #include <cmath>
+#include <string>
 #include "sift.h"
 #include "common.h"
 
@@ -61,38 +62,191 @@ class CCFAN{
     */
   void FacialPointLocate(const unsigned char *gray_im, int im_width, int im_height, seeta::FaceInfo face_loc, float *facial_loc);
 
- private:
-  /** Extract shape indexed SIFT features.
+  /** Detect five facial landmarks of a batch of faces, running each layer of the
+    *  networks on the features of all faces at once.
+    *  @param gray_im A grayscale image
+    *  @param im_width The width of the inpute image
+    *  @param im_height The height of the inpute image
+    *  @param face_loc The face bounding boxes
+    *  @param face_num The number of faces, at most kMaxBatchSize
+    *  @param[out] facial_loc The locations of detected facial points, ten values per face
+    */
+  void FacialPointLocate(const unsigned char *gray_im, int im_width, int im_height, const seeta::FaceInfo *face_loc, int face_num, float *facial_loc);
+
+  /** Track five facial landmarks in a video, refining the shape of the track in the
+    *  face image of the second network with that network only, unless the points have
+    *  been tracked for too many frames or the drift shows that the face moved too much
+    *  for it, in which case they are detected again with both networks.
     *  @param gray_im A grayscale image
     *  @param im_width The width of the inpute image
     *  @param im_height The height of the inpute image
-    *  @param face_shape The locations of facial points
+    *  @param face_loc The face bounding box in the current frame
+    *  @param[in,out] track_shape The shape the second network starts from, in its face
+    *                 image, i.e. the estimate of the first network when the points were
+    *                 last detected, moved along with the face since
+    *  @param[in,out] track_offset The displacements of the points by the second network
+    *                 when they were last detected
+    *  @param[in,out] track_frames The number of frames the points have been tracked
+    *                 since they were last detected with both networks, negative if they
+    *                 never were; reset to 0 when they are detected again
+    *  @param[out] facial_loc The locations of detected facial points
+    *  @return The drift, i.e. the root mean square of the changes of the displacements
+    *          of the points by the second network since they were last detected,
+    *          relative to the size of its face image; 0 if the second network did not
+    *          start from the shape of the track
+    */
+  float FacialPointTrack(const unsigned char *gray_im, int im_width, int im_height, seeta::FaceInfo face_loc, float *track_shape, float *track_offset, int *track_frames, float *facial_loc);
+
+  /** Set the number of networks run by FacialPointLocate: 1 returns the estimate of the
+    *  first network, 2 (the default) refines it with the second network.
+    *  @param level The refinement level, 1 or 2
+    */
+  void SetRefinementLevel(int level) { refinement_level_ = level; }
+
+  /*The maximum number of faces in one batch, which bounds the workspace*/
+  static const int kMaxBatchSize = 16;
+
+  /*The stages timed when cfan.cpp is built with FA_PROFILE (by fa_bench), followed by
+    the layers of the two networks, one stage each. The times stay zero otherwise; the
+    class is the same either way*/
+  enum ProfileStage
+  {
+    kProfileRegion,  /*Computing the extended face regions*/
+    kProfileSample,  /*Sampling the patches from the image*/
+    kProfileSift,    /*The SIFT features of the patches*/
+    kProfileMap,     /*Mapping the points back to the image*/
+    kProfileLayer
+  };
+  static const int kMaxProfileStage = 16;
+
+  /** The number of stages timed, including the layers. */
+  int ProfileStageNum() const;
+
+  /** The name of a stage. */
+  std::string ProfileStageName(int stage) const;
+
+  /** The time in microseconds spent in each stage since the last ResetProfile. */
+  const double *ProfileTime() const { return profile_time_; }
+
+  /** Reset the times of the stages to zero. */
+  void ResetProfile();
+
+ private:
+  /** Extract shape indexed SIFT features, on patches sampled from the face image, i.e.
+    *  the face region of the image resized to face_size x face_size.
+    *  @param gray_im A grayscale image
+    *  @param im_width The width of the inpute image
+    *  @param face_region The extended face region (x, y, width, height) in the image
+    *  @param face_size The size of the face image the region is resized to
+    *  @param face_shape The locations of facial points in the face image
     *  @param patch_size The size of the patch used for extracting SIFT feature
     *  @param[out] sift_fea the extracted shape indexed SIFT features which are concatenated into a vector
     */
-  void TtSift(const unsigned char *gray_im, int im_width, int im_height, float *face_shape, int patch_size, double *sift_fea);
-
-  /** Extract a image patch which is centered at point(point_x, point_y) with a given patch size.
-  *  @param gray_im A grayscale image
-  *  @param im_width The width of the inpute image
-  *  @param im_height The height of the inpute image
-  *  @param point_x The X coordinate of one point
-  *  @param point_y The Y coordinate of one point
-  *  @param patch_size The size of the extracted patch
-  *  @param[out] sub_img A grayscale image patch
-  */
-  void GetSubImg(const unsigned char *gray_im, int im_width, int im_height, float point_x, float point_y, int patch_size, BYTE *sub_img);
-
-  /** Resize the image by bilinear interpolation.
-    *  @param src_im A source image in grayscale
-    *  @param src_width The width of the source image
-    *  @param src_height The height of the source image
-    *  @param[out] dst_im The target image in grayscale
-    *  @param dst_width The width of the target image
-    *  @param dst_height The height of the target image
-    */
-  bool ResizeImage(const unsigned char *src_im, int src_width, int src_height,
-    unsigned char* dst_im, int dst_width, int dst_height);
+  void TtSift(const unsigned char *gray_im, int im_width, const int *face_region, int face_size, float *face_shape, int patch_size, float *sift_fea);
+
+  /** Detect five facial landmarks of a batch of faces with the given number of networks.
+    *  @param gray_im A grayscale image
+    *  @param im_width The width of the inpute image
+    *  @param im_height The height of the inpute image
+    *  @param face_loc The face bounding boxes
+    *  @param face_num The number of faces, at most kMaxBatchSize
+    *  @param level The number of networks run, 1 or 2
+    *  @param[out] facial_loc The locations of detected facial points, ten values per face
+    */
+  void LocateLandmarks(const unsigned char *gray_im, int im_width, int im_height, const seeta::FaceInfo *face_loc, int face_num, int level, float *facial_loc);
+
+  /** Estimate the shapes of a batch of faces with the first local stacked autoencoder
+    *  network.
+    *  @param gray_im A grayscale image
+    *  @param im_width The width of the inpute image
+    *  @param im_height The height of the inpute image
+    *  @param face_loc The face bounding boxes, whose regions are stored in face_region_
+    *  @param face_num The number of faces, at most kMaxBatchSize
+    *  @param level The number of networks run, 1 or 2
+    *  @param[out] facial_loc The locations of facial points, in the image at level 1 and
+    *              in the face image of the second network at level 2
+    */
+  void LocateFirstStage(const unsigned char *gray_im, int im_width, int im_height, const seeta::FaceInfo *face_loc, int face_num, int level, float *facial_loc);
+
+  /** Compute the extended region of a detected face, in which the landmarks are located.
+    *  @param face_loc The face bounding box
+    *  @param im_width The width of the inpute image
+    *  @param im_height The height of the inpute image
+    *  @param[out] face_region The extended face region (x, y, width, height), inside the image
+    *  @return Whether the region was clipped by the image border
+    */
+  bool GetFaceRegion(const seeta::FaceInfo &face_loc, int im_width, int im_height, int *face_region);
+
+  /** Refine the shapes of a batch of faces with the second local stacked autoencoder
+    *  network, and map them back to the image.
+    *  @param gray_im A grayscale image
+    *  @param im_width The width of the inpute image
+    *  @param face_num The number of faces, whose regions are in face_region_
+    *  @param[in,out] facial_loc The locations of facial points, in the face image of
+    *                 the second network on input and in the image on output
+    */
+  void LocateSecondStage(const unsigned char *gray_im, int im_width, int face_num, float *facial_loc);
+
+  /** Map the locations of facial points from a face image back to the image.
+    *  @param face_region The extended face region (x, y, width, height) in the image
+    *  @param face_size The size of the face image the region is resized to
+    *  @param[in,out] face_shape The locations of facial points
+    */
+  void MapToImage(const int *face_region, int face_size, float *face_shape);
+
+  /** Extract the shape indexed SIFT features of a face as the input of a network, with
+    *  NaN replaced by 0. The features of the points are concatenated, as the weights of
+    *  the first layers are reordered accordingly by LoadNetwork.
+    *  @param gray_im A grayscale image
+    *  @param im_width The width of the inpute image
+    *  @param face_region The extended face region (x, y, width, height) in the image
+    *  @param face_size The size of the face image the region is resized to
+    *  @param face_shape The locations of facial points in the face image
+    *  @param[out] fea The input of the network
+    */
+  void GetShapeIndexedFeature(const unsigned char *gray_im, int im_width, const int *face_region, int face_size, float *face_shape, float *fea);
+
+  /** Load the parameters of a local stacked autoencoder network, packing the weights
+    *  of each layer into panels of outputs interleaved along the inputs.
+    *  @param fp The model file
+    *  @param[out] size The number of layers
+    *  @param[out] structure The number of units of each layer
+    *  @param[out] w The packed weights of the layers
+    *  @param[out] b The padded biases of the layers
+    */
+  void LoadNetwork(FILE *fp, int *size, int **structure, float ***w, float ***b);
+
+  /** Run a local stacked autoencoder network on a batch of faces, layer by layer.
+    *  @param w The weights of the layers
+    *  @param b The biases of the layers
+    *  @param structure The number of units of each layer
+    *  @param size The number of layers
+    *  @param[in,out] a The units of each layer, one row per face padded to the panel
+    *                   width, with the input in a[0]
+    *  @param face_num The number of faces
+    */
+  void ForwardNetwork(float **w, float **b, const int *structure, int size, float **a, int face_num);
+
+  /** Make the workspace of FacialPointLocate large enough for a batch of faces.
+    *  @param face_num The number of faces
+    */
+  void ReserveBatch(int face_num);
+
+  /** Sample a rectangle of the face image, i.e. the face region of the image resized
+    *  to face_size x face_size by bilinear interpolation, with the pixels outside the
+    *  face image being 128. Only the pixels of the rectangle are interpolated.
+    *  @param gray_im A grayscale image
+    *  @param im_width The width of the inpute image
+    *  @param face_region The face region (x, y, width, height) in the image
+    *  @param face_size The size of the face image
+    *  @param x The X coordinate of the top left corner of the rectangle in the face image
+    *  @param y The Y coordinate of the top left corner of the rectangle in the face image
+    *  @param width The width of the rectangle
+    *  @param height The height of the rectangle
+    *  @param[out] dst_im The sampled rectangle in grayscale
+    */
+  void SampleFace(const unsigned char *gray_im, int im_width, const int *face_region, int face_size,
+    int x, int y, int width, int height, BYTE *dst_im);
 
  private:
   /*The number of facial points*/
@@ -102,7 +256,8 @@ class CCFAN{
   /*The mean face shape containing five landmarks*/
   float *mean_shape_;
 
-  /*The parameters of the first local stacked autoencoder network*/
+  /*The parameters of the first local stacked autoencoder network, with the weights
+    packed by LoadNetwork*/
   float **lan1_w_;
   float **lan1_b_;
   int *lan1_structure_;
@@ -114,5 +269,23 @@ class CCFAN{
   int *lan2_structure_;
   int lan2_size_;
 
+  /*The sizes of the face patches for the two networks and of the SIFT patches*/
+  int lan1_patch_size_;
+  int lan2_patch_size_;
+  int sift_patch_size_;
+
+  /*The workspace of FacialPointLocate, allocated by InitModel from the model
+    structure. The face regions and units (one row per face) grow with the batch size*/
+  SIFT sift_extractor_;
+  BYTE *sub_img_;
+  int *sample_x_;         /*The source columns of SampleFace and their weights*/
+  double *sample_wx_;
+  int refinement_level_;
+  int batch_capacity_;
+  int *face_region_;      /*The extended region (x, y, width, height) of each face*/
+  float **lan1_a_;
+  float **lan2_a_;
+
+  double profile_time_[kMaxProfileStage];
 };
 
@@ -33,10 +33,21 @@
 #define SEETA_FACE_ALIGNMENT_H_
 
 #include <cstdlib>
+#include <vector>
 #include "common.h"
 class CCFAN;
 
 namespace seeta {
+/** The landmarks of a face tracked in a video by FaceAlignment::TrackLandmarks. */
+typedef struct LandmarkTrack {
+  LandmarkTrack() : frames(-1) {}
+
+  FacialLandmark points[5];  /*The landmarks of the face in the last frame*/
+  float shape[10];  /*The shape the second network starts from, in its face image*/
+  float offset[10];  /*The displacements of the points by the second network when they were last detected*/
+  int frames;  /*The frames tracked since the landmarks were last detected with both networks, -1 before the first frame*/
+} LandmarkTrack;
+
 class FaceAlignment{
  public:
   /** A constructor with an optional argument specifying path of the model file.
@@ -60,6 +71,42 @@ class FaceAlignment{
   */
   SEETA_API bool PointDetectLandmarks(ImageData gray_im, FaceInfo face_info, FacialLandmark *points);
 
+  /** Detect five facial landmarks of several faces, running the networks on batches
+  *  of faces so that their weights are loaded once per batch rather than per face.
+  *  @param gray_im A grayscale image
+  *  @param face_infos The face bounding boxes
+  *  @param[out] points The locations of detected facial points, five per face in
+  *  the order of the faces
+  */
+  SEETA_API bool PointDetectLandmarks(ImageData gray_im, const std::vector<FaceInfo> & face_infos, FacialLandmark *points);
+
+  /** Set the number of networks run by PointDetectLandmarks. Level 1 returns the
+  *  estimate of the first network on the 80x80 face image, about twice as fast but
+  *  less accurate; level 2 (the default) refines it on the 140x140 face image.
+  *  Other values are ignored. TrackLandmarks always runs both networks when it
+  *  detects the landmarks again.
+  *  @param level The refinement level, 1 or 2
+  */
+  SEETA_API void SetRefinementLevel(int level);
+
+  /** Track five facial landmarks in a video. The landmarks are detected as by
+  *  PointDetectLandmarks in the first frame of a track; in the next frames only the
+  *  second network is run, from the estimate of the first network kept relative to the
+  *  face box, so that a still face keeps the detected landmarks. They are detected again
+  *  when the drift exceeds 3% of the face size, i.e. the face moved too much within its
+  *  box for the second network alone, after 30 tracked frames in a row, and in every
+  *  frame where the face region crosses the image border.
+  *  @param gray_im A grayscale image
+  *  @param face_info The face bounding box in the current frame
+  *  @param[in,out] track The track of the face, default-constructed for its first
+  *  frame and passed back unchanged with each later one; its points are updated to
+  *  the locations of the detected facial points
+  *  @param[out] drift If not NULL, how much the second network moved the points beyond
+  *  its displacements of them when they were last detected, as a root mean square
+  *  relative to the face size; 0 if it was not run from the tracked shape
+  */
+  SEETA_API bool TrackLandmarks(ImageData gray_im, FaceInfo face_info, LandmarkTrack *track, float *drift = NULL);
+
  private:
   CCFAN *facial_detector;
 };
@@ -43,7 +43,7 @@ class SIFT{
   SIFT();
   ~SIFT();
 
-  /** Initialize the SIFT extractor.
+  /** Initialize the SIFT extractor, allocating the buffers for images of the given size.
 	  *  @param im_width The width of the input image
 	  *  @param im_height The height of the input image
 	  *  @param patch_size The size of one patch for extracting SIFT
@@ -51,40 +51,39 @@ class SIFT{
 	  */
   void InitSIFT(int im_width, int im_height, int patch_size, int grid_spacing);
 
-  /** Compute SIFT feature
+  /** Compute SIFT feature in single precision
   *  @param gray_im A grayscale image
   *  @param[out] sift_feature The output SIFT feature
   */
-  void CalcSIFT(BYTE* gray_im, double* sift_feature);
+  void CalcSIFT(BYTE* gray_im, float* sift_feature);
 
  private:
-  /** Implement convolutional function "filter2" same in Matlab.
-  *  @param gray_im A grayscale image
-  *  @param kernel A convolutional kernel
-  *  @param kernel_size The size of convolutional kernel
-  *  @param[out] filter_im The output image map after convolution
+  /** Compute the gradients of the normalized image with the separable 5x5 derivative
+  *   of Gaussian filters (the same as "filter2" in Matlab with zero padding).
+  *  @param gray_im A normalized grayscale image
+  *  @param[out] im_vert_edge The gradient along X (vertical edges)
+  *  @param[out] im_hori_edge The gradient along Y (horizontal edges)
   */
-  void filter2(double* gray_im, double* kernel, int kernel_size, double* filter_im);
-
-  /** Sparse convolution for speed-up
-  *  @param gray_im A grayscale image
-  *  @param kernel A convolutional kernel
-  *  @param kernel_size The size of convolutional kernel
-  *  @param[out] filter_im The output image map after sparse convolution
-  */
-  void SparseFilter2(double* gray_im, double* kernel, int kernel_size, double* filter_im);
+  void GradientFilter(const float* gray_im, float* im_vert_edge, float* im_hori_edge);
 
   /** Calculate image orientation
-  *  @param gray_im A grayscale image
-  *  @param[out] image_orientation The output image orientation
+  *  @param im_vert_edge The gradient along X
+  *  @param im_hori_edge The gradient along Y
+  *  @param[out] image_orientation The output image orientation, with the
+  *              angle_nums bins of each pixel stored contiguously
   */
-  void ImageOrientation(double* gray_im, double* image_orientation);
+  void ImageOrientation(const float* im_vert_edge, const float* im_hori_edge, float* image_orientation);
 
-  /** Calculate image orientation
+  /** Convolve the image orientation with the separable weighting kernel at the
+  *   sample points, i.e. every sample_pixel pixels, as two 1D passes
   *  @param image_orientation A image orientation map
-  *  @param[out] conv_im The output convolutional image
+  *  @param[out] conv_im The output convolutional image at the sample points,
+  *              with the angle_nums bins of each point stored contiguously
   */
-  void ConvImage(double* image_orientation, double* conv_im);
+  void ConvImage(const float* image_orientation, float* conv_im);
+
+  /** Release the buffers allocated by InitSIFT. */
+  void ReleaseBuffers();
 
   private:
   struct SIFTParam
@@ -107,13 +106,30 @@ class SIFT{
 	  int filter_size;
 	  double sigma;
 	  double alpha;
-		
+
+	  int sample_cnt_width;
+	  int sample_cnt_height;
   };
 
   SIFTParam param;
 
-  static double delta_gauss_x[25];
-  static double delta_gauss_y[25];
-
+  /*Buffers reused by CalcSIFT, allocated by InitSIFT*/
+  float* lf_gray_im_;
+  float* gray_img_ex_;     /*The zero padded image for GradientFilter*/
+  float* filter_tmp_;      /*The two images filtered along rows in GradientFilter*/
+  float* im_vert_edge_;
+  float* im_hori_edge_;
+  float* im_orientation_;
+  float* conv_im_;
+  float* conv_tmp_;        /*The rows pooled at the sample columns in ConvImage*/
+  float* conv_weight_;     /*The 1D kernel of ConvImage*/
+  int conv_weight_begin_;  /*The range of the nonzero weights*/
+  int conv_weight_end_;
+
+  /*The separable factors of the derivative of Gaussian filters: the filter
+    along X is gauss_weight (vertical) times delta_weight (horizontal)*/
+  static const float gauss_weight[5];
+  static const float delta_weight[5];
+  static const float cos_array[8];
+  static const float sin_array[8];
 };
-
@@ -33,6 +33,247 @@
 #include "cfan.h"
 #include <string.h>
 #include <algorithm>
+
+#if defined(USE_AVX2) || defined(USE_SSE)
+#include <immintrin.h>
+#endif
+
+#include <sstream>
+
+#ifdef FA_PROFILE
+#include <chrono>
+
+/*Time the stages of a function into profile_time_, when built with FA_PROFILE: each
+  lap is the time since the start or the previous lap*/
+#define PROFILE_START() std::chrono::steady_clock::time_point profile_lap = std::chrono::steady_clock::now()
+#define PROFILE_LAP(stage) \
+  do { \
+    std::chrono::steady_clock::time_point profile_now = std::chrono::steady_clock::now(); \
+    profile_time_[stage] += std::chrono::duration<double, std::micro>(profile_now - profile_lap).count(); \
+    profile_lap = profile_now; \
+  } while (0)
+#else
+#define PROFILE_START()
+#define PROFILE_LAP(stage)
+#endif
+
+/*The number of outputs of a layer packed into one panel, interleaved along the inputs*/
+static const int kPanelWidth = 8;
+
+/*The number of faces sharing each load of a weight panel in FullyConnected*/
+static const int kInputBlock = 4;
+
+/*The largest drift of the tracked shape, relative to the face image size, beyond which
+  FacialPointTrack detects the landmarks again with both networks*/
+static const float kMaxTrackDrift = 0.03f;
+
+/*The most consecutive frames FacialPointTrack refines with the second network alone.
+  A still face keeps the detected landmarks; this only bounds the errors building up
+  while the face moves*/
+static const int kMaxTrackFrames = 30;
+
+/** Round a layer dimension up to a multiple of the panel width.
+  */
+static inline int PanelAlign(int dim)
+{
+  return (dim + kPanelWidth - 1) / kPanelWidth * kPanelWidth;
+}
+
+/*The polynomial approximation of exp(r) for |r| <= ln(2)/2, as in Cephes*/
+static const float kExpHi = 87.0f;
+static const float kLog2e = 1.44269504088896341f;
+static const float kLn2Hi = 0.693359375f;
+static const float kLn2Lo = -2.12194440e-4f;
+static const float kExpP[6] = {1.9875691500e-4f, 1.3981999507e-3f, 8.3334519073e-3f,
+  4.1665795894e-2f, 1.6666665459e-1f, 5.0000001201e-1f};
+
+/** Compute the sigmoid 1 / (1 + exp(-x)), with exp evaluated by range reduction to
+  *  exp(r) * 2^n and a polynomial of degree 5 (relative error about 1e-7).
+  *  @param x The input
+  */
+static inline float FastSigmoid(float x)
+{
+  float t = std::min(std::max(-x, -kExpHi), kExpHi);
+  float n = floor(t * kLog2e + 0.5f);
+  float r = t - n * kLn2Hi - n * kLn2Lo;
+  float p = kExpP[0];
+  for (int i = 1; i < 6; i++)
+  {
+    p = p * r + kExpP[i];
+  }
+  p = p * r * r + r + 1.0f;
+
+  int bits = (int(n) + 127) << 23;
+  float scale;
+  memcpy(&scale, &bits, sizeof(float));
+  return 1.0f / (1.0f + p * scale);
+}
+
+#ifdef USE_AVX2
+static inline __m256 FastSigmoid(__m256 x)
+{
+  __m256 t = _mm256_sub_ps(_mm256_setzero_ps(), x);
+  t = _mm256_min_ps(_mm256_max_ps(t, _mm256_set1_ps(-kExpHi)), _mm256_set1_ps(kExpHi));
+  __m256 n = _mm256_round_ps(_mm256_mul_ps(t, _mm256_set1_ps(kLog2e)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  __m256 r = _mm256_sub_ps(t, _mm256_mul_ps(n, _mm256_set1_ps(kLn2Hi)));
+  r = _mm256_sub_ps(r, _mm256_mul_ps(n, _mm256_set1_ps(kLn2Lo)));
+  __m256 p = _mm256_set1_ps(kExpP[0]);
+  for (int i = 1; i < 6; i++)
+  {
+    p = _mm256_add_ps(_mm256_mul_ps(p, r), _mm256_set1_ps(kExpP[i]));
+  }
+  p = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(p, r), r), r), _mm256_set1_ps(1.0f));
+
+  __m256i bits = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+  __m256 e = _mm256_mul_ps(p, _mm256_castsi256_ps(bits));
+  return _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_add_ps(_mm256_set1_ps(1.0f), e));
+}
+#elif defined(USE_SSE)
+static inline __m128 FastSigmoid(__m128 x)
+{
+  __m128 t = _mm_sub_ps(_mm_setzero_ps(), x);
+  t = _mm_min_ps(_mm_max_ps(t, _mm_set1_ps(-kExpHi)), _mm_set1_ps(kExpHi));
+  __m128 n = _mm_round_ps(_mm_mul_ps(t, _mm_set1_ps(kLog2e)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  __m128 r = _mm_sub_ps(t, _mm_mul_ps(n, _mm_set1_ps(kLn2Hi)));
+  r = _mm_sub_ps(r, _mm_mul_ps(n, _mm_set1_ps(kLn2Lo)));
+  __m128 p = _mm_set1_ps(kExpP[0]);
+  for (int i = 1; i < 6; i++)
+  {
+    p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(kExpP[i]));
+  }
+  p = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(p, r), r), r), _mm_set1_ps(1.0f));
+
+  __m128i bits = _mm_slli_epi32(_mm_add_epi32(_mm_cvtps_epi32(n), _mm_set1_epi32(127)), 23);
+  __m128 e = _mm_mul_ps(p, _mm_castsi128_ps(bits));
+  return _mm_div_ps(_mm_set1_ps(1.0f), _mm_add_ps(_mm_set1_ps(1.0f), e));
+}
+#endif
+
+/** Compute the kPanelWidth outputs of one weight panel for kNum inputs, adding the
+  *  biases and applying the sigmoid if required.
+  *  @param x The inputs
+  *  @param panel The weight panel, kPanelWidth weights per input dimension
+  *  @param in_dim The dimension of the inputs
+  *  @param b The biases of the panel
+  *  @param sigmoid Whether to apply the sigmoid
+  *  @param[out] y The outputs of the panel for each input
+  */
+template <int kNum>
+static inline void PanelProduct(const float *const *x, const float *panel, int in_dim,
+  const float *b, bool sigmoid, float *const *y)
+{
+#ifdef USE_AVX2
+  __m256 sum[kNum];
+  for (int m = 0; m < kNum; m++)
+  {
+    sum[m] = _mm256_setzero_ps();
+  }
+  for (int k = 0; k < in_dim; k++)
+  {
+    __m256 w1 = _mm256_loadu_ps(panel + k * kPanelWidth);
+    for (int m = 0; m < kNum; m++)
+    {
+      sum[m] = _mm256_add_ps(sum[m], _mm256_mul_ps(_mm256_set1_ps(x[m][k]), w1));
+    }
+  }
+  __m256 b1 = _mm256_loadu_ps(b);
+  for (int m = 0; m < kNum; m++)
+  {
+    sum[m] = _mm256_add_ps(sum[m], b1);
+    _mm256_storeu_ps(y[m], sigmoid ? FastSigmoid(sum[m]) : sum[m]);
+  }
+#elif defined(USE_SSE)
+  __m128 sum[kNum][2];
+  for (int m = 0; m < kNum; m++)
+  {
+    sum[m][0] = _mm_setzero_ps();
+    sum[m][1] = _mm_setzero_ps();
+  }
+  for (int k = 0; k < in_dim; k++)
+  {
+    __m128 w1 = _mm_loadu_ps(panel + k * kPanelWidth);
+    __m128 w2 = _mm_loadu_ps(panel + k * kPanelWidth + 4);
+    for (int m = 0; m < kNum; m++)
+    {
+      __m128 x1 = _mm_set1_ps(x[m][k]);
+      sum[m][0] = _mm_add_ps(sum[m][0], _mm_mul_ps(x1, w1));
+      sum[m][1] = _mm_add_ps(sum[m][1], _mm_mul_ps(x1, w2));
+    }
+  }
+  __m128 b1 = _mm_loadu_ps(b);
+  __m128 b2 = _mm_loadu_ps(b + 4);
+  for (int m = 0; m < kNum; m++)
+  {
+    sum[m][0] = _mm_add_ps(sum[m][0], b1);
+    sum[m][1] = _mm_add_ps(sum[m][1], b2);
+    _mm_storeu_ps(y[m], sigmoid ? FastSigmoid(sum[m][0]) : sum[m][0]);
+    _mm_storeu_ps(y[m] + 4, sigmoid ? FastSigmoid(sum[m][1]) : sum[m][1]);
+  }
+#else
+  float sum[kNum][kPanelWidth];
+  memset(sum, 0, sizeof(sum));
+  for (int k = 0; k < in_dim; k++)
+  {
+    const float *w1 = panel + k * kPanelWidth;
+    for (int m = 0; m < kNum; m++)
+    {
+      for (int c = 0; c < kPanelWidth; c++)
+      {
+        sum[m][c] += x[m][k] * w1[c];
+      }
+    }
+  }
+  for (int m = 0; m < kNum; m++)
+  {
+    for (int c = 0; c < kPanelWidth; c++)
+    {
+      float val = sum[m][c] + b[c];
+      y[m][c] = sigmoid ? FastSigmoid(val) : val;
+    }
+  }
+#endif
+}
+
+/** Compute one fully connected layer of a stacked autoencoder network for a batch of
+  *  inputs, i.e. out = in * w' + b as a matrix product, followed by the sigmoid except
+  *  for the output layer. Each weight panel is loaded once for kInputBlock inputs.
+  *  @param in The inputs, one row per face
+  *  @param in_stride The distance between the rows of the inputs
+  *  @param batch_size The number of faces
+  *  @param in_dim The dimension of the inputs
+  *  @param w The weights packed into panels of kPanelWidth outputs
+  *  @param b The biases, padded with zeros to the panel width
+  *  @param out_dim The dimension of the outputs, a multiple of the panel width
+  *  @param sigmoid Whether to apply the sigmoid
+  *  @param[out] out The outputs, one row of out_dim values per face
+  */
+static void FullyConnected(const float *in, int in_stride, int batch_size, int in_dim,
+  const float *w, const float *b, int out_dim, bool sigmoid, float *out)
+{
+  const float *x[kInputBlock];
+  float *y[kInputBlock];
+  for (int p = 0; p < out_dim; p += kPanelWidth)
+  {
+    const float *panel = w + p * in_dim;
+    int n = 0;
+    for (; n + kInputBlock <= batch_size; n += kInputBlock)
+    {
+      for (int m = 0; m < kInputBlock; m++)
+      {
+        x[m] = in + (n + m) * in_stride;
+        y[m] = out + (n + m) * out_dim + p;
+      }
+      PanelProduct<kInputBlock>(x, panel, in_dim, b + p, sigmoid, y);
+    }
+    for (; n < batch_size; n++)
+    {
+      x[0] = in + n * in_stride;
+      y[0] = out + n * out_dim + p;
+      PanelProduct<1>(x, panel, in_dim, b + p, sigmoid, y);
+    }
+  }
+}
+
 /** A constructor.
   *  Initialize basic parameters.
   */
@@ -50,6 +291,20 @@ CCFAN::CCFAN(void)
   lan2_structure_ = NULL;
 
   mean_shape_ = NULL;
+
+  lan1_patch_size_ = 80;
+  lan2_patch_size_ = 140;
+  sift_patch_size_ = 32;
+
+  sub_img_ = NULL;
+  sample_x_ = NULL;
+  sample_wx_ = NULL;
+  refinement_level_ = 2;
+  ResetProfile();
+  batch_capacity_ = 0;
+  face_region_ = NULL;
+  lan1_a_ = NULL;
+  lan2_a_ = NULL;
 }
 
 /** A destructor which should never be called explicitly.
@@ -97,6 +352,27 @@ CCFAN::~CCFAN(void)
     delete[]mean_shape_;
     mean_shape_ = NULL;
   }
+
+  delete[]sub_img_;
+  delete[]sample_x_;
+  delete[]sample_wx_;
+  delete[]face_region_;
+  if (lan1_a_ != NULL)
+  {
+    for (int i = 0; i < lan1_size_; i++)
+    {
+      delete[](lan1_a_[i]);
+    }
+    delete[]lan1_a_;
+  }
+  if (lan2_a_ != NULL)
+  {
+    for (int i = 0; i < lan2_size_; i++)
+    {
+      delete[](lan2_a_[i]);
+    }
+    delete[]lan2_a_;
+  }
 }
 
 /** Initialize the facial landmark detection model.
@@ -110,40 +386,100 @@ void CCFAN::InitModel(const char *model_path)
   mean_shape_ = new float[pts_num_ * 2];
   fread(mean_shape_, sizeof(float), pts_num_ * 2, fp);
 
-  /*Load the parameters of the first local stacked autoencoder network*/
-  fread(&lan1_size_, sizeof(int), 1, fp);
-  lan1_structure_ = new int[lan1_size_];
-  fread(lan1_structure_, sizeof(int), lan1_size_, fp);
+  /*Load the parameters of the two local stacked autoencoder networks*/
+  LoadNetwork(fp, &lan1_size_, &lan1_structure_, &lan1_w_, &lan1_b_);
+  LoadNetwork(fp, &lan2_size_, &lan2_structure_, &lan2_w_, &lan2_b_);
+  fclose(fp);
 
-  lan1_w_ = new float *[lan1_size_ - 1];
-  lan1_b_ = new float *[lan1_size_ - 1];
-  for (int i = 0; i < lan1_size_ - 1; i++)
-  {
-    int layer_size = lan1_structure_[i] * lan1_structure_[i + 1];
-    lan1_w_[i] = new float[layer_size];
-    fread(lan1_w_[i], sizeof(float), layer_size, fp);
+  /*Allocate the workspace of FacialPointLocate*/
+  sift_extractor_.InitSIFT(sift_patch_size_, sift_patch_size_, 32, 16);
+  sub_img_ = new BYTE[sift_patch_size_ * sift_patch_size_];
+  sample_x_ = new int[std::max(lan1_patch_size_, lan2_patch_size_)];
+  sample_wx_ = new double[std::max(lan1_patch_size_, lan2_patch_size_)];
 
-    lan1_b_[i] = new float[lan1_structure_[i + 1]];
-    fread(lan1_b_[i], sizeof(float), lan1_structure_[i + 1], fp);
+  lan1_a_ = new float *[lan1_size_];
+  for (int i = 0; i < lan1_size_; i++)
+  {
+    lan1_a_[i] = NULL;
   }
+  lan2_a_ = new float *[lan2_size_];
+  for (int i = 0; i < lan2_size_; i++)
+  {
+    lan2_a_[i] = NULL;
+  }
+  ReserveBatch(1);
+}
 
-  /*Load the parameters of the second local stacked autoencoder network*/
-  fread(&lan2_size_, sizeof(int), 1, fp);
-  lan2_structure_ = new int[lan2_size_];
-  fread(lan2_structure_, sizeof(int), lan2_size_, fp);
+/** Load the parameters of a local stacked autoencoder network, packing the weights
+  *  of each layer into panels of kPanelWidth outputs: the weights of the outputs of a
+  *  panel are interleaved along the input dimension, and the panels are padded with
+  *  zero weights and biases. The inputs of the first layer are reordered so that it
+  *  takes the SIFT features of the facial points concatenated, rather than
+  *  interleaved among the points as in the model file.
+  *  @param fp The model file
+  *  @param[out] size The number of layers
+  *  @param[out] structure The number of units of each layer
+  *  @param[out] w The packed weights of the layers
+  *  @param[out] b The padded biases of the layers
+  */
+void CCFAN::LoadNetwork(FILE *fp, int *size, int **structure, float ***w, float ***b)
+{
+  fread(size, sizeof(int), 1, fp);
+  *structure = new int[*size];
+  fread(*structure, sizeof(int), *size, fp);
 
-  lan2_w_ = new float *[lan2_size_ - 1];
-  lan2_b_ = new float *[lan2_size_ - 1];
-  for (int i = 0; i < lan2_size_ - 1; i++)
+  *w = new float *[*size - 1];
+  *b = new float *[*size - 1];
+  for (int i = 0; i < *size - 1; i++)
   {
-    int layer_size = lan2_structure_[i] * lan2_structure_[i + 1];
-    lan2_w_[i] = new float[layer_size];
-    fread(lan2_w_[i], sizeof(float), layer_size, fp);
+    int in_dim = (*structure)[i];
+    int out_dim = (*structure)[i + 1];
+    int out_pad = PanelAlign(out_dim);
+
+    float *layer_w = new float[in_dim * out_dim];
+    fread(layer_w, sizeof(float), in_dim * out_dim, fp);
+    (*w)[i] = new float[in_dim * out_pad];
+    for (int j = 0; j < out_pad; j++)
+    {
+      for (int k = 0; k < in_dim; k++)
+      {
+        /*The k-th input is the (k % 128)-th SIFT dimension of the (k / 128)-th point*/
+        int src_k = (i == 0 ? (k % 128) * pts_num_ + k / 128 : k);
+        float weight = (j < out_dim ? layer_w[j * in_dim + src_k] : 0);
+        (*w)[i][((j / kPanelWidth) * in_dim + k) * kPanelWidth + j % kPanelWidth] = weight;
+      }
+    }
+    delete[]layer_w;
 
-    lan2_b_[i] = new float[lan2_structure_[i + 1]];
-    fread(lan2_b_[i], sizeof(float), lan2_structure_[i + 1], fp);
+    (*b)[i] = new float[out_pad];
+    memset((*b)[i], 0, out_pad * sizeof(float));
+    fread((*b)[i], sizeof(float), out_dim, fp);
+  }
+}
+
+/** Make the workspace of FacialPointLocate large enough for a batch of faces.
+  *  @param face_num The number of faces
+  */
+void CCFAN::ReserveBatch(int face_num)
+{
+  if (face_num <= batch_capacity_)
+  {
+    return;
+  }
+  batch_capacity_ = face_num;
+
+  delete[]face_region_;
+  face_region_ = new int[batch_capacity_ * 4];
+  for (int i = 0; i < lan1_size_; i++)
+  {
+    delete[](lan1_a_[i]);
+    lan1_a_[i] = new float[batch_capacity_ * PanelAlign(lan1_structure_[i])];
+  }
+  for (int i = 0; i < lan2_size_; i++)
+  {
+    delete[](lan2_a_[i]);
+    lan2_a_[i] = new float[batch_capacity_ * PanelAlign(lan2_structure_[i])];
   }
-  fclose(fp);
 }
 
 /** Detect five facial landmarks, i.e., two eye centers, nose tip and two mouth corners.
@@ -155,306 +491,494 @@ void CCFAN::InitModel(const char *model_path)
   */
 void CCFAN::FacialPointLocate(const unsigned char *gray_im, int im_width, int im_height, seeta::FaceInfo face_loc, float *facial_loc)
 {
-  int sift_patch_size = 32;
-  int left_x = face_loc.bbox.x;
-  int left_y = face_loc.bbox.y;
-  int bbox_w = face_loc.bbox.width;
-  int bbox_h = face_loc.bbox.height;
-  int right_x = left_x + bbox_w - 1;
-  int right_y = left_y + bbox_h - 1;
-
-  float extend_factor = 0.05;
-  float extend_revised_y = 0.05;
-
-  /*Compute the extended region of the detected face*/
-  int extend_lx = std::max(int(floor(left_x - extend_factor*bbox_w)), int(0));
-  int extend_rx = std::min(int(floor(right_x + extend_factor*bbox_w)), int(im_width - 1));
-  int extend_ly = std::max(int(floor(left_y - (extend_factor - extend_revised_y)*bbox_h)), int(0));
-  int extend_ry = std::min(int(floor(right_y + (extend_factor + extend_revised_y)*bbox_h)), int(im_height - 1));
+  FacialPointLocate(gray_im, im_width, im_height, &face_loc, 1, facial_loc);
+}
 
-  int face_w = extend_rx - extend_lx + 1;
-  int face_h = extend_ry - extend_ly + 1;
+/** Detect five facial landmarks of a batch of faces, running each layer of the
+  *  networks on the features of all faces at once.
+  *  @param gray_im A grayscale image
+  *  @param im_width The width of the inpute image
+  *  @param im_height The height of the inpute image
+  *  @param face_loc The face bounding boxes
+  *  @param face_num The number of faces, at most kMaxBatchSize
+  *  @param[out] facial_loc The locations of detected facial points, ten values per face
+  */
+void CCFAN::FacialPointLocate(const unsigned char *gray_im, int im_width, int im_height, const seeta::FaceInfo *face_loc, int face_num, float *facial_loc)
+{
+  LocateLandmarks(gray_im, im_width, im_height, face_loc, face_num, refinement_level_, facial_loc);
+}
 
-  /*Get the face image based on the extended face region*/
-  unsigned char *face_patch = new unsigned char[face_w*face_h];
-  for (int h = 0; h < face_h; h++)
+/** Detect five facial landmarks of a batch of faces with the given number of networks.
+  *  @param gray_im A grayscale image
+  *  @param im_width The width of the inpute image
+  *  @param im_height The height of the inpute image
+  *  @param face_loc The face bounding boxes
+  *  @param face_num The number of faces, at most kMaxBatchSize
+  *  @param level The number of networks run, 1 or 2
+  *  @param[out] facial_loc The locations of detected facial points, ten values per face
+  */
+void CCFAN::LocateLandmarks(const unsigned char *gray_im, int im_width, int im_height, const seeta::FaceInfo *face_loc, int face_num, int level, float *facial_loc)
+{
+  ReserveBatch(face_num);
+  LocateFirstStage(gray_im, im_width, im_height, face_loc, face_num, level, facial_loc);
+  if (level >= 2)
   {
-    const unsigned char *p_origin = gray_im + (h + extend_ly)*im_width + extend_lx;
-    unsigned char *p_dest = face_patch + h*face_w;
-    memcpy(p_dest, p_origin, face_w);
+    LocateSecondStage(gray_im, im_width, face_num, facial_loc);
   }
+}
 
+/** Estimate the shapes of a batch of faces with the first local stacked autoencoder
+  *  network.
+  *  @param gray_im A grayscale image
+  *  @param im_width The width of the inpute image
+  *  @param im_height The height of the inpute image
+  *  @param face_loc The face bounding boxes, whose regions are stored in face_region_
+  *  @param face_num The number of faces, at most kMaxBatchSize
+  *  @param level The number of networks run, 1 or 2
+  *  @param[out] facial_loc The locations of facial points, in the image at level 1 and
+  *              in the face image of the second network at level 2
+  */
+void CCFAN::LocateFirstStage(const unsigned char *gray_im, int im_width, int im_height, const seeta::FaceInfo *face_loc, int face_num, int level, float *facial_loc)
+{
   /*The first local stacked autoencoder network*/
-  double *fea = new double[fea_dim_];
-  int lan1_resize_w = 80;
-  int lan1_resize_h = 80;
-  BYTE *lan1_patch = new BYTE[lan1_resize_w*lan1_resize_h];
-  ResizeImage(face_patch, face_w, face_h, lan1_patch, lan1_resize_w, lan1_resize_h);
-
-  for (int i = 0; i < pts_num_; i++)
+  for (int f = 0; f < face_num; f++)
   {
-    facial_loc[i * 2] = mean_shape_[i * 2] - 1;
-    facial_loc[i * 2 + 1] = mean_shape_[i * 2 + 1] - 1;
-  }
+    /*The face image of each network is the extended face region resized, of which
+      only the patches of the facial points are sampled*/
+    int *face_region = face_region_ + f * 4;
+    GetFaceRegion(face_loc[f], im_width, im_height, face_region);
 
-  /*Extract the shape indexed SIFT features*/
-  TtSift(lan1_patch, lan1_resize_w, lan1_resize_h, facial_loc, 32, fea);
-
-  float *re_fea = new float[fea_dim_];
-  for (int i = 0; i < 128; i++)
-  {
-    for (int j = 0; j < pts_num_; j++)
+    float *face_shape = facial_loc + f * pts_num_ * 2;
+    for (int i = 0; i < pts_num_; i++)
     {
-      if (isnan(fea[j * 128 + i]))
-      {
-        re_fea[i*pts_num_ + j] = 0;
-      }
-      else
-      {
-        re_fea[i*pts_num_ + j] = fea[j * 128 + i];
-      }
+      face_shape[i * 2] = mean_shape_[i * 2] - 1;
+      face_shape[i * 2 + 1] = mean_shape_[i * 2 + 1] - 1;
     }
+
+    /*Extract the shape indexed SIFT features*/
+    GetShapeIndexedFeature(gray_im, im_width, face_region, lan1_patch_size_, face_shape, lan1_a_[0] + f * PanelAlign(fea_dim_));
   }
 
-  float ** lan1_a = new float *[lan1_size_];
+  ForwardNetwork(lan1_w_, lan1_b_, lan1_structure_, lan1_size_, lan1_a_, face_num);
 
-  for (int i = 0; i < lan1_size_; i++)
-  {
-    lan1_a[i] = new float[lan1_structure_[i]];
-  }
+  float x_scale = float(lan1_patch_size_) / lan2_patch_size_;
+  float y_scale = float(lan1_patch_size_) / lan2_patch_size_;
 
-  for (int i = 0; i < fea_dim_; i++)
+  for (int f = 0; f < face_num; f++)
   {
-    lan1_a[0][i] = re_fea[i];
+    float *face_shape = facial_loc + f * pts_num_ * 2;
+    float *lan1_out = lan1_a_[lan1_size_ - 1] + f * PanelAlign(lan1_structure_[lan1_size_ - 1]);
+    for (int i = 0; i < pts_num_ * 2; i++)
+    {
+      face_shape[i] = face_shape[i] + lan1_out[i];
+    }
+    if (level < 2)
+    {
+      MapToImage(face_region_ + f * 4, lan1_patch_size_, face_shape);
+      continue;
+    }
+    for (int i = 0; i < pts_num_; i++)
+    {
+      face_shape[i * 2] = (face_shape[i * 2]) / x_scale;
+      face_shape[i * 2 + 1] = (face_shape[i * 2 + 1]) / y_scale;
+    }
   }
+}
 
-  for (int i = 0; i < lan1_size_ - 1; i++)
+/** Track five facial landmarks in a video. The second network starts from the shape
+  *  of the track, which is the estimate of the first network when the landmarks were
+  *  last detected, kept in the face image so that it follows the face box. The shape is
+  *  then moved by the change of the displacement of the points by the second network
+  *  since, so that a still face gets the detected landmarks in every frame: the second
+  *  network never refines its own output, whose bias would build up frame after frame.
+  *  The landmarks are detected again with both networks when the drift shows that the
+  *  face moved too much for the second network alone, every kMaxTrackFrames frames, and
+  *  whenever the face region is clipped by the image border.
+  *  @param gray_im A grayscale image
+  *  @param im_width The width of the inpute image
+  *  @param im_height The height of the inpute image
+  *  @param face_loc The face bounding box in the current frame
+  *  @param[in,out] track_shape The shape the second network starts from, in its face
+  *                 image, i.e. the estimate of the first network when the points were
+  *                 last detected, moved along with the face since
+  *  @param[in,out] track_offset The displacements of the points by the second network
+  *                 when they were last detected
+  *  @param[in,out] track_frames The number of frames the points have been tracked
+  *                 since they were last detected with both networks, negative if they
+  *                 never were; reset to 0 when they are detected again
+  *  @param[out] facial_loc The locations of detected facial points
+  *  @return The drift, i.e. the root mean square of the changes of the displacements
+  *          of the points by the second network since they were last detected,
+  *          relative to the size of its face image; 0 if the second network did not
+  *          start from the shape of the track
+  */
+float CCFAN::FacialPointTrack(const unsigned char *gray_im, int im_width, int im_height, seeta::FaceInfo face_loc, float *track_shape, float *track_offset, int *track_frames, float *facial_loc)
+{
+  ReserveBatch(1);
+  const float *lan2_out = lan2_a_[lan2_size_ - 1];
+  const int *face_region = face_region_;
+  float drift = 0;
+
+  /*The face image of a region clipped by the image border is stretched, differently as
+    the face moves, which the shape of the track does not follow*/
+  bool clipped = GetFaceRegion(face_loc, im_width, im_height, face_region_);
+  if (*track_frames >= 0 && *track_frames < kMaxTrackFrames && !clipped)
   {
-    for (int j = 0; j < lan1_structure_[i + 1]; j++)
+    float x_scale = float(lan2_patch_size_) / face_region[2];
+    float y_scale = float(lan2_patch_size_) / face_region[3];
+
+    /*The shape of the track in the face image of the second network*/
+    for (int i = 0; i < pts_num_; i++)
     {
-      float inner_product = 0;
-      int fea_dim = lan1_structure_[i];
-      for (int k = 0; k < fea_dim; k++)
-      {
-        inner_product = inner_product + lan1_a[i][k] * lan1_w_[i][j*fea_dim + k];
-      }
-      if (i == lan1_size_ - 2)
-      {
-        lan1_a[i + 1][j] = inner_product + lan1_b_[i][j];
-      }
-      else
+      facial_loc[i * 2] = (track_shape[i * 2] * face_loc.bbox.width + face_loc.bbox.x - face_region[0]) * x_scale;
+      facial_loc[i * 2 + 1] = (track_shape[i * 2 + 1] * face_loc.bbox.height + face_loc.bbox.y - face_region[1]) * y_scale;
+    }
+    LocateSecondStage(gray_im, im_width, 1, facial_loc);
+
+    /*The changes of the displacements relative to the face box, by which the shape of
+      the track follows the face*/
+    for (int i = 0; i < pts_num_; i++)
+    {
+      float x_change = lan2_out[i * 2] / x_scale / face_loc.bbox.width - track_offset[i * 2];
+      float y_change = lan2_out[i * 2 + 1] / y_scale / face_loc.bbox.height - track_offset[i * 2 + 1];
+      drift += x_change * x_change + y_change * y_change;
+    }
+    drift = sqrt(drift / pts_num_);
+    if (drift <= kMaxTrackDrift)
+    {
+      for (int i = 0; i < pts_num_; i++)
       {
-        lan1_a[i + 1][j] = 1.0 / (1 + exp(-inner_product - lan1_b_[i][j]));
+        track_shape[i * 2] += lan2_out[i * 2] / x_scale / face_loc.bbox.width - track_offset[i * 2];
+        track_shape[i * 2 + 1] += lan2_out[i * 2 + 1] / y_scale / face_loc.bbox.height - track_offset[i * 2 + 1];
       }
-
+      (*track_frames)++;
+      return drift;
     }
   }
-  for (int i = 0; i < pts_num_ * 2; i++)
+
+  /*The shape of the track and the displacements are kept relative to the face box,
+    which unlike the face region is not clipped by the image border*/
+  LocateFirstStage(gray_im, im_width, im_height, &face_loc, 1, 2, facial_loc);
+  float x_scale = float(lan2_patch_size_) / face_region[2];
+  float y_scale = float(lan2_patch_size_) / face_region[3];
+  for (int i = 0; i < pts_num_; i++)
   {
-    facial_loc[i] = facial_loc[i] + lan1_a[lan1_size_ - 1][i];
+    track_shape[i * 2] = (facial_loc[i * 2] / x_scale + face_region[0] - face_loc.bbox.x) / face_loc.bbox.width;
+    track_shape[i * 2 + 1] = (facial_loc[i * 2 + 1] / y_scale + face_region[1] - face_loc.bbox.y) / face_loc.bbox.height;
   }
-  for (int i = 0; i < lan1_size_; i++)
+  LocateSecondStage(gray_im, im_width, 1, facial_loc);
+  for (int i = 0; i < pts_num_; i++)
   {
-    delete[](lan1_a[i]);
+    track_offset[i * 2] = lan2_out[i * 2] / x_scale / face_loc.bbox.width;
+    track_offset[i * 2 + 1] = lan2_out[i * 2 + 1] / y_scale / face_loc.bbox.height;
   }
-  delete[]lan1_a;
-  delete[]lan1_patch;
+  *track_frames = 0;
+  return drift;
+}
+
+/** Compute the extended region of a detected face, in which the landmarks are located.
+  *  @param face_loc The face bounding box
+  *  @param im_width The width of the inpute image
+  *  @param im_height The height of the inpute image
+  *  @param[out] face_region The extended face region (x, y, width, height), inside the image
+  *  @return Whether the region was clipped by the image border
+  */
+bool CCFAN::GetFaceRegion(const seeta::FaceInfo &face_loc, int im_width, int im_height, int *face_region)
+{
+  PROFILE_START();
+  int left_x = face_loc.bbox.x;
+  int left_y = face_loc.bbox.y;
+  int bbox_w = face_loc.bbox.width;
+  int bbox_h = face_loc.bbox.height;
+  int right_x = left_x + bbox_w - 1;
+  int right_y = left_y + bbox_h - 1;
 
-  /*The second local stacked autoencoder network*/
-  int lan2_resize_w = 140;
-  int lan2_resize_h = 140;
-  BYTE *lan2_patch = new BYTE[lan2_resize_w*lan2_resize_h];
-  ResizeImage(face_patch, face_w, face_h, lan2_patch, lan2_resize_w, lan2_resize_h);
+  float extend_factor = 0.05;
+  float extend_revised_y = 0.05;
 
-  float x_scale = float(lan1_resize_w) / lan2_resize_w;
-  float y_scale = float(lan1_resize_h) / lan2_resize_h;
+  /*Compute the extended region of the detected face*/
+  int extend_lx = std::max(int(floor(left_x - extend_factor*bbox_w)), int(0));
+  int extend_rx = std::min(int(floor(right_x + extend_factor*bbox_w)), int(im_width - 1));
+  int extend_ly = std::max(int(floor(left_y - (extend_factor - extend_revised_y)*bbox_h)), int(0));
+  int extend_ry = std::min(int(floor(right_y + (extend_factor + extend_revised_y)*bbox_h)), int(im_height - 1));
 
-  for (int i = 0; i < pts_num_; i++)
+  face_region[0] = extend_lx;
+  face_region[1] = extend_ly;
+  face_region[2] = extend_rx - extend_lx + 1;
+  face_region[3] = extend_ry - extend_ly + 1;
+  PROFILE_LAP(kProfileRegion);
+  return extend_lx == 0 || extend_ly == 0 || extend_rx == im_width - 1 || extend_ry == im_height - 1;
+}
+
+/** Refine the shapes of a batch of faces with the second local stacked autoencoder
+  *  network, and map them back to the image.
+  *  @param gray_im A grayscale image
+  *  @param im_width The width of the inpute image
+  *  @param face_num The number of faces, whose regions are in face_region_
+  *  @param[in,out] facial_loc The locations of facial points, in the face image of
+  *                 the second network on input and in the image on output
+  */
+void CCFAN::LocateSecondStage(const unsigned char *gray_im, int im_width, int face_num, float *facial_loc)
+{
+  for (int f = 0; f < face_num; f++)
   {
-    facial_loc[i * 2] = (facial_loc[i * 2]) / x_scale;
-    facial_loc[i * 2 + 1] = (facial_loc[i * 2 + 1]) / y_scale;
+    /*Extract the shape indexed SIFT features*/
+    GetShapeIndexedFeature(gray_im, im_width, face_region_ + f * 4, lan2_patch_size_, facial_loc + f * pts_num_ * 2, lan2_a_[0] + f * PanelAlign(fea_dim_));
   }
-  /*Extract the shape indexed SIFT features*/
-  TtSift(lan2_patch, lan2_resize_w, lan2_resize_h, facial_loc, 32, fea);
 
-  for (int i = 0; i < 128; i++)
+  ForwardNetwork(lan2_w_, lan2_b_, lan2_structure_, lan2_size_, lan2_a_, face_num);
+
+  for (int f = 0; f < face_num; f++)
   {
-    for (int j = 0; j < pts_num_; j++)
+    float *face_shape = facial_loc + f * pts_num_ * 2;
+    float *lan2_out = lan2_a_[lan2_size_ - 1] + f * PanelAlign(lan2_structure_[lan2_size_ - 1]);
+    for (int i = 0; i < pts_num_ * 2; i++)
     {
-      if (isnan(fea[j * 128 + i]))
-      {
-        re_fea[i*pts_num_ + j] = 0;
-      }
-      else
-      {
-        re_fea[i*pts_num_ + j] = fea[j * 128 + i];
-      }
+      face_shape[i] = face_shape[i] + lan2_out[i];
     }
+
+    MapToImage(face_region_ + f * 4, lan2_patch_size_, face_shape);
   }
+}
 
-  float ** lan2_a = new float *[lan2_size_];
+/** Map the locations of facial points from a face image back to the image.
+  *  @param face_region The extended face region (x, y, width, height) in the image
+  *  @param face_size The size of the face image the region is resized to
+  *  @param[in,out] face_shape The locations of facial points
+  */
+void CCFAN::MapToImage(const int *face_region, int face_size, float *face_shape)
+{
+  PROFILE_START();
+  float x_scale = float(face_size) / face_region[2];
+  float y_scale = float(face_size) / face_region[3];
 
-  for (int i = 0; i < lan2_size_; i++)
+  for (int i = 0; i < pts_num_; i++)
   {
-    lan2_a[i] = new float[lan2_structure_[i]];
+    face_shape[i * 2] = (face_shape[i * 2]) / x_scale + face_region[0];
+    face_shape[i * 2 + 1] = (face_shape[i * 2 + 1]) / y_scale + face_region[1];
   }
+  PROFILE_LAP(kProfileMap);
+}
 
-  for (int i = 0; i < fea_dim_; i++)
-  {
-    lan2_a[0][i] = re_fea[i];
-  }
+/** Extract the shape indexed SIFT features of a face as the input of a network, with
+  *  NaN replaced by 0. The features of the points are concatenated, as the weights of
+  *  the first layers are reordered accordingly by LoadNetwork.
+  *  @param gray_im A grayscale image
+  *  @param im_width The width of the inpute image
+  *  @param face_region The extended face region (x, y, width, height) in the image
+  *  @param face_size The size of the face image the region is resized to
+  *  @param face_shape The locations of facial points in the face image
+  *  @param[out] fea The input of the network
+  */
+void CCFAN::GetShapeIndexedFeature(const unsigned char *gray_im, int im_width, const int *face_region, int face_size, float *face_shape, float *fea)
+{
+  TtSift(gray_im, im_width, face_region, face_size, face_shape, sift_patch_size_, fea);
 
-  for (int i = 0; i < lan2_size_ - 1; i++)
+  for (int i = 0; i < fea_dim_; i++)
   {
-    for (int j = 0; j < lan2_structure_[i + 1]; j++)
+    if (std::isnan(fea[i]))
     {
-      float inner_product = 0;
-      int fea_dim = lan2_structure_[i];
-      for (int k = 0; k < fea_dim; k++)
-      {
-        inner_product = inner_product + lan2_a[i][k] * lan2_w_[i][j*fea_dim + k];
-      }
-      if (i == lan2_size_ - 2)
-      {
-        lan2_a[i + 1][j] = inner_product + lan2_b_[i][j];
-      }
-      else
-      {
-        lan2_a[i + 1][j] = 1.0 / (1 + exp(-inner_product - lan2_b_[i][j]));
-      }
-
+      fea[i] = 0;
     }
   }
-  for (int i = 0; i < pts_num_ * 2; i++)
-  {
-    facial_loc[i] = facial_loc[i] + lan2_a[lan2_size_ - 1][i];
-  }
-  for (int i = 0; i < lan2_size_; i++)
-  {
-    delete[](lan2_a[i]);
-  }
-  delete[]lan2_a;
-  delete[]lan2_patch;
-
-  delete[]fea;
-  delete[]re_fea;
-  delete[]face_patch;
-
-  x_scale = float(lan2_resize_w) / face_w;
-  y_scale = float(lan2_resize_h) / face_h;
+}
 
-  for (int i = 0; i < pts_num_; i++)
+/** Run a local stacked autoencoder network on a batch of faces, layer by layer.
+  *  @param w The packed weights of the layers
+  *  @param b The padded biases of the layers
+  *  @param structure The number of units of each layer
+  *  @param size The number of layers
+  *  @param[in,out] a The units of each layer, one row per face padded to the panel
+  *                   width, with the input in a[0]
+  *  @param face_num The number of faces
+  */
+void CCFAN::ForwardNetwork(float **w, float **b, const int *structure, int size, float **a, int face_num)
+{
+#ifdef FA_PROFILE
+  int first_stage = (w == lan1_w_ ? kProfileLayer : kProfileLayer + lan1_size_ - 1);
+#endif
+  PROFILE_START();
+  for (int i = 0; i < size - 1; i++)
   {
-    facial_loc[i * 2] = (facial_loc[i * 2]) / x_scale + extend_lx;
-    facial_loc[i * 2 + 1] = (facial_loc[i * 2 + 1]) / y_scale + extend_ly;
+    FullyConnected(a[i], PanelAlign(structure[i]), face_num, structure[i], w[i], b[i],
+      PanelAlign(structure[i + 1]), i < size - 2, a[i + 1]);
+    PROFILE_LAP(std::min(first_stage + i, int(kMaxProfileStage) - 1));
   }
 }
 
-/** Extract shape indexed SIFT features.
+/** Extract shape indexed SIFT features. The patches of the facial points are sampled
+  *  from the face image, i.e. the face region of the image resized to face_size x
+  *  face_size, without resizing the whole region.
   *  @param gray_im A grayscale image
   *  @param im_width The width of the inpute image
-  *  @param im_height The height of the inpute image
-  *  @param face_shape The locations of facial points
+  *  @param face_region The extended face region (x, y, width, height) in the image
+  *  @param face_size The size of the face image the region is resized to
+  *  @param face_shape The locations of facial points in the face image
   *  @param patch_size The size of the patch used for extracting SIFT feature
   *  @param[out] sift_fea the extracted shape indexed SIFT features which are concatenated into a vector
   */
-void CCFAN::TtSift(const unsigned char *gray_im, int im_width, int im_height, float *face_shape, int patch_size, double *sift_fea)
+void CCFAN::TtSift(const unsigned char *gray_im, int im_width, const int *face_region, int face_size, float *face_shape, int patch_size, float *sift_fea)
 {
-  unsigned char *sub_img = new unsigned char[patch_size*patch_size];
-  SIFT* sift_extractor = new SIFT();
-  sift_extractor->InitSIFT(patch_size, patch_size, 32, 16);
-  double *one_sift_fea = new double[128];
-  double *fea_header = sift_fea;
+  PROFILE_START();
 
   for (int i = 0; i < pts_num_; i++)
   {
+    /*The top left corner of the patch centered at the facial point*/
+    int patch_x = int(floor(face_shape[i * 2] + 0.5)) + 1 - patch_size / 2;
+    int patch_y = int(floor(face_shape[i * 2 + 1] + 0.5)) + 1 - patch_size / 2;
     /*Get one image patch*/
-    GetSubImg(gray_im, im_width, im_height, face_shape[i * 2], face_shape[i * 2 + 1], patch_size, sub_img);
+    SampleFace(gray_im, im_width, face_region, face_size, patch_x, patch_y, patch_size, patch_size, sub_img_);
+    PROFILE_LAP(kProfileSample);
     /*Extract  one SIFT feature of one image patch*/
-    sift_extractor->CalcSIFT(sub_img, one_sift_fea);
-    memcpy(fea_header + i * 128, one_sift_fea, 128 * 8);
+    sift_extractor_.CalcSIFT(sub_img_, sift_fea + i * 128);
+    PROFILE_LAP(kProfileSift);
   }
-  delete[]one_sift_fea;
-  delete[]sub_img;
-  delete sift_extractor;
 }
 
-/** Extract a image patch which is centered at point(point_x, point_y) with a given patch size.
+/** Sample a rectangle of the face image, i.e. the face region of the image resized to
+  *  face_size x face_size by bilinear interpolation, with the pixels outside the face
+  *  image being 128. Only the pixels of the rectangle are interpolated, from the image
+  *  directly, in the same way as the whole face image would be.
   *  @param gray_im A grayscale image
   *  @param im_width The width of the inpute image
-  *  @param im_height The height of the inpute image
-  *  @param point_x The X coordinate of one point
-  *  @param point_y The Y coordinate of one point
-  *  @param patch_size The size of the extracted patch
-  *  @param[out] sub_img A grayscale image patch
+  *  @param face_region The face region (x, y, width, height) in the image
+  *  @param face_size The size of the face image
+  *  @param x The X coordinate of the top left corner of the rectangle in the face image
+  *  @param y The Y coordinate of the top left corner of the rectangle in the face image
+  *  @param width The width of the rectangle
+  *  @param height The height of the rectangle
+  *  @param[out] dst_im The sampled rectangle in grayscale
   */
-void CCFAN::GetSubImg(const unsigned char *gray_im, int im_width, int im_height, float point_x, float point_y, int patch_size, BYTE *sub_img)
+void CCFAN::SampleFace(const unsigned char *gray_im, int im_width, const int *face_region, int face_size,
+  int x, int y, int width, int height, BYTE *dst_im)
 {
-  memset(sub_img, 128, patch_size*patch_size);
-  int center_x = floor(point_x + 0.5);
-  int center_y = floor(point_y + 0.5);
-  int patch_left = std::max((center_x + 1) - patch_size / 2, 0);
-  int patch_right = std::min((center_x + 1) + patch_size / 2 - 1, im_width - 1);
-  int patch_top = std::max((center_y + 1) - patch_size / 2, 0);
-  int patch_bottom = std::min((center_y + 1) + patch_size / 2 - 1, im_height - 1);
-
-  int lx = abs(patch_left - ((center_x + 1) - patch_size / 2));
-  int rx = patch_size - abs(patch_right - ((center_x + 1) + patch_size / 2 - 1)) - 1;
-  int ty = abs(patch_top - ((center_y + 1) - patch_size / 2));
-  int by = patch_size - abs(patch_bottom - ((center_y + 1) + patch_size / 2 - 1)) - 1;
-
-  for (int h = ty, ph = patch_top; h < by + 1; h++, ph++)
-  {
-    for (int w = lx, pw = patch_left; w < rx + 1; w++, pw++)
+  memset(dst_im, 128, width * height);
+  int col_begin = std::max(x, 0);
+  int col_end = std::min(x + width, face_size);
+  int row_begin = std::max(y, 0);
+  int row_end = std::min(y + height, face_size);
+  if (col_begin >= col_end || row_begin >= row_end)
+  {
+    return;
+  }
+
+  const unsigned char *src_im = gray_im + face_region[1] * im_width + face_region[0];
+  int src_width = face_region[2];
+  int src_height = face_region[3];
+  double lfx_scl = double(src_width + 0.0) / face_size;
+  double lfy_scl = double(src_height + 0.0) / face_size;
+
+  /*The source columns and weights of the columns, shared by the rows*/
+  int col_num = col_end - col_begin;
+  for (int j = 0; j < col_num; j++)
+  {
+    double lf_x_s = lfx_scl * (col_begin + j);
+    int n_x_s = int(lf_x_s);
+    n_x_s = (n_x_s <= (src_width - 2) ? n_x_s : (src_width - 2));
+    sample_x_[j] = n_x_s;
+    sample_wx_[j] = lf_x_s - n_x_s;
+  }
+
+  for (int n_y_d = row_begin; n_y_d < row_end; n_y_d++)
+  {
+    double lf_y_s = lfy_scl * n_y_d;
+    int n_y_s = int(lf_y_s);
+    n_y_s = (n_y_s <= (src_height - 2) ? n_y_s : (src_height - 2));
+    double lf_weight_y = lf_y_s - n_y_s;
+
+    const unsigned char *src0 = src_im + n_y_s * im_width;
+    const unsigned char *src1 = src0 + im_width;
+    BYTE *dst = dst_im + (n_y_d - y) * width + col_begin - x;
+    int j = 0;
+#ifdef USE_AVX2
+    __m256d one4 = _mm256_set1_pd(1.0);
+    __m256d wy4 = _mm256_set1_pd(lf_weight_y);
+    __m256d vy4 = _mm256_sub_pd(one4, wy4);
+    __m128i low_bytes = _mm_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    for (; j + 4 <= col_num; j += 4)
+    {
+      const int *sx = sample_x_ + j;
+      __m256d a = _mm256_setr_pd(src0[sx[0]], src0[sx[1]], src0[sx[2]], src0[sx[3]]);
+      __m256d b = _mm256_setr_pd(src0[sx[0] + 1], src0[sx[1] + 1], src0[sx[2] + 1], src0[sx[3] + 1]);
+      __m256d c = _mm256_setr_pd(src1[sx[0]], src1[sx[1]], src1[sx[2]], src1[sx[3]]);
+      __m256d d = _mm256_setr_pd(src1[sx[0] + 1], src1[sx[1] + 1], src1[sx[2] + 1], src1[sx[3] + 1]);
+      __m256d wx = _mm256_loadu_pd(sample_wx_ + j);
+      __m256d vx = _mm256_sub_pd(one4, wx);
+      __m256d top = _mm256_add_pd(_mm256_mul_pd(vx, a), _mm256_mul_pd(wx, b));
+      __m256d bottom = _mm256_add_pd(_mm256_mul_pd(vx, c), _mm256_mul_pd(wx, d));
+      __m256d gray = _mm256_add_pd(_mm256_mul_pd(vy4, top), _mm256_mul_pd(wy4, bottom));
+      int packed = _mm_cvtsi128_si32(_mm_shuffle_epi8(_mm256_cvttpd_epi32(gray), low_bytes));
+      memcpy(dst + j, &packed, 4);
+    }
+#elif defined(USE_SSE)
+    __m128d one2 = _mm_set1_pd(1.0);
+    __m128d wy2 = _mm_set1_pd(lf_weight_y);
+    __m128d vy2 = _mm_sub_pd(one2, wy2);
+    for (; j + 2 <= col_num; j += 2)
+    {
+      const int *sx = sample_x_ + j;
+      __m128d a = _mm_setr_pd(src0[sx[0]], src0[sx[1]]);
+      __m128d b = _mm_setr_pd(src0[sx[0] + 1], src0[sx[1] + 1]);
+      __m128d c = _mm_setr_pd(src1[sx[0]], src1[sx[1]]);
+      __m128d d = _mm_setr_pd(src1[sx[0] + 1], src1[sx[1] + 1]);
+      __m128d wx = _mm_loadu_pd(sample_wx_ + j);
+      __m128d vx = _mm_sub_pd(one2, wx);
+      __m128d top = _mm_add_pd(_mm_mul_pd(vx, a), _mm_mul_pd(wx, b));
+      __m128d bottom = _mm_add_pd(_mm_mul_pd(vx, c), _mm_mul_pd(wx, d));
+      __m128i gray = _mm_cvttpd_epi32(_mm_add_pd(_mm_mul_pd(vy2, top), _mm_mul_pd(wy2, bottom)));
+      dst[j] = (unsigned char)_mm_cvtsi128_si32(gray);
+      dst[j + 1] = (unsigned char)_mm_extract_epi32(gray, 1);
+    }
+#endif
+    for (; j < col_num; j++)
     {
-      sub_img[h*patch_size + w] = gray_im[ph*im_width + pw];
+      int n_x_s = sample_x_[j];
+      double lf_weight_x = sample_wx_[j];
+      double lf_new_gray = (1 - lf_weight_y) * ((1 - lf_weight_x) * src0[n_x_s] +
+        lf_weight_x * src0[n_x_s + 1]) +
+        lf_weight_y * ((1 - lf_weight_x) * src1[n_x_s] +
+        lf_weight_x * src1[n_x_s + 1]);
+      dst[j] = (unsigned char)(int)(lf_new_gray);
     }
   }
 }
 
-/** Resize the image by bilinear interpolation.
-  *  @param src_im A source image in grayscale
-  *  @param src_width The width of the source image
-  *  @param src_height The height of the source image
-  *  @param[out] dst_im The target image in grayscale
-  *  @param dst_width The width of the target image
-  *  @param dst_height The height of the target image
+/** The number of stages timed, including the layers.
   */
-bool CCFAN::ResizeImage(const unsigned char *src_im, int src_width, int src_height,
-  unsigned char* dst_im, int dst_width, int dst_height)
+int CCFAN::ProfileStageNum() const
 {
+  return std::min(kProfileLayer + (lan1_size_ - 1) + (lan2_size_ - 1), int(kMaxProfileStage));
+}
 
-  double	lfx_scl, lfy_scl;
-  if (src_width == dst_width && src_height == dst_height) {
-    memcpy(dst_im, src_im, src_width * src_height * sizeof(unsigned char));
-    return true;
+/** The name of a stage.
+  *  @param stage The index of the stage
+  */
+std::string CCFAN::ProfileStageName(int stage) const
+{
+  static const char *kStageNames[kProfileLayer] = { "region", "sample", "sift", "map" };
+  if (stage < kProfileLayer)
+  {
+    return kStageNames[stage];
   }
-
-  lfx_scl = double(src_width + 0.0) / dst_width;
-  lfy_scl = double(src_height + 0.0) / dst_height;
-
-  for (int n_y_d = 0; n_y_d < dst_height; n_y_d++) {
-    for (int n_x_d = 0; n_x_d < dst_width; n_x_d++) {
-      double lf_x_s = lfx_scl * n_x_d;
-      double lf_y_s = lfy_scl * n_y_d;
-
-      int n_x_s = int(lf_x_s);
-      n_x_s = (n_x_s <= (src_width - 2) ? n_x_s : (src_width - 2));
-      int n_y_s = int(lf_y_s);
-      n_y_s = (n_y_s <= (src_height - 2) ? n_y_s : (src_height - 2));
-
-      double lf_weight_x = lf_x_s - n_x_s;
-      double lf_weight_y = lf_y_s - n_y_s;
-
-      double lf_new_gray = (1 - lf_weight_y) * ((1 - lf_weight_x) * src_im[n_y_s * src_width + n_x_s] +
-        lf_weight_x * src_im[n_y_s * src_width + n_x_s + 1]) +
-        lf_weight_y * ((1 - lf_weight_x) * src_im[(n_y_s + 1) * src_width + n_x_s] +
-        lf_weight_x * src_im[(n_y_s + 1) * src_width + n_x_s + 1]);
-
-      dst_im[n_y_d * dst_width + n_x_d] = (unsigned char)(lf_new_gray);
-    }
+  int layer = stage - kProfileLayer;
+  std::ostringstream name;
+  if (layer < lan1_size_ - 1)
+  {
+    name << "lan1_layer" << layer + 1;
   }
-  return true;
+  else
+  {
+    name << "lan2_layer" << layer - (lan1_size_ - 1) + 1;
+  }
+  return name.str();
 }
 
-
+/** Reset the times of the stages to zero.
+  */
+void CCFAN::ResetProfile()
+{
+  for (int i = 0; i < kMaxProfileStage; i++)
+  {
+    profile_time_[i] = 0;
+  }
+}
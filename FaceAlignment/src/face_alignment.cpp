@@ -31,6 +31,7 @@
 
 #include "face_alignment.h"
 
+#include <algorithm>
 #include <string>
 #include <math.h>
 #include "cfan.h"
@@ -60,8 +61,8 @@ namespace seeta {
     if (gray_im.num_channels != 1) {
       return false;
     }
-    int pts_num = 5;
-    float *facial_loc = new float[pts_num * 2];
+    const int pts_num = 5;
+    float facial_loc[pts_num * 2];
     facial_detector->FacialPointLocate(gray_im.data, gray_im.width, gray_im.height, face_info, facial_loc);
 
     for (int i = 0; i < pts_num; i++) {
@@ -69,7 +70,70 @@ namespace seeta {
       points[i].y = facial_loc[i * 2 + 1];
     }
 
-    delete[]facial_loc;
+    return true;
+  }
+
+  /** Detect five facial landmarks of several faces, running the networks on batches
+   *  of faces so that their weights are loaded once per batch rather than per face.
+   *  @param gray_im A grayscale image
+   *  @param face_infos The face bounding boxes
+   *  @param[out] points The locations of detected facial points, five per face in
+   *  the order of the faces
+   */
+  bool FaceAlignment::PointDetectLandmarks(ImageData gray_im, const std::vector<FaceInfo> & face_infos, FacialLandmark *points)
+  {
+    if (gray_im.num_channels != 1) {
+      return false;
+    }
+    const int pts_num = 5;
+    float facial_loc[CCFAN::kMaxBatchSize * pts_num * 2];
+    int face_num = static_cast<int>(face_infos.size());
+    for (int n = 0; n < face_num; n += CCFAN::kMaxBatchSize) {
+      int batch_size = std::min(face_num - n, int(CCFAN::kMaxBatchSize));
+      facial_detector->FacialPointLocate(gray_im.data, gray_im.width, gray_im.height, &face_infos[n], batch_size, facial_loc);
+
+      for (int i = 0; i < batch_size * pts_num; i++) {
+        points[n * pts_num + i].x = facial_loc[i * 2];
+        points[n * pts_num + i].y = facial_loc[i * 2 + 1];
+      }
+    }
+
+    return true;
+  }
+
+  /** Set the number of networks run by PointDetectLandmarks, 1 or 2 (the default).
+   *  @param level The refinement level
+   */
+  void FaceAlignment::SetRefinementLevel(int level)
+  {
+    if (level == 1 || level == 2) {
+      facial_detector->SetRefinementLevel(level);
+    }
+  }
+
+  /** Track five facial landmarks in a video from their locations in the previous frame.
+   *  @param gray_im A grayscale image
+   *  @param face_info The face bounding box in the current frame
+   *  @param[in,out] track The track of the face, whose points are updated
+   *  @param[out] drift If not NULL, the drift of the points relative to the face size
+   */
+  bool FaceAlignment::TrackLandmarks(ImageData gray_im, FaceInfo face_info, LandmarkTrack *track, float *drift)
+  {
+    if (gray_im.num_channels != 1) {
+      return false;
+    }
+    const int pts_num = 5;
+    float facial_loc[pts_num * 2];
+    float point_drift = facial_detector->FacialPointTrack(gray_im.data, gray_im.width, gray_im.height, face_info, track->shape, track->offset, &track->frames, facial_loc);
+
+    for (int i = 0; i < pts_num; i++) {
+      track->points[i].x = facial_loc[i * 2];
+      track->points[i].y = facial_loc[i * 2 + 1];
+    }
+    if (drift != NULL) {
+      *drift = point_drift;
+    }
+
     return true;
   }
 
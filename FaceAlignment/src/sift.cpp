@@ -33,28 +33,109 @@
 #include "sift.h"
 #include <string.h>
 
+#if defined(USE_AVX2) || defined(USE_SSE)
+#include <immintrin.h>
+#endif
+
 #define pi 3.1415926
-double SIFT::delta_gauss_x[25] = 
-{0.0284161904936934,0.0260724940559495,0,-0.0260724940559495,-0.0284161904936934,
-0.127352530356230,0.116848811647003,0,-0.116848811647003,-0.127352530356230,
-0.209968825675801,0.192651121218447,0,-0.192651121218447,-0.209968825675801,
-0.127352530356230,0.116848811647003,0,-0.116848811647003,-0.127352530356230,
-0.0284161904936934,0.0260724940559495,0,-0.0260724940559495,-0.0284161904936934};
-
-double SIFT::delta_gauss_y[25] = 
-{0.0284161904936934,0.127352530356230,0.209968825675801,0.127352530356230,0.0284161904936934,
-0.0260724940559495,0.116848811647003,0.192651121218447,0.116848811647003,0.0260724940559495,
-0,0,0,0,0,
--0.0260724940559495,-0.116848811647003,-0.192651121218447,-0.116848811647003,-0.0260724940559495,
--0.0284161904936934,-0.127352530356230,-0.209968825675801,-0.127352530356230,-0.0284161904936934};
+
+/*The 5x5 derivative of Gaussian filter along X is the outer product of
+  gauss_weight (rows) and delta_weight (columns), and the one along Y its transpose*/
+const float SIFT::gauss_weight[5] =
+{0.0284161904936934f, 0.127352530356230f, 0.209968825675801f, 0.127352530356230f, 0.0284161904936934f};
+
+const float SIFT::delta_weight[5] =
+{1.0f, 0.917522496962988f, 0.0f, -0.917522496962988f, -1.0f};
+
+const float SIFT::cos_array[8] =
+{1.0f, 0.7071f, 0.0f, -0.7071f, -1.0f, -0.7071f, 0.0f, 0.7071f};
+
+const float SIFT::sin_array[8] =
+{0.0f, 0.7071f, 1.0f, 0.7071f, 0.0f, -0.7071f, -1.0f, -0.7071f};
+
+/** Weighted sum of five rows: dst[j] = sum_k weight[k] * src[k][j]
+ */
+static inline void WeightedSum5(const float* const* src, const float* weight, float* dst, int len)
+{
+  const float* src0 = src[0];
+  const float* src1 = src[1];
+  const float* src2 = src[2];
+  const float* src3 = src[3];
+  const float* src4 = src[4];
+  int j = 0;
+#ifdef USE_AVX2
+  __m256 w0 = _mm256_set1_ps(weight[0]);
+  __m256 w1 = _mm256_set1_ps(weight[1]);
+  __m256 w2 = _mm256_set1_ps(weight[2]);
+  __m256 w3 = _mm256_set1_ps(weight[3]);
+  __m256 w4 = _mm256_set1_ps(weight[4]);
+  for (; j + 8 <= len; j += 8)
+  {
+    __m256 sum = _mm256_mul_ps(w0, _mm256_loadu_ps(src0 + j));
+    sum = _mm256_add_ps(sum, _mm256_mul_ps(w1, _mm256_loadu_ps(src1 + j)));
+    sum = _mm256_add_ps(sum, _mm256_mul_ps(w2, _mm256_loadu_ps(src2 + j)));
+    sum = _mm256_add_ps(sum, _mm256_mul_ps(w3, _mm256_loadu_ps(src3 + j)));
+    sum = _mm256_add_ps(sum, _mm256_mul_ps(w4, _mm256_loadu_ps(src4 + j)));
+    _mm256_storeu_ps(dst + j, sum);
+  }
+#endif
+#if defined(USE_AVX2) || defined(USE_SSE)
+  __m128 v0 = _mm_set1_ps(weight[0]);
+  __m128 v1 = _mm_set1_ps(weight[1]);
+  __m128 v2 = _mm_set1_ps(weight[2]);
+  __m128 v3 = _mm_set1_ps(weight[3]);
+  __m128 v4 = _mm_set1_ps(weight[4]);
+  for (; j + 4 <= len; j += 4)
+  {
+    __m128 sum = _mm_mul_ps(v0, _mm_loadu_ps(src0 + j));
+    sum = _mm_add_ps(sum, _mm_mul_ps(v1, _mm_loadu_ps(src1 + j)));
+    sum = _mm_add_ps(sum, _mm_mul_ps(v2, _mm_loadu_ps(src2 + j)));
+    sum = _mm_add_ps(sum, _mm_mul_ps(v3, _mm_loadu_ps(src3 + j)));
+    sum = _mm_add_ps(sum, _mm_mul_ps(v4, _mm_loadu_ps(src4 + j)));
+    _mm_storeu_ps(dst + j, sum);
+  }
+#endif
+  float s0 = weight[0], s1 = weight[1], s2 = weight[2], s3 = weight[3], s4 = weight[4];
+  for (; j < len; j++)
+  {
+    dst[j] = s0 * src0[j] + s1 * src1[j] + s2 * src2[j] + s3 * src3[j] + s4 * src4[j];
+  }
+}
 
 SIFT::SIFT(void)
 {
+  lf_gray_im_ = NULL;
+  gray_img_ex_ = NULL;
+  filter_tmp_ = NULL;
+  im_vert_edge_ = NULL;
+  im_hori_edge_ = NULL;
+  im_orientation_ = NULL;
+  conv_im_ = NULL;
+  conv_tmp_ = NULL;
+  conv_weight_ = NULL;
+  conv_weight_begin_ = 0;
+  conv_weight_end_ = 0;
 }
 
 
 SIFT::~SIFT(void)
 {
+  ReleaseBuffers();
+}
+
+/** Release the buffers allocated by InitSIFT.
+ */
+void SIFT::ReleaseBuffers()
+{
+  delete[] lf_gray_im_;
+  delete[] gray_img_ex_;
+  delete[] filter_tmp_;
+  delete[] im_vert_edge_;
+  delete[] im_hori_edge_;
+  delete[] im_orientation_;
+  delete[] conv_im_;
+  delete[] conv_tmp_;
+  delete[] conv_weight_;
 }
 
 /** Initialize the SIFT extractor.
@@ -83,211 +164,240 @@ void SIFT::InitSIFT(int im_width, int im_height, int patch_size, int grid_spacin
   param.filter_size = 5;
   param.sigma = 1;
   param.alpha = 3;	
+
+  param.sample_cnt_width = (param.image_width + param.sample_pixel - 1) / param.sample_pixel;
+  param.sample_cnt_height = (param.image_height + param.sample_pixel - 1) / param.sample_pixel;
+
+  ReleaseBuffers();
+  int pad_size = (param.filter_size - 1) / 2;
+  lf_gray_im_ = new float[param.image_pixel];
+  gray_img_ex_ = new float[(param.image_width + 2 * pad_size) * (param.image_height + 2 * pad_size)];
+  filter_tmp_ = new float[2 * param.image_width * (param.image_height + 2 * pad_size)];
+  im_vert_edge_ = new float[param.image_pixel];
+  im_hori_edge_ = new float[param.image_pixel];
+  im_orientation_ = new float[param.image_pixel * param.angle_nums];
+  conv_im_ = new float[param.sample_cnt_width * param.sample_cnt_height * param.angle_nums];
+
+  conv_tmp_ = new float[param.image_height * param.sample_cnt_width * param.angle_nums];
+
+  // The kernel of ConvImage is the outer product of conv_weight_ with itself
+  conv_weight_ = new float[param.patch_size];
+
+  // The distance to the center is truncated to an integer, as the original code
+  // did by calling abs(int), which makes the weights a box of 2 * sample_pixel
+  // rather than bilinear ones; kept for the features the model expects.
+  for(int k = 0; k < param.patch_size; k++)
+  {
+	  double weight = abs(int(k - double(param.patch_size - 1)/2))/(param.sample_pixel);
+
+	  if(weight <= 1)
+		  conv_weight_[k] = float(1 - weight);
+	  else
+		  conv_weight_[k] = 0;
+  }
+
+  // Only the nonzero weights are used
+  conv_weight_begin_ = 0;
+  while (conv_weight_begin_ < param.patch_size && conv_weight_[conv_weight_begin_] == 0)
+	  conv_weight_begin_++;
+  conv_weight_end_ = param.patch_size;
+  while (conv_weight_end_ > conv_weight_begin_ && conv_weight_[conv_weight_end_ - 1] == 0)
+	  conv_weight_end_--;
 }
 
-/** Implement convolutional function "filter2" same in Matlab.
- *  @param gray_im A grayscale image
- *  @param kernel A convolutional kernel
- *  @param kernel_size The size of convolutional kernel
- *  @param[out] filter_im The output image map after convolution
+/** Compute the gradients with the separable derivative of Gaussian filters.
+ *  @param gray_im A normalized grayscale image
+ *  @param[out] im_vert_edge The gradient along X (vertical edges)
+ *  @param[out] im_hori_edge The gradient along Y (horizontal edges)
  */
-void SIFT::filter2(double* gray_im, double* kernel, int kernel_size, double* filter_im)
+void SIFT::GradientFilter(const float* gray_im, float* im_vert_edge, float* im_hori_edge)
 {
+  int pad_size = (param.filter_size - 1) / 2;
+  int ex_width = param.image_width + 2 * pad_size;
+  int ex_height = param.image_height + 2 * pad_size;
+
   // Padding the image
-  int pad_size = (kernel_size - 1) / 2;
-  double* gray_img_ex = new double[(param.image_width + (kernel_size - 1)) * (param.image_height + (kernel_size - 1))];
-	
-  for(int i = 0; i < pad_size; i++)
+  memset(gray_img_ex_, 0, ex_width * ex_height * sizeof(float));
+  for (int i = 0; i < param.image_height; i++)
   {
-	  for (int j = 0; j < param.image_width + (kernel_size - 1); j++)
-	  {
-		  gray_img_ex[i * (param.image_width + (kernel_size - 1)) + j] = 0;
-	  }
+	  memcpy(gray_img_ex_ + (i + pad_size) * ex_width + pad_size, gray_im + i * param.image_width, param.image_width * sizeof(float));
   }
 
-  for (int i = param.image_height + pad_size; i < param.image_height + (kernel_size - 1); i++)
+  // Filtering along rows, with the derivative for X and the Gaussian for Y
+  float* delta_rows = filter_tmp_;
+  float* gauss_rows = filter_tmp_ + param.image_width * ex_height;
+  const float* src[5];
+  for (int i = 0; i < ex_height; i++)
   {
-	  for (int j = 0; j < param.image_width + (kernel_size - 1); j++)
+	  for (int k = 0; k < 5; k++)
 	  {
-		  gray_img_ex[i * (param.image_width + (kernel_size - 1)) + j] = 0;
+		  src[k] = gray_img_ex_ + i * ex_width + k;
 	  }
+	  WeightedSum5(src, delta_weight, delta_rows + i * param.image_width, param.image_width);
+	  WeightedSum5(src, gauss_weight, gauss_rows + i * param.image_width, param.image_width);
   }
 
-  for(int i = pad_size; i < param.image_height + pad_size; i++)
+  // Filtering along columns, with the Gaussian for X and the derivative for Y
+  for (int i = 0; i < param.image_height; i++)
   {
-	  for(int j = 0; j < pad_size; j++)
-	  {
-		  gray_img_ex[i * (param.image_width + (kernel_size - 1)) + j] = 0;
-	  }
-	  for (int j = param.image_width + pad_size; j < param.image_width + (kernel_size - 1); j++)
+	  for (int k = 0; k < 5; k++)
 	  {
-		  gray_img_ex[i * (param.image_width + (kernel_size - 1)) + j] = 0;
+		  src[k] = delta_rows + (i + k) * param.image_width;
 	  }
-	  for(int j = pad_size; j < param.image_width + pad_size; j++)
+	  WeightedSum5(src, gauss_weight, im_vert_edge + i * param.image_width, param.image_width);
+	  for (int k = 0; k < 5; k++)
 	  {
-		  gray_img_ex[i * (param.image_width + (kernel_size - 1)) + j] = gray_im[(i - pad_size) * param.image_width + (j - pad_size)];
+		  src[k] = gauss_rows + (i + k) * param.image_width;
 	  }
+	  WeightedSum5(src, delta_weight, im_hori_edge + i * param.image_width, param.image_width);
   }
-
-  // Sliding filter on padding image
-  for(int i = 0; i < param.image_height; i++)
-  {
-	  for(int j = 0; j < param.image_width; j++)
-	  {
-		  double tmp = 0.000000;
-
-		  for (int ki = 0; ki < kernel_size; ki++)
-		  {
-			  for (int kj = 0; kj < kernel_size; kj++)
-			  {
-				  double tmp1 = gray_img_ex[(i + ki) * (param.image_width + (kernel_size - 1)) + (j + kj)];
-				  tmp += tmp1 * kernel[ki * kernel_size + kj];
-			  }
-		  }
-		  filter_im[i * param.image_width + j] = tmp;
-	  }
-  }
-  delete [] gray_img_ex;
 }
 
-/** Sparse convolution for speed-up
- *  @param gray_im A grayscale image
- *  @param kernel A convolutional kernel
- *  @param kernel_size The size of convolutional kernel
- *  @param[out] filter_im The output image map after sparse convolution
+/** Calculate image orientation: for each pixel and angle, the cube of the positive
+ *  part of the cosine between the gradient and the angle, times the magnitude, i.e.
+ *  max(dx * cos + dy * sin, 0)^3 / magnitude^2.
+ *  @param im_vert_edge The gradient along X
+ *  @param im_hori_edge The gradient along Y
+ *  @param[out] image_orientation The output image orientation
  */
-void SIFT::SparseFilter2(double* gray_im, double* kernel, int kernel_size, double* filter_im)
+void SIFT::ImageOrientation(const float* im_vert_edge, const float* im_hori_edge, float* image_orientation)
 {
-  // Padding the image
-  int pad_size = (kernel_size-1)/2;
-  double* gray_img_ex = new double[(param.image_width + (kernel_size-1)) * (param.image_height + (kernel_size-1))];
-	
-  for(int i = 0; i < pad_size; i++)
+#ifdef USE_AVX2
+  __m256 cos_val = _mm256_loadu_ps(cos_array);
+  __m256 sin_val = _mm256_loadu_ps(sin_array);
+  __m256 zero = _mm256_setzero_ps();
+#elif defined(USE_SSE)
+  __m128 cos_val[2] = { _mm_loadu_ps(cos_array), _mm_loadu_ps(cos_array + 4) };
+  __m128 sin_val[2] = { _mm_loadu_ps(sin_array), _mm_loadu_ps(sin_array + 4) };
+  __m128 zero = _mm_setzero_ps();
+#endif
+
+  for (int pt = 0; pt < param.image_pixel; pt++)
   {
-	  for(int j = 0; j < param.image_width + (kernel_size-1); j++)
+	  float dx = im_vert_edge[pt];
+	  float dy = im_hori_edge[pt];
+	  float magnitude2 = dx * dx + dy * dy;
+	  float inv_magnitude2 = (magnitude2 > 0 ? 1.0f / magnitude2 : 0.0f);
+	  float* dest = image_orientation + pt * 8;
+#ifdef USE_AVX2
+	  __m256 val = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(dx), cos_val), _mm256_mul_ps(_mm256_set1_ps(dy), sin_val));
+	  val = _mm256_max_ps(val, zero);
+	  val = _mm256_mul_ps(_mm256_mul_ps(val, val), _mm256_mul_ps(val, _mm256_set1_ps(inv_magnitude2)));
+	  _mm256_storeu_ps(dest, val);
+#elif defined(USE_SSE)
+	  for (int h = 0; h < 2; h++)
 	  {
-		  gray_img_ex[i * (param.image_width + (kernel_size-1)) + j] = 0;
+		  __m128 val = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(dx), cos_val[h]), _mm_mul_ps(_mm_set1_ps(dy), sin_val[h]));
+		  val = _mm_max_ps(val, zero);
+		  val = _mm_mul_ps(_mm_mul_ps(val, val), _mm_mul_ps(val, _mm_set1_ps(inv_magnitude2)));
+		  _mm_storeu_ps(dest + h * 4, val);
 	  }
-  }
-
-  for(int i = param.image_height + pad_size; i < param.image_height + (kernel_size-1); i++)
-  {
-	  for(int j = 0; j < param.image_width + (kernel_size-1); j++)
+#else
+	  for (int index = 0; index < 8; index++)
 	  {
-		  gray_img_ex[i * (param.image_width + (kernel_size-1)) + j] = 0;
+		  float val = dx * cos_array[index] + dy * sin_array[index];
+		  val = (val > 0 ? val : 0);
+		  dest[index] = val * val * (val * inv_magnitude2);
 	  }
+#endif
   }
+}
 
-  for(int i = pad_size; i < param.image_height + pad_size; i++)
+/** Weighted sum of the angle bins of len points: dst[b] = sum_k weight[k] * src[k * stride + b]
+ */
+static inline void WeightedSumBins(const float* src, int stride, const float* weight, int len, float* dst)
+{
+#ifdef USE_AVX2
+  __m256 sum = _mm256_setzero_ps();
+  for (int k = 0; k < len; k++)
   {
-	  for(int j = 0; j < pad_size; j++)
-	  {
-		  gray_img_ex[i * (param.image_width + (kernel_size-1)) + j] = 0;
-	  }
-	  for(int j = param.image_width + pad_size; j < param.image_width + (kernel_size-1); j++) 
-	  {
-		  gray_img_ex[i * (param.image_width + (kernel_size-1)) + j] = 0;
-	  }
-	  for(int j = pad_size; j < param.image_width + pad_size; j++)
-	  {
-		  gray_img_ex[i * (param.image_width + (kernel_size - 1)) + j] = gray_im[(i - pad_size) * param.image_width + (j - pad_size)];
-	  }
+	  sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(weight[k]), _mm256_loadu_ps(src + k * stride)));
   }
-
-  // Sliding filter on padding image
-  for(int i = 0; i < param.image_height; i += param.sample_pixel)
+  _mm256_storeu_ps(dst, sum);
+#elif defined(USE_SSE)
+  __m128 sum[2] = { _mm_setzero_ps(), _mm_setzero_ps() };
+  for (int k = 0; k < len; k++)
+  {
+	  __m128 w = _mm_set1_ps(weight[k]);
+	  sum[0] = _mm_add_ps(sum[0], _mm_mul_ps(w, _mm_loadu_ps(src + k * stride)));
+	  sum[1] = _mm_add_ps(sum[1], _mm_mul_ps(w, _mm_loadu_ps(src + k * stride + 4)));
+  }
+  _mm_storeu_ps(dst, sum[0]);
+  _mm_storeu_ps(dst + 4, sum[1]);
+#else
+  float sum[8] = { 0 };
+  for (int k = 0; k < len; k++)
   {
-	  for(int j = 0; j < param.image_width; j += param.sample_pixel)
+	  for (int index = 0; index < 8; index++)
 	  {
-		  double tmp = 0.000000;
-
-		  for(int ki = 0; ki < kernel_size; ki++)
-		  {
-			  for(int kj = 0; kj < kernel_size; kj++)
-			  {
-				  double tmp1 = gray_img_ex[(i + ki) * (param.image_width + (kernel_size - 1)) + (j + kj)];
-				  tmp += tmp1 * kernel[ki * kernel_size + kj];
-			  }
-		  }
-		  filter_im[i * param.image_width + j] = tmp;
+		  sum[index] += weight[k] * src[k * stride + index];
 	  }
   }
-  delete [] gray_img_ex;
+  memcpy(dst, sum, 8 * sizeof(float));
+#endif
 }
 
-/** Calculate image orientation
+/** Convolve the image orientation with the weighting kernel at the sample points.
+ *  The kernel is separable, so each row is first pooled at the sample columns and
+ *  the pooled rows are then pooled at the sample rows.
  *  @param image_orientation A image orientation map
- *  @param[out] conv_im The output convolutional image
+ *  @param[out] conv_im The output convolutional image at the sample points
  */
-void SIFT::ConvImage(double* image_orientation, double* conv_im)
+void SIFT::ConvImage(const float* image_orientation, float* conv_im)
 {
-  double* weight = new double[param.patch_size];
-  double* kernel = new double[param.patch_size * param.patch_size];
+  int pad_size = (param.patch_size - 1) / 2;
+  int row_stride = param.sample_cnt_width * 8;
 
-  for(int k = 0; k < param.patch_size; k++)
+  // Pooling along rows, for all rows and the sample columns
+  for (int sj = 0; sj < param.sample_cnt_width; sj++)
   {
-	  weight[k] = abs(k - double(param.patch_size - 1)/2)/(param.sample_pixel);
-
-	  if(weight[k] <= 1)
-		  weight[k] = 1 - weight[k];
-	  else
-		  weight[k] = 0;
-  }
-
-  for(int i = 0; i < param.patch_size; i++)
-  {
-	  for(int j = 0; j < param.patch_size; j++)
+	  int j = sj * param.sample_pixel;
+	  int k_begin = (pad_size - j > conv_weight_begin_ ? pad_size - j : conv_weight_begin_);
+	  int k_end = (param.image_width + pad_size - j < conv_weight_end_ ? param.image_width + pad_size - j : conv_weight_end_);
+	  for (int i = 0; i < param.image_height; i++)
 	  {
-		  kernel[i * param.patch_size + j] = weight[i] * weight[j];
+		  const float* src = image_orientation + (i * param.image_width + j + k_begin - pad_size) * 8;
+		  WeightedSumBins(src, 8, conv_weight_ + k_begin, k_end - k_begin, conv_tmp_ + i * row_stride + sj * 8);
 	  }
   }
 
-  double* angle_im = new double[param.image_pixel];
-  double* angle_conv_im = new double[param.image_pixel];
-
-  for(int index = 0; index < param.angle_nums; index++)
+  // Pooling along columns, for the sample rows
+  for (int si = 0; si < param.sample_cnt_height; si++)
   {
-	  memset(angle_im, 0, param.image_pixel * sizeof(double));
-	  memcpy(angle_im, &image_orientation[index * param.image_pixel], param.image_pixel * sizeof(double));
-	  SparseFilter2(angle_im, kernel, param.patch_size, angle_conv_im);
-	  memcpy(&conv_im[index * param.image_pixel], angle_conv_im, param.image_pixel * sizeof(double));
+	  int i = si * param.sample_pixel;
+	  int k_begin = (pad_size - i > conv_weight_begin_ ? pad_size - i : conv_weight_begin_);
+	  int k_end = (param.image_height + pad_size - i < conv_weight_end_ ? param.image_height + pad_size - i : conv_weight_end_);
+	  for (int sj = 0; sj < param.sample_cnt_width; sj++)
+	  {
+		  const float* src = conv_tmp_ + (i + k_begin - pad_size) * row_stride + sj * 8;
+		  WeightedSumBins(src, row_stride, conv_weight_ + k_begin, k_end - k_begin, conv_im + (si * param.sample_cnt_width + sj) * 8);
+	  }
   }
-	
-  delete [] weight;
-  delete [] kernel;
-  delete [] angle_im;
-  delete [] angle_conv_im;
 }
 
 /** Compute SIFT feature
  *  @param gray_im A grayscale image
  *  @param[out] sift_feature The output SIFT feature
  */
-void SIFT::CalcSIFT(BYTE* gray_im, double* sift_feature)
+void SIFT::CalcSIFT(BYTE* gray_im, float* sift_feature)
 {
-  double* lf_gray_im = new double[param.image_pixel];
-  double max = 0.000001;
+  BYTE max_gray = 0;
   for (int pt = 0; pt < param.image_pixel; pt++)
   {
-	  lf_gray_im[pt] = gray_im[pt];
-	  if (lf_gray_im[pt] > max)
-		  max = lf_gray_im[pt];
+	  if (gray_im[pt] > max_gray)
+		  max_gray = gray_im[pt];
   }
-
+  float inv_max = (max_gray > 0 ? 1.0f / max_gray : 1.0f);
   for (int pt = 0; pt < param.image_pixel; pt++)
   {
-	  lf_gray_im[pt] = lf_gray_im[pt] / max;
+	  lf_gray_im_[pt] = gray_im[pt] * inv_max;
   }
 
-  double* im_orientation = new double[param.image_pixel * param.angle_nums];
-  double* conv_im = new double[param.image_pixel * param.angle_nums];
-  memset(conv_im, 0, param.image_pixel * param.angle_nums * sizeof(double));
-
-  ImageOrientation(lf_gray_im, im_orientation);
-  ConvImage(im_orientation, conv_im);
+  GradientFilter(lf_gray_im_, im_vert_edge_, im_hori_edge_);
+  ImageOrientation(im_vert_edge_, im_hori_edge_, im_orientation_);
+  ConvImage(im_orientation_, conv_im_);
 
   // Generate denseSIFT feature vector
-  double* patch_feature = new double[param.patch_dims];
   int patch_cnt = 0;
 
   // Sliding windows on overlapping patches. (px,py) are centroids
@@ -295,112 +405,72 @@ void SIFT::CalcSIFT(BYTE* gray_im, double* sift_feature)
   {
 	  for (int location_y = param.patch_size / 2; location_y <= param.image_width - (param.patch_size / 2); location_y += param.grid_spacing)
 	  {
-		  memset(patch_feature, 0, param.patch_dims * sizeof(double));
-
-		  double l2_norm = 0.000001;
-		  int Point_cnt = 0;
+		  float* patch_feature = sift_feature + patch_cnt * param.patch_dims;
+		  int point_cnt = 0;
 
+		  // The sample points are taken down each column first
 		  for (int p_x = -param.patch_size / 2; p_x <= param.patch_size / 2 - param.sample_pixel; p_x += param.sample_pixel)
 		  {
 			  for (int p_y = -param.patch_size / 2; p_y <= param.patch_size / 2 - param.sample_pixel; p_y += param.sample_pixel)
 			  {
-				  int i = location_x + p_x;
-				  int j = location_y + p_y;
-
-				  for (int index = 0; index < param.angle_nums; index++)
-				  {
-					  patch_feature[Point_cnt] = conv_im[index * param.image_pixel + j * param.image_height + i];
-					  l2_norm += pow(patch_feature[Point_cnt], 2);
-					  Point_cnt += 1;
-				  }
+				  int i = (location_y + p_y) / param.sample_pixel;
+				  int j = (location_x + p_x) / param.sample_pixel;
+				  memcpy(patch_feature + point_cnt, conv_im_ + (i * param.sample_cnt_width + j) * 8, 8 * sizeof(float));
+				  point_cnt += 8;
 			  }
 		  }
+
 		  // Patch-wise L2-norm
-		  double norm = 1.0 / sqrt(l2_norm);
-		  for (int pt = 0; pt < param.patch_dims; pt++)
+		  int pt = 0;
+		  float l2_norm = 0.000001f;
+#ifdef USE_AVX2
+		  __m256 sum = _mm256_setzero_ps();
+		  for (; pt + 8 <= param.patch_dims; pt += 8)
+		  {
+			  __m256 val = _mm256_loadu_ps(patch_feature + pt);
+			  sum = _mm256_add_ps(sum, _mm256_mul_ps(val, val));
+		  }
+		  __m128 sum4 = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+		  sum4 = _mm_hadd_ps(sum4, sum4);
+		  sum4 = _mm_hadd_ps(sum4, sum4);
+		  l2_norm += _mm_cvtss_f32(sum4);
+#elif defined(USE_SSE)
+		  __m128 sum = _mm_setzero_ps();
+		  for (; pt + 4 <= param.patch_dims; pt += 4)
+		  {
+			  __m128 val = _mm_loadu_ps(patch_feature + pt);
+			  sum = _mm_add_ps(sum, _mm_mul_ps(val, val));
+		  }
+		  sum = _mm_hadd_ps(sum, sum);
+		  sum = _mm_hadd_ps(sum, sum);
+		  l2_norm += _mm_cvtss_f32(sum);
+#endif
+		  for (; pt < param.patch_dims; pt++)
+		  {
+			  l2_norm += patch_feature[pt] * patch_feature[pt];
+		  }
+
+		  float norm = 1.0f / sqrt(l2_norm);
+		  pt = 0;
+#ifdef USE_AVX2
+		  __m256 norm_val = _mm256_set1_ps(norm);
+		  for (; pt + 8 <= param.patch_dims; pt += 8)
+		  {
+			  _mm256_storeu_ps(patch_feature + pt, _mm256_mul_ps(_mm256_loadu_ps(patch_feature + pt), norm_val));
+		  }
+#elif defined(USE_SSE)
+		  __m128 norm_val = _mm_set1_ps(norm);
+		  for (; pt + 4 <= param.patch_dims; pt += 4)
+		  {
+			  _mm_storeu_ps(patch_feature + pt, _mm_mul_ps(_mm_loadu_ps(patch_feature + pt), norm_val));
+		  }
+#endif
+		  for (; pt < param.patch_dims; pt++)
 		  {
 			  patch_feature[pt] = patch_feature[pt] * norm;
 		  }
 
-		  memcpy(&sift_feature[patch_cnt * param.patch_dims], patch_feature, param.patch_dims * sizeof(double));
 		  patch_cnt += 1;
 	  }
   }
-
-  delete[] lf_gray_im;
-  delete[] im_orientation;
-  delete[] conv_im;
-  delete[] patch_feature;
-}
-
-
-/** Calculate image orientation
- *  @param image_orientation A image orientation map
- *  @param[out] conv_im The output convolutional image
- */
-void SIFT::ImageOrientation(double* gray_im, double* image_orientation)
-{
-  double* im_vert_edge = new double[param.image_pixel];
-  double* im_hori_edge = new double[param.image_pixel];
-
-  filter2(gray_im, delta_gauss_x, param.filter_size, im_vert_edge);
-  filter2(gray_im, delta_gauss_y, param.filter_size, im_hori_edge);
-
-  double* im_magnitude = new double[param.image_pixel];
-  double* im_cos_theta = new double[param.image_pixel];
-  double* im_sin_theta = new double[param.image_pixel];
-
-  for (int i = 0; i < param.image_height; i++)
-  {
-	  for (int j = 0; j < param.image_width; j++)
-	  {
-		  double tmpV = im_vert_edge[i * param.image_width + j];
-		  double tmpH = im_hori_edge[i * param.image_width + j];
-		  double tmpMagnitude = sqrt(pow(tmpV, 2) + pow(tmpH, 2));
-		  im_magnitude[i * param.image_width + j] = tmpMagnitude;
-		  im_cos_theta[i * param.image_width + j] = tmpV / tmpMagnitude;
-		  im_sin_theta[i * param.image_width + j] = tmpH / tmpMagnitude;
-	  }
-  }
-
-  delete[] im_vert_edge;
-  delete[] im_hori_edge;
-
-  double cos_array[8];
-  double sin_array[8];
-  cos_array[0] = 1.0;
-  cos_array[1] = 0.7071;
-  cos_array[2] = 0.0;
-  cos_array[3] = -0.7071;
-  cos_array[4] = -1.0;
-  cos_array[5] = -0.7071;
-  cos_array[6] = 0.0;
-  cos_array[7] = 0.7071;
-
-  sin_array[0] = 0.0;
-  sin_array[1] = 0.7071;
-  sin_array[2] = 1.0;
-  sin_array[3] = 0.7071;
-  sin_array[4] = 0.0;
-  sin_array[5] = -0.7071;
-  sin_array[6] = -1.0;
-  sin_array[7] = -0.7071;
-  for (int index = 0; index < param.angle_nums; index++)
-  {
-	  for (int pt = 0; pt < param.image_pixel; pt++)
-	  {
-		  double tmp1 = im_cos_theta[pt] * cos_array[index] + im_sin_theta[pt] * sin_array[index];
-		  double tmp = pow(tmp1,3);
-
-		  if (tmp > 0)
-			  tmp = tmp;
-		  else
-			  tmp = 0;
-		  image_orientation[index * param.image_pixel + pt] = tmp * im_magnitude[pt];
-	  }
-  }
-
-  delete[] im_magnitude;
-  delete[] im_cos_theta;
-  delete[] im_sin_theta;
 }
@@ -0,0 +1,374 @@
+/*
+ *
+ * This file is part of the open-source SeetaFace engine, which includes three modules:
+ * SeetaFace Detection, SeetaFace Alignment, and SeetaFace Identification.
+ *
+ * This file benchmarks SeetaFace Alignment on faces of several sizes and times its
+ * stages. The face alignment method is described in the following paper:
+ *
+ *
+ *   Coarse-to-Fine Auto-Encoder Networks (CFAN) for Real-Time Face Alignment, 
+ *   Jie Zhang, Shiguang Shan, Meina Kan, Xilin Chen. In Proceeding of the
+ *   European Conference on Computer Vision (ECCV), 2014
+ *
+ *
+ * Copyright (C) 2016, Visual Information Processing and Learning (VIPL) group,
+ * Institute of Computing Technology, Chinese Academy of Sciences, Beijing, China.
+ *
+ * The codes are mainly developed by Jie Zhang (a Ph.D supervised by Prof. Shiguang Shan)
+ *
+ * As an open-source face recognition engine: you can redistribute SeetaFace source codes
+ * and/or modify it under the terms of the BSD 2-Clause License.
+ *
+ * You should have received a copy of the BSD 2-Clause License along with the software.
+ * If not, see < https://opensource.org/licenses/BSD-2-Clause>.
+ *
+ * Contact Info: you can send an email to SeetaFace@vipl.ict.ac.cn for any problems.
+ *
+ * Note: the above information must be kept whenever or wherever the codes are used.
+ *
+ */
+
+/*Benchmark of the landmark detector CCFAN, as run by PointDetectLandmarks, on synthetic
+  and PGM faces of several sizes. It is built from the sources with FA_PROFILE, to time
+  the stages of CCFAN, and uses the internal header only*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cfan.h"
+
+/*A grayscale image with one face in it*/
+struct BenchInput
+{
+  std::string name;
+  int width;
+  int height;
+  std::vector<unsigned char> data;
+  seeta::FaceInfo face;
+};
+
+/*The times of the calls of FacialPointLocate, in microseconds*/
+struct BenchResult
+{
+  std::vector<std::string> stage_names;
+  std::vector<std::vector<double> > stage_times;  /*Per stage, one time per call*/
+  std::vector<double> total_times;
+  double faces_per_sec;
+};
+
+/** Read a binary PGM (P5) image.
+  */
+static bool ReadPGM(const std::string & path, std::vector<unsigned char>* data, int* width, int* height)
+{
+  std::ifstream file(path.c_str(), std::ios::binary);
+  std::string magic;
+  int max_value;
+  if (!(file >> magic >> *width >> *height >> max_value) || magic != "P5" || max_value > 255)
+    return false;
+  file.get();
+  data->resize((*width) * (*height));
+  file.read(reinterpret_cast<char*>(data->data()), data->size());
+  return bool(file);
+}
+
+/** Make an image of a synthetic face, whose bounding box has the given size: a bright
+  * ellipse with dark eyes and mouth over a textured background.
+  */
+static BenchInput MakeSyntheticInput(int face_size)
+{
+  BenchInput input;
+  input.name = "synthetic";
+  input.width = face_size * 2;
+  input.height = face_size * 2;
+  input.data.resize(input.width * input.height);
+  double cx = input.width / 2.0;
+  double cy = input.height / 2.0;
+  double s = face_size / 100.0;
+  for (int i = 0; i < input.height; i++)
+  {
+    for (int j = 0; j < input.width; j++)
+    {
+      double x = (j - cx) / s;
+      double y = (i - cy) / s;
+      double gray = 60 + (i * 7 + j * 13 + (i * j) % 29) % 40;
+      if (x * x / (42.0 * 42.0) + y * y / (52.0 * 52.0) < 1)
+        gray = 180;
+      double eye_l = (x + 18) * (x + 18) + (y + 12) * (y + 12);
+      double eye_r = (x - 18) * (x - 18) + (y + 12) * (y + 12);
+      if (eye_l < 36 || eye_r < 36)
+        gray = 30;
+      if (fabs(x) < 16 && fabs(y - 24) < 3)
+        gray = 50;
+      if (fabs(x) < 3 && y > -4 && y < 10)
+        gray = 140;
+      input.data[i * input.width + j] = (unsigned char)gray;
+    }
+  }
+  input.face.bbox.x = face_size / 2;
+  input.face.bbox.y = face_size / 2;
+  input.face.bbox.width = face_size;
+  input.face.bbox.height = face_size;
+  input.face.score = 0;
+  return input;
+}
+
+/** Make an image of a face of a PGM image, resized by bilinear interpolation so that its
+  * bounding box has the given size, with half of the box as margin around it.
+  */
+static BenchInput MakePGMInput(const std::vector<unsigned char> & image, int width, int height,
+  const seeta::Rect & face, int face_size)
+{
+  BenchInput input;
+  input.name = "pgm";
+  input.width = face_size * 2;
+  input.height = face_size * 2;
+  input.data.resize(input.width * input.height);
+  double scale = double(face.width) / face_size;
+  double x0 = face.x - face.width / 2.0;
+  double y0 = face.y - face.height / 2.0;
+  for (int i = 0; i < input.height; i++)
+  {
+    for (int j = 0; j < input.width; j++)
+    {
+      double x = std::min(std::max(x0 + j * scale, 0.0), width - 1.0);
+      double y = std::min(std::max(y0 + i * scale, 0.0), height - 1.0);
+      int x1 = std::min(int(x), width - 2);
+      int y1 = std::min(int(y), height - 2);
+      double wx = x - x1;
+      double wy = y - y1;
+      const unsigned char* src = image.data() + y1 * width + x1;
+      double gray = (1 - wy) * ((1 - wx) * src[0] + wx * src[1]) + wy * ((1 - wx) * src[width] + wx * src[width + 1]);
+      input.data[i * input.width + j] = (unsigned char)(gray + 0.5);
+    }
+  }
+  input.face.bbox.x = face_size / 2;
+  input.face.bbox.y = face_size / 2;
+  input.face.bbox.width = face_size;
+  input.face.bbox.height = int(face.height / scale + 0.5);
+  input.face.score = 0;
+  return input;
+}
+
+/** Run FacialPointLocate round_num times on the input in each thread, with one CCFAN
+  * object per thread, recording the times of the calls and their stages.
+  */
+static BenchResult RunBench(const char* model_path, const BenchInput & input, int thread_num, int round_num)
+{
+  std::vector<BenchResult> thread_results(thread_num);
+  std::vector<CCFAN*> detectors(thread_num);
+  for (int t = 0; t < thread_num; t++)
+  {
+    detectors[t] = new CCFAN();
+    detectors[t]->InitModel(model_path);
+  }
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < thread_num; t++)
+  {
+    threads.push_back(std::thread([&, t]()
+    {
+      CCFAN* cfan = detectors[t];
+      BenchResult & result = thread_results[t];
+      int stage_num = cfan->ProfileStageNum();
+      result.stage_times.resize(stage_num);
+      float facial_loc[10];
+
+      /*Warm up the workspace and the caches*/
+      cfan->FacialPointLocate(input.data.data(), input.width, input.height, input.face, facial_loc);
+      for (int r = 0; r < round_num; r++)
+      {
+        cfan->ResetProfile();
+        std::chrono::steady_clock::time_point call_start = std::chrono::steady_clock::now();
+        cfan->FacialPointLocate(input.data.data(), input.width, input.height, input.face, facial_loc);
+        result.total_times.push_back(std::chrono::duration<double, std::micro>(
+          std::chrono::steady_clock::now() - call_start).count());
+        for (int i = 0; i < stage_num; i++)
+          result.stage_times[i].push_back(cfan->ProfileTime()[i]);
+      }
+    }));
+  }
+  for (int t = 0; t < thread_num; t++)
+    threads[t].join();
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  BenchResult result;
+  CCFAN* cfan = detectors[0];
+  for (int i = 0; i < cfan->ProfileStageNum(); i++)
+    result.stage_names.push_back(cfan->ProfileStageName(i));
+  result.stage_times.resize(result.stage_names.size());
+  for (int t = 0; t < thread_num; t++)
+  {
+    for (size_t i = 0; i < result.stage_names.size(); i++)
+    {
+      result.stage_times[i].insert(result.stage_times[i].end(),
+        thread_results[t].stage_times[i].begin(), thread_results[t].stage_times[i].end());
+    }
+    result.total_times.insert(result.total_times.end(),
+      thread_results[t].total_times.begin(), thread_results[t].total_times.end());
+    delete detectors[t];
+  }
+  result.faces_per_sec = thread_num * round_num / elapsed;
+  return result;
+}
+
+/** The p-th percentile of the times, by the nearest rank.
+  */
+static double Percentile(std::vector<double> times, double p)
+{
+  std::sort(times.begin(), times.end());
+  int rank = std::min(int(ceil(p / 100 * times.size())), int(times.size())) - 1;
+  return times[std::max(rank, 0)];
+}
+
+static const double kPercentiles[] = { 50, 90, 99 };
+static const int kPercentileNum = sizeof(kPercentiles) / sizeof(kPercentiles[0]);
+
+static void PrintResult(const BenchInput & input, int thread_num, const BenchResult & result)
+{
+  std::printf("%s, face %d, %d thread(s): %.0f faces/s\n", input.name.c_str(),
+    input.face.bbox.width, thread_num, result.faces_per_sec);
+  std::printf("  %-12s %9s %9s %9s (us)\n", "stage", "p50", "p90", "p99");
+  for (size_t i = 0; i < result.stage_names.size(); i++)
+  {
+    std::printf("  %-12s", result.stage_names[i].c_str());
+    for (int k = 0; k < kPercentileNum; k++)
+      std::printf(" %9.1f", Percentile(result.stage_times[i], kPercentiles[k]));
+    std::printf("\n");
+  }
+  std::printf("  %-12s", "total");
+  for (int k = 0; k < kPercentileNum; k++)
+    std::printf(" %9.1f", Percentile(result.total_times, kPercentiles[k]));
+  std::printf("\n");
+}
+
+static void WriteJsonPercentiles(std::ostream & out, const std::vector<double> & times)
+{
+  out << "{";
+  for (int k = 0; k < kPercentileNum; k++)
+  {
+    out << (k > 0 ? ", " : "") << "\"p" << kPercentiles[k] << "\": " << Percentile(times, kPercentiles[k]);
+  }
+  out << "}";
+}
+
+static void WriteJsonResult(std::ostream & out, const BenchInput & input, int thread_num,
+  const BenchResult & result)
+{
+  out << "    {\"input\": \"" << input.name << "\", \"face_size\": " << input.face.bbox.width
+    << ", \"threads\": " << thread_num << ", \"calls\": " << result.total_times.size()
+    << ", \"faces_per_sec\": " << result.faces_per_sec << ",\n      \"stages_us\": {";
+  for (size_t i = 0; i < result.stage_names.size(); i++)
+  {
+    out << (i > 0 ? ", " : "") << "\n        \"" << result.stage_names[i] << "\": ";
+    WriteJsonPercentiles(out, result.stage_times[i]);
+  }
+  out << "},\n      \"total_us\": ";
+  WriteJsonPercentiles(out, result.total_times);
+  out << "}";
+}
+
+int main(int argc, char** argv)
+{
+  if (argc < 2)
+  {
+    std::cout << "Usage: " << argv[0] << " model_path [--pgm image.pgm x y width] [--threads N]"
+      << " [--rounds N] [--json result.json]" << std::endl;
+    return -1;
+  }
+  const char* model_path = argv[1];
+  std::string pgm_path;
+  seeta::Rect pgm_face = { 0, 0, 0, 0 };
+  int thread_num = int(std::thread::hardware_concurrency());
+  int round_num = 200;
+  std::string json_path;
+  for (int i = 2; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    if (arg == "--pgm" && i + 4 < argc)
+    {
+      pgm_path = argv[i + 1];
+      pgm_face.x = atoi(argv[i + 2]);
+      pgm_face.y = atoi(argv[i + 3]);
+      pgm_face.width = pgm_face.height = atoi(argv[i + 4]);
+      i += 4;
+    }
+    else if (arg == "--threads" && i + 1 < argc)
+      thread_num = atoi(argv[++i]);
+    else if (arg == "--rounds" && i + 1 < argc)
+      round_num = atoi(argv[++i]);
+    else if (arg == "--json" && i + 1 < argc)
+      json_path = argv[++i];
+    else
+    {
+      std::cout << "Unknown argument: " << arg << std::endl;
+      return -1;
+    }
+  }
+  thread_num = std::max(thread_num, 1);
+  round_num = std::max(round_num, 1);
+
+  /*The faces at several bounding box sizes*/
+  const int face_sizes[] = { 40, 80, 160, 320, 640 };
+  std::vector<BenchInput> inputs;
+  for (size_t i = 0; i < sizeof(face_sizes) / sizeof(face_sizes[0]); i++)
+    inputs.push_back(MakeSyntheticInput(face_sizes[i]));
+  if (!pgm_path.empty())
+  {
+    std::vector<unsigned char> image;
+    int width, height;
+    if (!ReadPGM(pgm_path, &image, &width, &height))
+    {
+      std::cout << "Failed to read " << pgm_path << std::endl;
+      return -1;
+    }
+    for (size_t i = 0; i < sizeof(face_sizes) / sizeof(face_sizes[0]); i++)
+      inputs.push_back(MakePGMInput(image, width, height, pgm_face, face_sizes[i]));
+  }
+
+  /*Single-threaded, then concurrent with one CCFAN object per thread*/
+  std::vector<int> thread_modes(1, 1);
+  if (thread_num > 1)
+    thread_modes.push_back(thread_num);
+
+  std::ofstream json;
+  if (!json_path.empty())
+  {
+    json.open(json_path.c_str());
+#if defined(USE_AVX2)
+    const char* simd = "avx2";
+#elif defined(USE_SSE)
+    const char* simd = "sse";
+#else
+    const char* simd = "none";
+#endif
+    json << "{\n  \"simd\": \"" << simd << "\", \"rounds\": " << round_num << ",\n  \"results\": [\n";
+  }
+  bool first = true;
+  for (size_t m = 0; m < thread_modes.size(); m++)
+  {
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+      BenchResult result = RunBench(model_path, inputs[i], thread_modes[m], round_num);
+      PrintResult(inputs[i], thread_modes[m], result);
+      if (json.is_open())
+      {
+        json << (first ? "" : ",\n");
+        WriteJsonResult(json, inputs[i], thread_modes[m], result);
+        first = false;
+      }
+    }
+  }
+  if (json.is_open())
+    json << "\n  ]\n}\n";
+  return 0;
+}
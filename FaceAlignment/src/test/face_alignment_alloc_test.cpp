@@ -0,0 +1,139 @@
+/*
+ *
+ * This file is part of the open-source SeetaFace engine, which includes three modules:
+ * SeetaFace Detection, SeetaFace Alignment, and SeetaFace Identification.
+ *
+ * This file checks that SeetaFace Alignment does not allocate heap memory per
+ * face once warmed up. The face alignment method is described in the following paper:
+ *
+ *
+ *   Coarse-to-Fine Auto-Encoder Networks (CFAN) for Real-Time Face Alignment, 
+ *   Jie Zhang, Shiguang Shan, Meina Kan, Xilin Chen. In Proceeding of the
+ *   European Conference on Computer Vision (ECCV), 2014
+ *
+ *
+ * Copyright (C) 2016, Visual Information Processing and Learning (VIPL) group,
+ * Institute of Computing Technology, Chinese Academy of Sciences, Beijing, China.
+ *
+ * The codes are mainly developed by Jie Zhang (a Ph.D supervised by Prof. Shiguang Shan)
+ *
+ * As an open-source face recognition engine: you can redistribute SeetaFace source codes
+ * and/or modify it under the terms of the BSD 2-Clause License.
+ *
+ * You should have received a copy of the BSD 2-Clause License along with the software.
+ * If not, see < https://opensource.org/licenses/BSD-2-Clause>.
+ *
+ * Contact Info: you can send an email to SeetaFace@vipl.ict.ac.cn for any problems.
+ *
+ * Note: the above information must be kept whenever or wherever the codes are used.
+ *
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "face_alignment.h"
+
+/*The number of heap allocations made through operator new*/
+static int64_t alloc_count = 0;
+
+void* operator new(std::size_t size)
+{
+  alloc_count++;
+  void* ptr = std::malloc(size == 0 ? 1 : size);
+  if (ptr == NULL)
+    throw std::bad_alloc();
+  return ptr;
+}
+
+void* operator new[](std::size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+
+int main(int argc, char** argv)
+{
+  if (argc < 2)
+  {
+    std::cout << "Usage: " << argv[0] << " model_path" << std::endl;
+    return -1;
+  }
+
+  seeta::FaceAlignment point_detector(argv[1]);
+
+  /*A synthetic image with some texture, as the result does not matter*/
+  int im_width = 640;
+  int im_height = 480;
+  std::vector<unsigned char> im_data(im_width * im_height);
+  for (int i = 0; i < im_height; i++)
+  {
+    for (int j = 0; j < im_width; j++)
+    {
+      im_data[i * im_width + j] = (unsigned char)((i * 7 + j * 13 + (i * j) % 29) & 0xff);
+    }
+  }
+  seeta::ImageData image_data(im_width, im_height, 1);
+  image_data.data = im_data.data();
+
+  /*Faces of different sizes, some crossing the image border*/
+  int face_rects[][3] = { { 100, 80, 200 }, { 400, 200, 120 }, { -20, 300, 220 }, { 560, 400, 160 } };
+  int face_num = sizeof(face_rects) / sizeof(face_rects[0]);
+  std::vector<seeta::FaceInfo> faces(face_num);
+  for (int i = 0; i < face_num; i++)
+  {
+    faces[i].bbox.x = face_rects[i][0];
+    faces[i].bbox.y = face_rects[i][1];
+    faces[i].bbox.width = face_rects[i][2];
+    faces[i].bbox.height = face_rects[i][2];
+  }
+
+  /*Each face is detected, then tracked, with the second network alone unless it
+    crosses the image border*/
+  seeta::FacialLandmark points[5];
+  std::vector<seeta::LandmarkTrack> tracks(face_num);
+  for (int i = 0; i < face_num; i++)
+  {
+    point_detector.PointDetectLandmarks(image_data, faces[i], points);
+    point_detector.TrackLandmarks(image_data, faces[i], &tracks[i]);
+  }
+
+  int round_num = 10;
+  int64_t count_before = alloc_count;
+  for (int r = 0; r < round_num; r++)
+  {
+    for (int i = 0; i < face_num; i++)
+    {
+      point_detector.PointDetectLandmarks(image_data, faces[i], points);
+      point_detector.TrackLandmarks(image_data, faces[i], &tracks[i]);
+    }
+  }
+  int64_t count = alloc_count - count_before;
+
+  std::cout << "Heap allocations per face after warm-up: "
+    << double(count) / (round_num * face_num) << std::endl;
+  return (count == 0 ? 0 : 1);
+}
@@ -0,0 +1,137 @@
+/*
+ *
+ * This file is part of the open-source SeetaFace engine, which includes three modules:
+ * SeetaFace Detection, SeetaFace Alignment, and SeetaFace Identification.
+ *
+ * This file checks that the landmarks tracked by SeetaFace Alignment in a video stay
+ * close to the detected ones, with the face still and then moving within its box.
+ * The face alignment method is described in the following paper:
+ *
+ *
+ *   Coarse-to-Fine Auto-Encoder Networks (CFAN) for Real-Time Face Alignment, 
+ *   Jie Zhang, Shiguang Shan, Meina Kan, Xilin Chen. In Proceeding of the
+ *   European Conference on Computer Vision (ECCV), 2014
+ *
+ *
+ * Copyright (C) 2016, Visual Information Processing and Learning (VIPL) group,
+ * Institute of Computing Technology, Chinese Academy of Sciences, Beijing, China.
+ *
+ * The codes are mainly developed by Jie Zhang (a Ph.D supervised by Prof. Shiguang Shan)
+ *
+ * As an open-source face recognition engine: you can redistribute SeetaFace source codes
+ * and/or modify it under the terms of the BSD 2-Clause License.
+ *
+ * You should have received a copy of the BSD 2-Clause License along with the software.
+ * If not, see < https://opensource.org/licenses/BSD-2-Clause>.
+ *
+ * Contact Info: you can send an email to SeetaFace@vipl.ict.ac.cn for any problems.
+ *
+ * Note: the above information must be kept whenever or wherever the codes are used.
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "cv.h"
+#include "highgui.h"
+
+#include "face_alignment.h"
+
+/*The largest mean error of the tracked landmarks, relative to the face width*/
+static const double kMaxTrackError = 0.02;
+
+int main(int argc, char** argv)
+{
+  if (argc != 2 && argc != 6)
+  {
+    std::cout << "Usage: " << argv[0] << " model_path [image_path face_x face_y face_width]" << std::endl;
+    return -1;
+  }
+
+  seeta::FaceAlignment point_detector(argv[1]);
+
+  /*The face of the given image, by default the one of data/image_0001.png*/
+  std::string image_path = "data/image_0001.png";
+  seeta::FaceInfo face;
+  face.bbox.x = 150;
+  face.bbox.y = 189;
+  face.bbox.width = 288;
+  face.score = 0;
+  if (argc == 6)
+  {
+    image_path = argv[2];
+    face.bbox.x = atoi(argv[3]);
+    face.bbox.y = atoi(argv[4]);
+    face.bbox.width = atoi(argv[5]);
+  }
+  face.bbox.height = face.bbox.width;
+
+  IplImage *img_grayscale = cvLoadImage(image_path.c_str(), 0);
+  if (img_grayscale == NULL)
+  {
+    std::cout << "Failed to read " << image_path << std::endl;
+    return -1;
+  }
+  int im_width = img_grayscale->width;
+  int im_height = img_grayscale->height;
+  std::vector<unsigned char> im_data(im_width * im_height);
+  for (int h = 0; h < im_height; h++)
+    memcpy(&im_data[h * im_width], img_grayscale->imageData + h * img_grayscale->widthStep, im_width);
+  cvReleaseImage(&img_grayscale);
+
+  /*The frames of the video: the image still for the first half, then moving left by
+    two pixels per frame, while the face box is only updated every five frames, as by a
+    face detector run periodically*/
+  int frame_num = 60;
+  int still_num = 30;
+  std::vector<unsigned char> frame_data(im_width * im_height);
+  seeta::ImageData image_data(im_width, im_height, 1);
+  image_data.data = frame_data.data();
+  seeta::FaceInfo frame_face = face;
+
+  int detected_num = 0;
+  double max_still_error = 0;
+  double max_error = 0;
+  seeta::LandmarkTrack track;
+  for (int f = 0; f < frame_num; f++)
+  {
+    int shift = 2 * std::max(f - still_num, 0);
+    for (int h = 0; h < im_height; h++)
+    {
+      for (int w = 0; w < im_width; w++)
+        frame_data[h * im_width + w] = im_data[h * im_width + std::min(w + shift, im_width - 1)];
+    }
+    if (f % 5 == 0)
+      frame_face.bbox.x = face.bbox.x - shift;
+
+    seeta::FacialLandmark points[5];
+    point_detector.PointDetectLandmarks(image_data, frame_face, points);
+    point_detector.TrackLandmarks(image_data, frame_face, &track);
+    if (track.frames == 0)
+      detected_num++;
+
+    /*The mean distance of the points to the detected ones*/
+    double error = 0;
+    for (int i = 0; i < 5; i++)
+    {
+      double dx = track.points[i].x - points[i].x;
+      double dy = track.points[i].y - points[i].y;
+      error += sqrt(dx * dx + dy * dy) / (5 * face.bbox.width);
+    }
+    if (f < still_num)
+      max_still_error = std::max(max_still_error, error);
+    max_error = std::max(max_error, error);
+    std::cout << "Frame " << f << ": error " << error * 100 << "% of the face width" << std::endl;
+  }
+
+  /*A still face keeps the detected landmarks, and most frames are tracked*/
+  std::cout << "Detected in " << detected_num << " of " << frame_num << " frames, largest error "
+    << max_still_error * 100 << "% of the face width while still, " << max_error * 100 << "% in all" << std::endl;
+  return (max_still_error <= 1e-4 && max_error <= kMaxTrackError && detected_num * 2 < frame_num ? 0 : 1);
+}
@@ -0,0 +1,223 @@
+/*
+ *
+ * This file is part of the open-source SeetaFace engine, which includes three modules:
+ * SeetaFace Detection, SeetaFace Alignment, and SeetaFace Identification.
+ *
+ * This file checks and times the SIFT features used by SeetaFace Alignment. The
+ * face alignment method is described in the following paper:
+ *
+ *
+ *   Coarse-to-Fine Auto-Encoder Networks (CFAN) for Real-Time Face Alignment, 
+ *   Jie Zhang, Shiguang Shan, Meina Kan, Xilin Chen. In Proceeding of the
+ *   European Conference on Computer Vision (ECCV), 2014
+ *
+ *
+ * Copyright (C) 2016, Visual Information Processing and Learning (VIPL) group,
+ * Institute of Computing Technology, Chinese Academy of Sciences, Beijing, China.
+ *
+ * The codes are mainly developed by Jie Zhang (a Ph.D supervised by Prof. Shiguang Shan)
+ *
+ * As an open-source face recognition engine: you can redistribute SeetaFace source codes
+ * and/or modify it under the terms of the BSD 2-Clause License.
+ *
+ * You should have received a copy of the BSD 2-Clause License along with the software.
+ * If not, see < https://opensource.org/licenses/BSD-2-Clause>.
+ *
+ * Contact Info: you can send an email to SeetaFace@vipl.ict.ac.cn for any problems.
+ *
+ * Note: the above information must be kept whenever or wherever the codes are used.
+ *
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "sift.h"
+
+/** The reference SIFT computation in double precision, following the original
+ *  implementation step by step: 5x5 derivative of Gaussian filters, orientation
+ *  maps from sqrt and pow, dense convolution at the sample points and patch-wise
+ *  L2 normalization.
+ */
+static void ReferenceSIFT(const BYTE* gray_im, int width, int height, int patch_size,
+  int grid_spacing, std::vector<double>* sift_feature)
+{
+  static const double delta_gauss_x[25] =
+  {0.0284161904936934,0.0260724940559495,0,-0.0260724940559495,-0.0284161904936934,
+  0.127352530356230,0.116848811647003,0,-0.116848811647003,-0.127352530356230,
+  0.209968825675801,0.192651121218447,0,-0.192651121218447,-0.209968825675801,
+  0.127352530356230,0.116848811647003,0,-0.116848811647003,-0.127352530356230,
+  0.0284161904936934,0.0260724940559495,0,-0.0260724940559495,-0.0284161904936934};
+  static const double cos_array[8] = {1.0, 0.7071, 0.0, -0.7071, -1.0, -0.7071, 0.0, 0.7071};
+  static const double sin_array[8] = {0.0, 0.7071, 1.0, 0.7071, 0.0, -0.7071, -1.0, -0.7071};
+  int pixel_num = width * height;
+  int sample_pixel = patch_size / 4;
+
+  std::vector<double> im(pixel_num);
+  double max = 0.000001;
+  for (int pt = 0; pt < pixel_num; pt++)
+  {
+    im[pt] = gray_im[pt];
+    if (im[pt] > max)
+      max = im[pt];
+  }
+  for (int pt = 0; pt < pixel_num; pt++)
+    im[pt] = im[pt] / max;
+
+  // filter2 with zero padding, the filter along Y being the transpose
+  std::vector<double> im_vert_edge(pixel_num, 0);
+  std::vector<double> im_hori_edge(pixel_num, 0);
+  for (int i = 0; i < height; i++)
+  {
+    for (int j = 0; j < width; j++)
+    {
+      for (int ki = 0; ki < 5; ki++)
+      {
+        for (int kj = 0; kj < 5; kj++)
+        {
+          int r = i + ki - 2;
+          int c = j + kj - 2;
+          if (r < 0 || r >= height || c < 0 || c >= width)
+            continue;
+          im_vert_edge[i * width + j] += im[r * width + c] * delta_gauss_x[ki * 5 + kj];
+          im_hori_edge[i * width + j] += im[r * width + c] * delta_gauss_x[kj * 5 + ki];
+        }
+      }
+    }
+  }
+
+  std::vector<double> im_orientation(pixel_num * 8);
+  for (int pt = 0; pt < pixel_num; pt++)
+  {
+    double magnitude = sqrt(pow(im_vert_edge[pt], 2) + pow(im_hori_edge[pt], 2));
+    for (int index = 0; index < 8; index++)
+    {
+      double val = pow((im_vert_edge[pt] * cos_array[index] + im_hori_edge[pt] * sin_array[index]) / magnitude, 3);
+      im_orientation[index * pixel_num + pt] = (val > 0 ? val : 0) * magnitude;
+    }
+  }
+
+  // Convolution at the sample points, with the truncated distance of the original
+  std::vector<double> weight(patch_size);
+  for (int k = 0; k < patch_size; k++)
+  {
+    weight[k] = abs(int(k - double(patch_size - 1) / 2)) / sample_pixel;
+    weight[k] = (weight[k] <= 1 ? 1 - weight[k] : 0);
+  }
+  int pad_size = (patch_size - 1) / 2;
+  std::vector<double> conv_im(pixel_num * 8, 0);
+  for (int index = 0; index < 8; index++)
+  {
+    for (int i = 0; i < height; i += sample_pixel)
+    {
+      for (int j = 0; j < width; j += sample_pixel)
+      {
+        double sum = 0;
+        for (int ki = 0; ki < patch_size; ki++)
+        {
+          for (int kj = 0; kj < patch_size; kj++)
+          {
+            int r = i + ki - pad_size;
+            int c = j + kj - pad_size;
+            if (r >= 0 && r < height && c >= 0 && c < width)
+              sum += im_orientation[index * pixel_num + r * width + c] * weight[ki] * weight[kj];
+          }
+        }
+        conv_im[index * pixel_num + i * width + j] = sum;
+      }
+    }
+  }
+
+  sift_feature->clear();
+  for (int location_x = patch_size / 2; location_x <= height - patch_size / 2; location_x += grid_spacing)
+  {
+    for (int location_y = patch_size / 2; location_y <= width - patch_size / 2; location_y += grid_spacing)
+    {
+      std::vector<double> patch_feature;
+      double l2_norm = 0.000001;
+      for (int p_x = -patch_size / 2; p_x <= patch_size / 2 - sample_pixel; p_x += sample_pixel)
+      {
+        for (int p_y = -patch_size / 2; p_y <= patch_size / 2 - sample_pixel; p_y += sample_pixel)
+        {
+          int i = location_x + p_x;
+          int j = location_y + p_y;
+          for (int index = 0; index < 8; index++)
+          {
+            patch_feature.push_back(conv_im[index * pixel_num + j * width + i]);
+            l2_norm += pow(patch_feature.back(), 2);
+          }
+        }
+      }
+      for (size_t pt = 0; pt < patch_feature.size(); pt++)
+        sift_feature->push_back(patch_feature[pt] / sqrt(l2_norm));
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  int patch_size = 32;
+  int patch_num = 1000;
+  std::vector<BYTE> patches(patch_num * patch_size * patch_size);
+
+  // Smooth random blobs plus noise, with some flat and some saturated patches
+  srand(0);
+  for (int n = 0; n < patch_num; n++)
+  {
+    BYTE* patch = &patches[n * patch_size * patch_size];
+    double cx = rand() % patch_size;
+    double cy = rand() % patch_size;
+    double radius = 4 + rand() % 16;
+    int contrast = (n % 50 == 0 ? 0 : rand() % 256);
+    for (int i = 0; i < patch_size; i++)
+    {
+      for (int j = 0; j < patch_size; j++)
+      {
+        double d2 = ((i - cy) * (i - cy) + (j - cx) * (j - cx)) / (radius * radius);
+        int val = int(contrast * exp(-d2)) + (contrast > 0 ? rand() % 8 : 0);
+        patch[i * patch_size + j] = BYTE(val > 255 ? 255 : val);
+      }
+    }
+  }
+
+  SIFT sift_extractor;
+  sift_extractor.InitSIFT(patch_size, patch_size, 32, 16);
+  std::vector<float> feature(128);
+  std::vector<double> ref_feature;
+  double max_diff = 0;
+  for (int n = 0; n < patch_num; n++)
+  {
+    BYTE* patch = &patches[n * patch_size * patch_size];
+    sift_extractor.CalcSIFT(patch, feature.data());
+    ReferenceSIFT(patch, patch_size, patch_size, 32, 16, &ref_feature);
+    for (int i = 0; i < 128; i++)
+    {
+      double diff = fabs(feature[i] - ref_feature[i]);
+      if (diff > max_diff || (diff != diff))
+        max_diff = diff;
+    }
+  }
+  std::cout << "Max difference from the reference: " << max_diff << std::endl;
+
+  int round_num = 20;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (int r = 0; r < round_num; r++)
+  {
+    for (int n = 0; n < patch_num; n++)
+      sift_extractor.CalcSIFT(&patches[n * patch_size * patch_size], feature.data());
+  }
+  double elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "SIFT of a " << patch_size << "x" << patch_size << " patch: "
+    << elapsed / (round_num * patch_num) << " us" << std::endl;
+
+  start = std::chrono::steady_clock::now();
+  for (int n = 0; n < patch_num; n++)
+    ReferenceSIFT(&patches[n * patch_size * patch_size], patch_size, patch_size, 32, 16, &ref_feature);
+  elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "Reference: " << elapsed / patch_num << " us" << std::endl;
+
+  return (max_diff < 1e-4 ? 0 : 1);
+}
@@ -82,6 +82,15 @@ class LABBoostedClassifier : public Classifier {
 
   virtual bool Classify(float* score = nullptr, float* outputs = nullptr);
 
+  /**
+   * @brief Classify the ROI of the given feature map.
+   *
+   * The classifier state is not touched, so several threads can share one
+   * classifier as long as each of them uses its own feature map.
+   */
+  bool Classify(const seeta::fd::LABFeatureMap & feat_map,
+    float* score = nullptr) const;
+
   inline virtual seeta::fd::ClassifierType type() {
     return seeta::fd::ClassifierType::LAB_Boosted_Classifier;
   }
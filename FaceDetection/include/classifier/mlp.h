@@ -46,11 +46,22 @@ namespace fd {
 class MLPLayer {
  public:
   explicit MLPLayer(int32_t act_func_type = 1)
-      : input_dim_(0), output_dim_(0), act_func_type_(act_func_type) {}
+      : input_dim_(0), output_dim_(0), act_func_type_(act_func_type),
+        quantized_(false), input_nonneg_(false), input_dim_padded_(0) {}
   ~MLPLayer() {}
 
   void Compute(const float* input, float* output);
 
+  /**
+   * Use the int8 weights, quantizing the input of each call with its own
+   * scale (to 7 bits, or to 6 bits plus an offset of 64 if it can be
+   * negative). The output is dequantized before the bias and activation.
+   */
+  inline void SetQuantized(bool quantized) { quantized_ = quantized; }
+
+  /** Whether the input is known to be non-negative, e.g. output of ReLU */
+  inline void SetInputNonNegative(bool nonneg) { input_nonneg_ = nonneg; }
+
   inline int32_t GetInputDim() const { return input_dim_; }
   inline int32_t GetOutputDim() const { return output_dim_; }
 
@@ -69,6 +80,7 @@ class MLPLayer {
       return;  // @todo handle the errors!!!
     }
     std::copy(weights, weights + input_dim_ * output_dim_, weights_.begin());
+    QuantizeWeights();
   }
 
   inline void SetBias(const float* bias, int32_t len) {
@@ -79,6 +91,9 @@ class MLPLayer {
   }
 
  private:
+  void ComputeQuantized(const float* input, float* output);
+  void QuantizeWeights();
+
   inline float Sigmoid(float x) {
     return 1.0f / (1.0f + std::exp(x));
   }
@@ -93,6 +108,14 @@ class MLPLayer {
   int32_t output_dim_;
   std::vector<float> weights_;
   std::vector<float> bias_;
+
+  bool quantized_;
+  bool input_nonneg_;
+  int32_t input_dim_padded_;  /**< multiple of 32 */
+  std::vector<int8_t> weights_int8_;
+  std::vector<float> weight_scales_;  /**< per output */
+  std::vector<int32_t> weight_sums_;  /**< per output, for the input offset */
+  std::vector<uint8_t> input_buf_;
 };
 
 
@@ -118,6 +141,8 @@ class MLP {
   void AddLayer(int32_t inputDim, int32_t outputDim, const float* weights,
       const float* bias, bool is_output = false);
 
+  void SetQuantized(bool quantized);
+
  private:
   std::vector<std::shared_ptr<seeta::fd::MLPLayer> > layers_;
   std::vector<float> layer_buf_[2];
@@ -63,6 +63,9 @@ class SURFMLP : public Classifier {
 
   inline void SetThreshold(float thresh) { thresh_ = thresh; }
 
+  /** Run the MLP with int8 weights and inputs instead of fp32. */
+  inline void SetQuantized(bool quantized) { model_->SetQuantized(quantized); }
+
  private:
   std::vector<int32_t> feat_id_;
   std::vector<float> input_buf_;
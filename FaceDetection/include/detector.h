@@ -32,12 +32,16 @@
 #ifndef SEETA_FD_DETECTOR_H_
 #define SEETA_FD_DETECTOR_H_
 
+#include <algorithm>
 #include <cstdint>
 #include <string>
 #include <vector>
 
 #include "common.h"
 #include "util/image_pyramid.h"
+#include "util/nms.h"
+#include "util/scale_prior.h"
+#include "util/scan_mask.h"
 
 namespace seeta {
 namespace fd {
@@ -50,8 +54,70 @@ class Detector {
   virtual bool LoadModel(const std::string & model_path) = 0;
   virtual std::vector<seeta::FaceInfo> Detect(seeta::fd::ImagePyramid* img_pyramid) = 0;
 
+  /**
+   * Load one more model, sharing the image pyramid and feature computation
+   * with the models loaded before.
+   */
+  virtual bool AddModel(const std::string & model_path) { return false; }
+
+  /**
+   * Detect faces with all loaded models. With several models, their faces are
+   * merged and sorted by descending score. If `labels` is not null, it
+   * receives for each face the index of the model which detected it.
+   */
+  virtual std::vector<seeta::FaceInfo> DetectPerModel(
+      seeta::fd::ImagePyramid* img_pyramid, std::vector<int32_t>* labels) {
+    std::vector<seeta::FaceInfo> faces = Detect(img_pyramid);
+    if (labels != nullptr)
+      labels->assign(faces.size(), 0);
+    return faces;
+  }
+
+  /**
+   * Detect at most `max_faces` faces with score no smaller than
+   * `score_thresh`, keeping the largest ones. Detectors may stop scanning
+   * the image pyramid early.
+   */
+  virtual std::vector<seeta::FaceInfo> DetectLargest(
+      seeta::fd::ImagePyramid* img_pyramid, int32_t max_faces,
+      float score_thresh) {
+    std::vector<seeta::FaceInfo> faces = Detect(img_pyramid);
+    std::vector<seeta::FaceInfo> largest_faces;
+    for (size_t i = 0; i < faces.size(); i++) {
+      if (faces[i].score >= score_thresh)
+        largest_faces.push_back(faces[i]);
+    }
+    std::stable_sort(largest_faces.begin(), largest_faces.end(),
+      seeta::fd::CompareBBoxSize);
+    if (static_cast<int32_t>(largest_faces.size()) > max_faces)
+      largest_faces.resize(max_faces);
+    return largest_faces;
+  }
+
+  virtual int32_t num_model() const { return 1; }
+
   virtual void SetWindowSize(int32_t size) {}
   virtual void SetSlideWindowStep(int32_t step_x, int32_t step_y) {}
+  virtual void SetTileSize(int32_t size) {}
+
+  /**
+   * Restrict the sliding window to windows overlapping the mask (not owned),
+   * or scan all windows if it is null.
+   */
+  virtual void SetScanMask(const seeta::fd::ScanMask* mask) {}
+
+  /**
+   * Scan each scale only on the rows where the prior (not owned) allows
+   * faces of its size, or on all rows if it is null.
+   */
+  virtual void SetScalePrior(const seeta::fd::ScalePrior* prior) {}
+
+  /** Run the MLP classifiers with int8 instead of fp32 arithmetic. */
+  virtual void SetQuantizedMLP(bool quantized) {}
+
+  /** Number of windows in the last detection, and of those evaluated. */
+  virtual int32_t num_wnd() const { return 0; }
+  virtual int32_t num_scanned_wnd() const { return 0; }
 
   DISABLE_COPY_AND_ASSIGN(Detector);
 };
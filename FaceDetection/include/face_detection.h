@@ -33,6 +33,7 @@
 #define SEETA_FACE_DETECTION_H_
 
 #include <cstdint>
+#include <string>
 #include <vector>
 
 #include "common.h"
@@ -42,6 +43,15 @@ namespace seeta {
 class FaceDetection {
  public:
   SEETA_API explicit FaceDetection(const char* model_path);
+
+  /**
+   * @brief Load several models, e.g. a frontal and a profile one trained in
+   *        the same FuSt format.
+   *
+   * All models share the image pyramid, and the first stage classifiers of
+   * all models are evaluated on the same feature maps of each scale.
+   */
+  SEETA_API explicit FaceDetection(const std::vector<std::string> & model_paths);
   SEETA_API ~FaceDetection();
 
   /**
@@ -53,6 +63,29 @@ class FaceDetection {
    */
   SEETA_API std::vector<seeta::FaceInfo> Detect(const seeta::ImageData & img);
 
+  /**
+   * @brief Detect faces with all loaded models.
+   *
+   * The faces of all models are merged and sorted by score (no NMS is applied
+   * across models). If `labels` is not null, it receives for each face the
+   * index of the model which detected it, in the order the models are given
+   * to the constructor.
+   */
+  SEETA_API std::vector<seeta::FaceInfo> Detect(const seeta::ImageData & img,
+    std::vector<int32_t>* labels);
+
+  /**
+   * @brief Detect at most `max_faces` faces, keeping the largest ones.
+   *
+   * The image pyramid is scanned from coarse to fine (i.e. from large faces to
+   * small ones) and scanning stops soon after `max_faces` faces pass the
+   * score threshold, which is much faster than Detect() for images dominated
+   * by a few large faces, e.g. ID photos and selfies. The faces returned have
+   * the boxes and scores Detect() gives them, sorted by descending size.
+   */
+  SEETA_API std::vector<seeta::FaceInfo> DetectLargest(
+    const seeta::ImageData & img, int32_t max_faces = 1);
+
   /**
    * @brief Set the minimum size of faces to detect.
    *
@@ -95,6 +128,73 @@ class FaceDetection {
    */
   SEETA_API void SetScoreThresh(float thresh);
 
+  /**
+   * @brief Enable or disable tiled scanning of the image pyramid.
+   *
+   * When enabled, the sliding window stage processes each pyramid level in
+   * overlapping tiles, in parallel, so that the memory of the feature maps
+   * is bounded independently of the image size. This is intended for very
+   * large images (e.g. 8K or panoramic ones). The side length of the tiles
+   * is given by `tile_size`; a value of 0 chooses it from the window size
+   * and the L2 cache size. Results are the same as those of untiled scanning
+   * up to the ordering of equally scored windows in NMS.
+   */
+  SEETA_API void SetTiledDetection(bool enable, int32_t tile_size = 0);
+
+  /**
+   * @brief Enable or disable motion gating for static-camera video.
+   *
+   * When enabled, successive calls of `Detect()` and `DetectLargest()` are
+   * treated as frames of one video. A low-resolution background is kept, and
+   * only windows overlapping regions which differ from it by more than
+   * `diff_thresh` (in gray levels), or the faces of the previous frame, are
+   * evaluated. The whole frame is scanned every `refresh_interval` frames and
+   * whenever the frame size changes. Enabling it again resets the background.
+   * A `refresh_interval` smaller than 1 is taken as 1, and `diff_thresh` is
+   * clamped to [0, 255].
+   */
+  SEETA_API void SetMotionGating(bool enable, int32_t refresh_interval = 25,
+    int32_t diff_thresh = 15);
+
+  /**
+   * @brief Set the range of face sizes by image row, e.g. for a fixed camera.
+   *
+   * `size_range` gives the minimum and maximum size of faces whose centers
+   * are on a row of an image with the given height. Each scale of the image
+   * pyramid is then scanned only on the rows where faces of its size can
+   * occur. Passing null disables it.
+   */
+  SEETA_API void SetScalePrior(void (*size_range)(int32_t row,
+    int32_t img_height, int32_t* min_size, int32_t* max_size));
+
+  /**
+   * @brief Enable or disable learning the range of face sizes by image row.
+   *
+   * When enabled, a linear model of the face size against the row is fitted
+   * to the detected faces and, once there are `min_num_face` of them, used as
+   * the scale prior (see `SetScalePrior()`, which takes precedence). Faces
+   * learned before are dropped in either case.
+   */
+  SEETA_API void SetScalePriorLearning(bool enable, int32_t min_num_face = 50);
+
+  /**
+   * @brief Enable or disable int8 inference of the MLP stages.
+   *
+   * The weights of the MLP layers are quantized to int8 with one scale per
+   * output when the model is loaded, and each input vector is quantized with
+   * its own scale. This is faster, but the scores differ slightly from those
+   * of fp32 inference (see `src/test/int8_calibration.cpp` to check the
+   * effect on a validation set). Disabled by default.
+   */
+  SEETA_API void SetInt8Inference(bool enable);
+
+  /**
+   * @brief Get the number of sliding windows of the last detection, and the
+   * number of those actually evaluated (the others skipped by motion gating
+   * or the scale prior).
+   */
+  SEETA_API void GetWindowStats(int32_t* num_wnd, int32_t* num_scanned) const;
+
   DISABLE_COPY_AND_ASSIGN(FaceDetection);
 
  private:
@@ -51,11 +51,45 @@ typedef struct LABFeature {
 
 class LABFeatureMap : public seeta::fd::FeatureMap {
  public:
-  LABFeatureMap() : rect_width_(3), rect_height_(3), num_rect_(3) {}
+  LABFeatureMap()
+      : rect_width_(3), rect_height_(3), num_rect_(3),
+        stream_input_(nullptr), stream_stride_(0), stream_height_(0),
+        stream_row_(0), band_height_(0), band_len_(0) {}
   virtual ~LABFeatureMap() {}
 
   virtual void Compute(const uint8_t* input, int32_t width, int32_t height);
 
+  /**
+   * @brief Start computing the feature map row by row in a rolling band.
+   *
+   * Only the last `band_height` + 1 rows of the integral images and LAB
+   * codes are kept, so that all buffers stay in cache. The input rows are
+   * `stride` bytes apart, which allows streaming a sub-region of an image.
+   */
+  void StartStream(const uint8_t* input, int32_t stride, int32_t width,
+    int32_t height, int32_t band_height);
+
+  /**
+   * @brief Consume the next input row. Returns false if all rows are used.
+   */
+  bool StreamNextRow();
+
+  /**
+   * @brief Top row of the band completed by the last call of StreamNextRow(),
+   *        or -1 if no band of `band_height` rows is complete yet.
+   */
+  inline int32_t band_top() const {
+    return stream_row_ >= band_height_ ? stream_row_ - band_height_ : -1;
+  }
+
+  /**
+   * @brief Set the ROI, given in input coordinates, within the current band.
+   */
+  inline void SetBandROI(const seeta::Rect & roi) {
+    roi_ = roi;
+    roi_.y = (roi.y == 0 ? 0 : (roi.y - 1) % band_len_ + 1);
+  }
+
   inline uint8_t GetFeatureVal(int32_t offset_x, int32_t offset_y) const {
     return feat_map_[(roi_.y + offset_y) * width_ + roi_.x + offset_x];
   }
@@ -68,6 +102,10 @@ class LABFeatureMap : public seeta::fd::FeatureMap {
   void ComputeRectSum();
   void ComputeFeatureMap();
 
+  void ComputeIntegralRow(int32_t r);
+  void ComputeRectSumRow(int32_t r);
+  void ComputeFeatureRow(int32_t r);
+
   template<typename Int32Type>
   inline void Integral(Int32Type* data) {
     const Int32Type* src = data;
@@ -94,6 +132,22 @@ class LABFeatureMap : public seeta::fd::FeatureMap {
   std::vector<int32_t> rect_sum_;
   std::vector<int32_t> int_img_;
   std::vector<uint32_t> square_int_img_;
+
+  /**
+   * In streaming mode, row r of the integral images and LAB codes is stored
+   * at both r % band_len_ and r % band_len_ + band_len_, so that any
+   * band_len_ consecutive rows are contiguous and can be addressed by the
+   * classifiers exactly as in a full map. Rect sums use a plain ring of
+   * kRectSumRingLen rows.
+   */
+  static const int32_t kRectSumRingLen = 7;
+
+  const uint8_t* stream_input_;
+  int32_t stream_stride_;
+  int32_t stream_height_;
+  int32_t stream_row_;
+  int32_t band_height_;
+  int32_t band_len_;
 };
 
 }  // namespace fd
@@ -130,41 +130,74 @@ class SURFFeatureMap : public FeatureMap {
   void InitFeaturePool();
   void Reshape(int32_t width, int32_t height);
 
-  void ComputeGradientImages(const uint8_t* input);
-  void ComputeGradX(const int32_t* input);
-  void ComputeGradY(const int32_t* input);
-  void ComputeIntegralImages();
-  void Integral();
-  void MaskIntegralChannel();
-
-  inline void FillIntegralChannel(const int32_t* src, int32_t ch) {
-    int32_t* dest = int_img_.data() + ch;
-    int32_t len = width_ * height_;
-    for (int32_t i = 0; i < len; i++) {
-      *dest = *src;
-      *(dest + 2) = *src;
-      dest += kNumIntChannel;
-      src++;
+  /**
+   * Compute the 8-channel integral image in one sweep over the input: the
+   * gradients dx and dy, the channels (dx, |dx|) split by the sign of dy and
+   * (dy, |dy|) split by the sign of dx, and their prefix sums.
+   */
+  void ComputeIntegralImages(const uint8_t* input);
+  void ComputeIntegralRow(const uint8_t* input, int32_t r);
+
+  /**
+   * Add the channels of a pixel to the running sums of its row, and write
+   * the integral image of the pixel (`above` is null for the first row).
+   */
+  inline void AccumulatePixel(int32_t dx, int32_t dy, int32_t* row_sum,
+      const int32_t* above, int32_t* dest) const {
+#ifdef USE_SSE
+    __m128i dx_val = _mm_set_epi32(0, 0, dx, dx);
+    __m128i dy_val = _mm_set_epi32(0, 0, dy, dy);
+    dx_val = _mm_unpacklo_epi32(dx_val, _mm_abs_epi32(dx_val));
+    dy_val = _mm_unpacklo_epi32(dy_val, _mm_abs_epi32(dy_val));
+    __m128i dx_mask = (dy < 0 ? _mm_set_epi32(-1, -1, 0, 0) :
+      _mm_set_epi32(0, 0, -1, -1));
+    __m128i dy_mask = (dx < 0 ? _mm_set_epi32(-1, -1, 0, 0) :
+      _mm_set_epi32(0, 0, -1, -1));
+    __m128i* sum = reinterpret_cast<__m128i*>(row_sum);
+    __m128i sum_dx = _mm_add_epi32(_mm_loadu_si128(sum),
+      _mm_and_si128(dx_val, dx_mask));
+    __m128i sum_dy = _mm_add_epi32(_mm_loadu_si128(sum + 1),
+      _mm_and_si128(dy_val, dy_mask));
+    _mm_storeu_si128(sum, sum_dx);
+    _mm_storeu_si128(sum + 1, sum_dy);
+    if (above != nullptr) {
+      const __m128i* src = reinterpret_cast<const __m128i*>(above);
+      sum_dx = _mm_add_epi32(sum_dx, _mm_loadu_si128(src));
+      sum_dy = _mm_add_epi32(sum_dy, _mm_loadu_si128(src + 1));
     }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), sum_dx);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest) + 1, sum_dy);
+#else
+    int32_t dx_abs = (dx >= 0 ? dx : -dx);
+    int32_t dy_abs = (dy >= 0 ? dy : -dy);
+    if (dy >= 0) {
+      row_sum[0] += dx;
+      row_sum[1] += dx_abs;
+    } else {
+      row_sum[2] += dx;
+      row_sum[3] += dx_abs;
+    }
+    if (dx >= 0) {
+      row_sum[4] += dy;
+      row_sum[5] += dy_abs;
+    } else {
+      row_sum[6] += dy;
+      row_sum[7] += dy_abs;
+    }
+    for (int32_t i = 0; i < kNumIntChannel; i++)
+      dest[i] = row_sum[i] + (above != nullptr ? above[i] : 0);
+#endif
   }
 
   void ComputeFeatureVector(const SURFFeature & feat, int32_t* feat_vec);
   void NormalizeFeatureVectorL2(const int32_t* feat_vec, float* feat_vec_normed,
     int32_t len) const;
 
-  /**
-   * Number of channels should be divisible by 4.
-   */
-  void VectorCumAdd(int32_t* x, int32_t len, int32_t num_channel);
-
   static const int32_t kNumIntChannel = 8;
 
   bool buf_valid_reset_;
 
-  std::vector<int32_t> grad_x_;
-  std::vector<int32_t> grad_y_;
   std::vector<int32_t> int_img_;
-  std::vector<int32_t> img_buf_;
   std::vector<std::vector<int32_t> > feat_vec_buf_;
   std::vector<std::vector<float> > feat_vec_normed_buf_;
   std::vector<int32_t> buf_valid_;
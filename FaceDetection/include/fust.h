@@ -37,11 +37,14 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <tuple>
+#include <utility>
 #include <vector>
 
 #include "classifier.h"
 #include "detector.h"
 #include "feature_map.h"
+#include "feat/lab_feature_map.h"
 #include "model_reader.h"
 
 namespace seeta {
@@ -51,7 +54,9 @@ class FuStDetector : public Detector {
  public:
   FuStDetector()
       : wnd_size_(40), slide_wnd_step_x_(4), slide_wnd_step_y_(4),
-        num_hierarchy_(0) {
+        tile_size_(-1), scan_mask_(nullptr), scale_prior_(nullptr),
+        num_wnd_(0), num_scanned_wnd_(0), quantized_mlp_(false),
+        keep_wnd_results_(false) {
     wnd_data_buf_.resize(wnd_size_ * wnd_size_);
     wnd_data_.resize(wnd_size_ * wnd_size_);
   }
@@ -59,7 +64,18 @@ class FuStDetector : public Detector {
   ~FuStDetector() {}
 
   virtual bool LoadModel(const std::string & model_path);
+  virtual bool AddModel(const std::string & model_path);
   virtual std::vector<seeta::FaceInfo> Detect(seeta::fd::ImagePyramid* img_pyramid);
+  virtual std::vector<seeta::FaceInfo> DetectPerModel(
+    seeta::fd::ImagePyramid* img_pyramid, std::vector<int32_t>* labels);
+
+  virtual std::vector<seeta::FaceInfo> DetectLargest(
+    seeta::fd::ImagePyramid* img_pyramid, int32_t max_faces,
+    float score_thresh);
+
+  inline virtual int32_t num_model() const {
+    return static_cast<int32_t>(fust_model_.size());
+  }
 
   inline virtual void SetWindowSize(int32_t size) {
     if (size >= 20)
@@ -73,21 +89,153 @@ class FuStDetector : public Detector {
       slide_wnd_step_y_ = step_y;
   }
 
+  /**
+   * Negative size disables tiling, 0 derives the tile size from kL2CacheSize.
+   */
+  inline virtual void SetTileSize(int32_t size) {
+    tile_size_ = size;
+  }
+
+  inline virtual void SetScanMask(const seeta::fd::ScanMask* mask) {
+    scan_mask_ = mask;
+  }
+
+  inline virtual void SetScalePrior(const seeta::fd::ScalePrior* prior) {
+    scale_prior_ = prior;
+  }
+
+  virtual void SetQuantizedMLP(bool quantized);
+
+  inline virtual int32_t num_wnd() const { return num_wnd_; }
+  inline virtual int32_t num_scanned_wnd() const { return num_scanned_wnd_; }
+
  private:
+  /**
+   * Structure of one loaded model. Its classifiers are stored contiguously
+   * in model_, starting at model_offset, in the order of the model file.
+   */
+  typedef struct FuStModel {
+    int32_t num_hierarchy;
+    int32_t model_offset;
+    std::vector<int32_t> hierarchy_size;
+    std::vector<int32_t> num_stage;
+    std::vector<std::vector<int32_t> > wnd_src_id;
+  } FuStModel;
+
   std::shared_ptr<seeta::fd::ModelReader> CreateModelReader(seeta::fd::ClassifierType type);
   std::shared_ptr<seeta::fd::Classifier> CreateClassifier(seeta::fd::ClassifierType type);
   std::shared_ptr<seeta::fd::FeatureMap> CreateFeatureMap(seeta::fd::ClassifierType type);
 
   void GetWindowData(const seeta::ImageData & img, const seeta::Rect & wnd);
 
+  /**
+   * Indices in model_ of the classifiers of the first hierarchy of all models.
+   */
+  std::vector<int32_t> GetFirstHierarchyClassifiers() const;
+
+  /**
+   * Sliding window over one scale of the image pyramid with the given
+   * classifiers (indices in model_), which share the feature maps.
+   */
+  void SlideWindow(const seeta::ImageData & img, float scale_factor,
+    const std::vector<int32_t> & cls_idx,
+    std::vector<std::vector<seeta::FaceInfo> >* proposals);
+
+  /**
+   * Run the following hierarchies of all models on the proposals of their
+   * first hierarchies (as ordered by GetFirstHierarchyClassifiers()). The
+   * proposals are consumed.
+   */
+  std::vector<std::vector<seeta::FaceInfo> > ClassifyProposals(
+    const seeta::ImageData & img,
+    std::vector<std::vector<seeta::FaceInfo> >* proposals);
+
+  /**
+   * Run the following hierarchies of a model on the proposals of its first
+   * hierarchy.
+   */
+  std::vector<seeta::FaceInfo> ClassifyProposals(const FuStModel & fust_model,
+    const seeta::ImageData & img,
+    std::vector<std::vector<seeta::FaceInfo> >* first_proposals);
+
+  /**
+   * Classify a window with a classifier of the following hierarchies (index
+   * in model_), regressing its bounding box if it is accepted. While
+   * keep_wnd_results_ is set, the results are kept in wnd_results_ and looked
+   * up when the same window is classified again.
+   */
+  bool ClassifyWindow(const seeta::ImageData & img, int32_t model_idx,
+    seeta::FaceInfo* wnd_info);
+
+  /** Orders indices of faces by descending score. */
+  struct CompareScore {
+    explicit CompareScore(const std::vector<seeta::FaceInfo> & faces)
+        : faces_(faces) {}
+    bool operator()(int32_t a, int32_t b) const {
+      return faces_[a].score > faces_[b].score;
+    }
+    const std::vector<seeta::FaceInfo> & faces_;
+  };
+
+  bool CanSlideWindowStreamed(const std::vector<int32_t> & cls_idx);
+
+  /**
+   * Sliding window over one image of the pyramid, streaming the LAB feature
+   * map in a rolling band of rows and classifying each row of windows as
+   * soon as its band is complete. The image is split into horizontal stripes
+   * (one per thread) or, if tiling is enabled, into tiles.
+   */
+  void SlideWindowStreamed(const seeta::ImageData & img, float scale_factor,
+    const std::vector<int32_t> & cls_idx,
+    std::vector<std::vector<seeta::FaceInfo> >* proposals);
+
+  /**
+   * Restrict the rows of windows [min_y, max_y] on a scale to those where the
+   * scale prior allows faces of its size. Returns false if there is none.
+   */
+  bool GetScanRows(float scale_factor, int32_t* min_y, int32_t* max_y) const;
+
+  /**
+   * Shrink a region of window positions [x0, x1] x [y0, y1] to the rows and
+   * columns of windows which may overlap the scan mask. Returns false if no
+   * window does.
+   */
+  bool ShrinkRegion(float scale_factor, int32_t* x0, int32_t* y0, int32_t* x1,
+    int32_t* y1) const;
+
+  /**
+   * Approximate per-core L2 cache size, used to bound the width of a tile.
+   */
+  static const int32_t kL2CacheSize = 256 * 1024;
+
+  /**
+   * Smallest window, relative to the smallest of the faces found, still
+   * scanned by DetectLargest(). Finer windows are too small to be merged into
+   * such a face by the non-maximum suppression, even after the regression of
+   * their boxes, so the final boxes and scores are those of Detect().
+   */
+  static constexpr float kSupportRatio = 0.3f;
+
   int32_t wnd_size_;
   int32_t slide_wnd_step_x_;
   int32_t slide_wnd_step_y_;
+  int32_t tile_size_;
+
+  const seeta::fd::ScanMask* scan_mask_;
+  const seeta::fd::ScalePrior* scale_prior_;
+  int32_t num_wnd_;
+  int32_t num_scanned_wnd_;
+  bool quantized_mlp_;
 
-  int32_t num_hierarchy_;
-  std::vector<int32_t> hierarchy_size_;
-  std::vector<int32_t> num_stage_;
-  std::vector<std::vector<int32_t> > wnd_src_id_;
+  std::vector<FuStModel> fust_model_;
+
+  /**
+   * Classifier index and bounding box of a window, and the result of
+   * ClassifyWindow() on it: whether it was accepted, and the regressed window.
+   */
+  typedef std::tuple<int32_t, int32_t, int32_t, int32_t, int32_t> WindowKey;
+  bool keep_wnd_results_;
+  std::map<WindowKey, std::pair<bool, seeta::FaceInfo> > wnd_results_;
 
   std::vector<uint8_t> wnd_data_buf_;
   std::vector<uint8_t> wnd_data_;
@@ -96,6 +244,8 @@ class FuStDetector : public Detector {
   std::vector<std::shared_ptr<seeta::fd::FeatureMap> > feat_map_;
   std::map<seeta::fd::ClassifierType, int32_t> cls2feat_idx_;
 
+  std::vector<std::shared_ptr<seeta::fd::LABFeatureMap> > stream_feat_map_;
+
   DISABLE_COPY_AND_ASSIGN(FuStDetector);
 };
 
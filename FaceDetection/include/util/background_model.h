@@ -0,0 +1,89 @@
+/*
+ *
+ * This file is part of the open-source SeetaFace engine, which includes three modules:
+ * SeetaFace Detection, SeetaFace Alignment, and SeetaFace Identification.
+ *
+ * This file is part of the SeetaFace Detection module, containing codes implementing the
+ * face detection method described in the following paper:
+ *
+ *
+ *   Funnel-structured cascade for multi-view face detection with alignment awareness,
+ *   Shuzhe Wu, Meina Kan, Zhenliang He, Shiguang Shan, Xilin Chen.
+ *   In Neurocomputing (under review)
+ *
+ *
+ * Copyright (C) 2016, Visual Information Processing and Learning (VIPL) group,
+ * Institute of Computing Technology, Chinese Academy of Sciences, Beijing, China.
+ *
+ * The codes are mainly developed by Shuzhe Wu (a Ph.D supervised by Prof. Shiguang Shan)
+ *
+ * As an open-source face recognition engine: you can redistribute SeetaFace source codes
+ * and/or modify it under the terms of the BSD 2-Clause License.
+ *
+ * You should have received a copy of the BSD 2-Clause License along with the software.
+ * If not, see < https://opensource.org/licenses/BSD-2-Clause>.
+ *
+ * Contact Info: you can send an email to SeetaFace@vipl.ict.ac.cn for any problems.
+ *
+ * Note: the above information must be kept whenever or wherever the codes are used.
+ *
+ */
+
+#ifndef SEETA_FD_UTIL_BACKGROUND_MODEL_H_
+#define SEETA_FD_UTIL_BACKGROUND_MODEL_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "common.h"
+#include "util/scan_mask.h"
+
+namespace seeta {
+namespace fd {
+
+/**
+ * A low-resolution running-average background of a static-camera video.
+ * Frames are downsampled by averaging `kCellSize x kCellSize` blocks, and
+ * each block differing from the background by more than a threshold is
+ * marked as changed.
+ */
+class BackgroundModel {
+ public:
+  static const int32_t kCellSize = 8;
+
+  BackgroundModel() : width_(0), height_(0), diff_thresh_(15) {}
+
+  inline void SetDiffThresh(int32_t thresh) {
+    if (thresh >= 0 && thresh <= 255)
+      diff_thresh_ = thresh;
+  }
+
+  inline void Reset() {
+    width_ = height_ = 0;
+  }
+
+  /**
+   * Mark the changed cells of a new frame in `mask`, which is reset to the
+   * frame size with cell size `kCellSize`, and blend the frame into the
+   * background. Returns false if there is no background for the frame yet
+   * (first frame or frame size changed), in which case the whole frame
+   * should be scanned.
+   */
+  bool Update(const seeta::ImageData & img, seeta::fd::ScanMask* mask);
+
+ private:
+  void Downsample(const seeta::ImageData & img);
+
+  int32_t width_;
+  int32_t height_;
+  int32_t diff_thresh_;
+
+  std::vector<uint8_t> frame_;  // the downsampled frame
+  std::vector<uint8_t> background_;
+  std::vector<uint8_t> changed_;
+};
+
+}  // namespace fd
+}  // namespace seeta
+
+#endif  // SEETA_FD_UTIL_BACKGROUND_MODEL_H_
@@ -143,8 +143,22 @@ class ImagePyramid {
 
   const seeta::ImageData* GetNextScaleImage(float* scale_factor = nullptr);
 
+  /**
+   * Number of scales, the same as that of images returned by
+   * GetNextScaleImage().
+   */
+  int32_t num_scale() const;
+
+  /**
+   * Random access to the scales, where index 0 refers to `max_scale_`. It does
+   * not affect the state of GetNextScaleImage().
+   */
+  const seeta::ImageData* GetScaleImage(int32_t idx,
+    float* scale_factor = nullptr);
+
  private:
   void UpdateBufScaled();
+  const seeta::ImageData* ResizeToScale(float scale);
 
   float max_scale_;
   float min_scale_;
@@ -32,7 +32,7 @@
 #ifndef SEETA_FD_UTIL_MATH_FUNC_H_
 #define SEETA_FD_UTIL_MATH_FUNC_H_
 
-#ifdef USE_SSE
+#if defined(USE_SSE) || defined(USE_AVX2)
 #include <immintrin.h>
 #endif
 
@@ -161,6 +161,46 @@ class MathFunction {
 #endif
     return prod;
   }
+
+  /**
+   * Inner product of unsigned 7-bit and signed 8-bit integers, whose pairwise
+   * sums of products do not saturate 16 bits. The length should be
+   * divisible by 16 (or 32 with AVX2).
+   */
+  static inline int32_t VectorInnerProduct(const uint8_t* x, const int8_t* y,
+      int32_t len) {
+    int32_t prod = 0;
+    int32_t i = 0;
+#ifdef USE_AVX2
+    __m256i ones = _mm256_set1_epi16(1);
+    __m256i sum = _mm256_setzero_si256();
+    for (; i + 32 <= len; i += 32) {
+      __m256i x1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i));
+      __m256i y1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(y + i));
+      sum = _mm256_add_epi32(sum,
+        _mm256_madd_epi16(_mm256_maddubs_epi16(x1, y1), ones));
+    }
+    __m128i sum1 = _mm_add_epi32(_mm256_castsi256_si128(sum),
+      _mm256_extracti128_si256(sum, 1));
+    sum1 = _mm_hadd_epi32(sum1, sum1);
+    sum1 = _mm_hadd_epi32(sum1, sum1);
+    prod = _mm_cvtsi128_si32(sum1);
+#elif defined(USE_SSE)
+    __m128i ones = _mm_set1_epi16(1);
+    __m128i sum = _mm_setzero_si128();
+    for (; i + 16 <= len; i += 16) {
+      __m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i));
+      __m128i y1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(y + i));
+      sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_maddubs_epi16(x1, y1), ones));
+    }
+    sum = _mm_hadd_epi32(sum, sum);
+    sum = _mm_hadd_epi32(sum, sum);
+    prod = _mm_cvtsi128_si32(sum);
+#endif
+    for (; i < len; i++)
+      prod += static_cast<int32_t>(x[i]) * y[i];
+    return prod;
+  }
 };
 
 }  // namespace fd
@@ -39,6 +39,9 @@
 namespace seeta {
 namespace fd {
 
+bool CompareBBox(const seeta::FaceInfo & a, const seeta::FaceInfo & b);
+bool CompareBBoxSize(const seeta::FaceInfo & a, const seeta::FaceInfo & b);
+
 void NonMaximumSuppression(std::vector<seeta::FaceInfo>* bboxes,
   std::vector<seeta::FaceInfo>* bboxes_nms, float iou_thresh = 0.8f);
 
@@ -0,0 +1,114 @@
+/*
+ *
+ * This file is part of the open-source SeetaFace engine, which includes three modules:
+ * SeetaFace Detection, SeetaFace Alignment, and SeetaFace Identification.
+ *
+ * This file is part of the SeetaFace Detection module, containing codes implementing the
+ * face detection method described in the following paper:
+ *
+ *
+ *   Funnel-structured cascade for multi-view face detection with alignment awareness,
+ *   Shuzhe Wu, Meina Kan, Zhenliang He, Shiguang Shan, Xilin Chen.
+ *   In Neurocomputing (under review)
+ *
+ *
+ * Copyright (C) 2016, Visual Information Processing and Learning (VIPL) group,
+ * Institute of Computing Technology, Chinese Academy of Sciences, Beijing, China.
+ *
+ * The codes are mainly developed by Shuzhe Wu (a Ph.D supervised by Prof. Shiguang Shan)
+ *
+ * As an open-source face recognition engine: you can redistribute SeetaFace source codes
+ * and/or modify it under the terms of the BSD 2-Clause License.
+ *
+ * You should have received a copy of the BSD 2-Clause License along with the software.
+ * If not, see < https://opensource.org/licenses/BSD-2-Clause>.
+ *
+ * Contact Info: you can send an email to SeetaFace@vipl.ict.ac.cn for any problems.
+ *
+ * Note: the above information must be kept whenever or wherever the codes are used.
+ *
+ */
+
+#ifndef SEETA_FD_UTIL_SCALE_PRIOR_H_
+#define SEETA_FD_UTIL_SCALE_PRIOR_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "common.h"
+
+namespace seeta {
+namespace fd {
+
+/**
+ * Prior of face sizes by image row, e.g. due to the perspective of a fixed
+ * camera. The range of sizes is either given by a function of the row of the
+ * face center, or learned from detected faces by fitting a linear model of
+ * the size against the relative row.
+ */
+class ScalePrior {
+ public:
+  typedef void (*SizeRangeFunc)(int32_t row, int32_t img_height,
+    int32_t* min_size, int32_t* max_size);
+
+  /** Number of row bins where the range of sizes is tabulated */
+  static const int32_t kNumBin = 32;
+
+  ScalePrior() : size_range_func_(nullptr), min_num_face_(50), height_(0) {
+    Clear();
+  }
+
+  inline void SetSizeRangeFunc(SizeRangeFunc func) {
+    size_range_func_ = func;
+    height_ = 0;
+  }
+
+  /** Minimum number of faces before the learned prior is used */
+  inline void SetMinNumFace(int32_t num) {
+    if (num > 0)
+      min_num_face_ = num;
+  }
+
+  /** Clear the faces learned. */
+  void Clear();
+
+  /** Learn from a face detected on an image of the given height. */
+  void AddFace(const seeta::FaceInfo & face, int32_t img_height);
+
+  inline int32_t num_face() const { return num_face_; }
+
+  /**
+   * Tabulate the ranges of sizes for an image height. Returns false if no
+   * prior is available, i.e. neither a function is given nor enough faces
+   * are learned.
+   */
+  bool Update(int32_t img_height);
+
+  /**
+   * Range of rows (in the image passed to Update()) where centers of faces
+   * of a size can occur. Returns false if there is no such row.
+   */
+  bool GetRowRange(int32_t face_size, int32_t* min_row, int32_t* max_row)
+    const;
+
+ private:
+  SizeRangeFunc size_range_func_;
+  int32_t min_num_face_;
+  int32_t height_;
+
+  // Sums for the least squares fit of the size against the relative row
+  int32_t num_face_;
+  double sum_r_;
+  double sum_s_;
+  double sum_rr_;
+  double sum_rs_;
+  double sum_ss_;
+
+  std::vector<int32_t> min_size_;
+  std::vector<int32_t> max_size_;
+};
+
+}  // namespace fd
+}  // namespace seeta
+
+#endif  // SEETA_FD_UTIL_SCALE_PRIOR_H_
@@ -0,0 +1,89 @@
+/*
+ *
+ * This file is part of the open-source SeetaFace engine, which includes three modules:
+ * SeetaFace Detection, SeetaFace Alignment, and SeetaFace Identification.
+ *
+ * This file is part of the SeetaFace Detection module, containing codes implementing the
+ * face detection method described in the following paper:
+ *
+ *
+ *   Funnel-structured cascade for multi-view face detection with alignment awareness,
+ *   Shuzhe Wu, Meina Kan, Zhenliang He, Shiguang Shan, Xilin Chen.
+ *   In Neurocomputing (under review)
+ *
+ *
+ * Copyright (C) 2016, Visual Information Processing and Learning (VIPL) group,
+ * Institute of Computing Technology, Chinese Academy of Sciences, Beijing, China.
+ *
+ * The codes are mainly developed by Shuzhe Wu (a Ph.D supervised by Prof. Shiguang Shan)
+ *
+ * As an open-source face recognition engine: you can redistribute SeetaFace source codes
+ * and/or modify it under the terms of the BSD 2-Clause License.
+ *
+ * You should have received a copy of the BSD 2-Clause License along with the software.
+ * If not, see < https://opensource.org/licenses/BSD-2-Clause>.
+ *
+ * Contact Info: you can send an email to SeetaFace@vipl.ict.ac.cn for any problems.
+ *
+ * Note: the above information must be kept whenever or wherever the codes are used.
+ *
+ */
+
+#ifndef SEETA_FD_UTIL_SCAN_MASK_H_
+#define SEETA_FD_UTIL_SCAN_MASK_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "common.h"
+
+namespace seeta {
+namespace fd {
+
+/**
+ * A coarse binary mask over the original (1x) image, marking the regions
+ * where the sliding window should be evaluated. Each cell covers
+ * `cell_size x cell_size` pixels.
+ */
+class ScanMask {
+ public:
+  ScanMask() : width_(0), height_(0), cell_size_(8), num_cell_x_(0),
+      num_cell_y_(0) {}
+
+  /** Resize the mask to an image and clear all cells. */
+  void Reset(int32_t width, int32_t height, int32_t cell_size);
+
+  inline void SetCell(int32_t x, int32_t y) {
+    cells_[y * num_cell_x_ + x] = 1;
+  }
+
+  /** Mark all cells overlapping a rectangle in 1x image coordinates. */
+  void SetRect(const seeta::Rect & rect);
+
+  /** Must be called after the cells are changed and before Overlaps(). */
+  void Update();
+
+  /** Whether any marked cell overlaps a rectangle in 1x image coordinates. */
+  bool Overlaps(const seeta::Rect & rect) const;
+
+  inline int32_t width() const { return width_; }
+  inline int32_t height() const { return height_; }
+  inline int32_t cell_size() const { return cell_size_; }
+  inline int32_t num_cell_x() const { return num_cell_x_; }
+  inline int32_t num_cell_y() const { return num_cell_y_; }
+
+ private:
+  int32_t width_;
+  int32_t height_;
+  int32_t cell_size_;
+  int32_t num_cell_x_;
+  int32_t num_cell_y_;
+
+  std::vector<uint8_t> cells_;
+  std::vector<int32_t> cell_sum_;  // integral image of cells_
+};
+
+}  // namespace fd
+}  // namespace seeta
+
+#endif  // SEETA_FD_UTIL_SCAN_MASK_H_
@@ -37,6 +37,11 @@ namespace seeta {
 namespace fd {
 
 void MLPLayer::Compute(const float* input, float* output) {
+  if (quantized_) {
+    ComputeQuantized(input, output);
+    return;
+  }
+
 #pragma omp parallel num_threads(SEETA_NUM_THREADS)
   {
 #pragma omp for nowait
@@ -48,6 +53,58 @@ void MLPLayer::Compute(const float* input, float* output) {
   }
 }
 
+void MLPLayer::ComputeQuantized(const float* input, float* output) {
+  float max_abs = 0.0f;
+  for (int32_t i = 0; i < input_dim_; i++)
+    max_abs = std::max(max_abs, std::fabs(input[i]));
+
+  int32_t offset = (input_nonneg_ ? 0 : 64);
+  float scale = (max_abs > 0.0f ? (127 - offset) / max_abs : 0.0f);
+  input_buf_.resize(input_dim_padded_);
+  // Non-negative after the offset, so rounding by truncation
+  float round_offset = offset + 0.5f;
+  for (int32_t i = 0; i < input_dim_; i++) {
+    input_buf_[i] = static_cast<uint8_t>(input[i] * scale + round_offset);
+  }
+  std::fill(input_buf_.begin() + input_dim_, input_buf_.end(), 0);
+  float inv_scale = (max_abs > 0.0f ? 1.0f / scale : 0.0f);
+
+#pragma omp parallel num_threads(SEETA_NUM_THREADS)
+  {
+#pragma omp for nowait
+    for (int32_t i = 0; i < output_dim_; i++) {
+      int32_t prod = seeta::fd::MathFunction::VectorInnerProduct(
+        input_buf_.data(), weights_int8_.data() + i * input_dim_padded_,
+        input_dim_padded_) - offset * weight_sums_[i];
+      output[i] = prod * inv_scale * weight_scales_[i] + bias_[i];
+      output[i] = (act_func_type_ == 1 ? ReLU(output[i]) : Sigmoid(-output[i]));
+    }
+  }
+}
+
+void MLPLayer::QuantizeWeights() {
+  input_dim_padded_ = (input_dim_ + 31) / 32 * 32;
+  weights_int8_.assign(input_dim_padded_ * output_dim_, 0);
+  weight_scales_.resize(output_dim_);
+  weight_sums_.resize(output_dim_);
+
+  for (int32_t i = 0; i < output_dim_; i++) {
+    const float* w = weights_.data() + i * input_dim_;
+    int8_t* w_int8 = weights_int8_.data() + i * input_dim_padded_;
+    float max_abs = 0.0f;
+    for (int32_t j = 0; j < input_dim_; j++)
+      max_abs = std::max(max_abs, std::fabs(w[j]));
+
+    float scale = (max_abs > 0.0f ? 127.0f / max_abs : 0.0f);
+    weight_scales_[i] = (max_abs > 0.0f ? max_abs / 127.0f : 0.0f);
+    weight_sums_[i] = 0;
+    for (int32_t j = 0; j < input_dim_; j++) {
+      w_int8[j] = static_cast<int8_t>(std::floor(w[j] * scale + 0.5f));
+      weight_sums_[i] += w_int8[j];
+    }
+  }
+}
+
 void MLP::Compute(const float* input, float* output) {
   layer_buf_[0].resize(layers_[0]->GetOutputDim());
   layers_[0]->Compute(input, layer_buf_[0].data());
@@ -69,8 +126,14 @@ void MLP::AddLayer(int32_t inputDim, int32_t outputDim, const float* weights,
   layer->SetSize(inputDim, outputDim);
   layer->SetWeights(weights, inputDim * outputDim);
   layer->SetBias(bias, outputDim);
+  layer->SetInputNonNegative(!layers_.empty());  // ReLU of hidden layers
   layers_.push_back(layer);
 }
 
+void MLP::SetQuantized(bool quantized) {
+  for (size_t i = 0; i < layers_.size(); i++)
+    layers_[i]->SetQuantized(quantized);
+}
+
 }  // namespace fd
 }  // namespace seeta
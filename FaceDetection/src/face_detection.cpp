@@ -31,12 +31,17 @@
 
 #include "face_detection.h"
 
+#include <algorithm>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "detector.h"
 #include "fust.h"
+#include "util/background_model.h"
 #include "util/image_pyramid.h"
+#include "util/scale_prior.h"
+#include "util/scan_mask.h"
 
 namespace seeta {
 
@@ -46,7 +51,8 @@ class FaceDetection::Impl {
       : detector_(new seeta::fd::FuStDetector()),
         slide_wnd_step_x_(4), slide_wnd_step_y_(4),
         min_face_size_(20), max_face_size_(-1),
-        cls_thresh_(3.85f) {}
+        cls_thresh_(3.85f), tile_size_(-1), motion_gating_(false),
+        refresh_interval_(25), frame_count_(0), learn_scale_prior_(false) {}
 
   ~Impl() {}
 
@@ -55,6 +61,63 @@ class FaceDetection::Impl {
       image.data != nullptr);
   }
 
+  /** Set up the image pyramid and the detector for the input image. */
+  void Prepare(const seeta::ImageData & img) {
+    int32_t min_img_size = img.height <= img.width ? img.height : img.width;
+    min_img_size = (max_face_size_ > 0 ?
+      (min_img_size >= max_face_size_ ? max_face_size_ : min_img_size) :
+      min_img_size);
+
+    img_pyramid_.SetImage1x(img.data, img.width, img.height);
+    img_pyramid_.SetMinScale(static_cast<float>(kWndSize) / min_img_size);
+
+    detector_->SetWindowSize(kWndSize);
+    detector_->SetSlideWindowStep(slide_wnd_step_x_, slide_wnd_step_y_);
+    detector_->SetTileSize(tile_size_);
+    detector_->SetScanMask(motion_gating_ ? UpdateScanMask(img) : nullptr);
+    detector_->SetScalePrior(
+      scale_prior_.Update(img.height) ? &scale_prior_ : nullptr);
+  }
+
+  /** Learn the scale prior from the faces just detected. */
+  void LearnScalePrior(const seeta::ImageData & img) {
+    if (!learn_scale_prior_)
+      return;
+    for (size_t i = 0; i < pos_wnds_.size(); i++)
+      scale_prior_.AddFace(pos_wnds_[i], img.height);
+  }
+
+  /**
+   * Mark the regions changed since the background and the faces of the last
+   * frame. Returns null if the whole frame should be scanned.
+   */
+  const seeta::fd::ScanMask* UpdateScanMask(const seeta::ImageData & img) {
+    if (!bg_model_.Update(img, &scan_mask_))
+      frame_count_ = 0;
+    if (frame_count_++ % refresh_interval_ == 0)
+      return nullptr;
+
+    // Faces may not move enough to be seen as changed. Their boxes are grown
+    // by at least the window step at their scale and a cell, so that a face
+    // moving less than a cell is still scanned at each scale covering it.
+    for (size_t i = 0; i < pos_wnds_.size(); i++) {
+      seeta::Rect rect = pos_wnds_[i].bbox;
+      int32_t margin_x = std::max(rect.width / 4,
+        (slide_wnd_step_x_ * rect.width + kWndSize - 1) / kWndSize +
+        scan_mask_.cell_size());
+      int32_t margin_y = std::max(rect.height / 4,
+        (slide_wnd_step_y_ * rect.height + kWndSize - 1) / kWndSize +
+        scan_mask_.cell_size());
+      rect.x -= margin_x;
+      rect.y -= margin_y;
+      rect.width += 2 * margin_x;
+      rect.height += 2 * margin_y;
+      scan_mask_.SetRect(rect);
+    }
+    scan_mask_.Update();
+    return &scan_mask_;
+  }
+
  public:
   static const int32_t kWndSize = 40;
 
@@ -63,10 +126,18 @@ class FaceDetection::Impl {
   int32_t slide_wnd_step_x_;
   int32_t slide_wnd_step_y_;
   float cls_thresh_;
+  int32_t tile_size_;
+  bool motion_gating_;
+  int32_t refresh_interval_;
+  int32_t frame_count_;
+  bool learn_scale_prior_;
 
   std::vector<seeta::FaceInfo> pos_wnds_;
   std::unique_ptr<seeta::fd::Detector> detector_;
   seeta::fd::ImagePyramid img_pyramid_;
+  seeta::fd::BackgroundModel bg_model_;
+  seeta::fd::ScanMask scan_mask_;
+  seeta::fd::ScalePrior scale_prior_;
 };
 
 FaceDetection::FaceDetection(const char* model_path)
@@ -74,6 +145,16 @@ FaceDetection::FaceDetection(const char* model_path)
   impl_->detector_->LoadModel(model_path);
 }
 
+FaceDetection::FaceDetection(const std::vector<std::string> & model_paths)
+    : impl_(new seeta::FaceDetection::Impl()) {
+  for (size_t i = 0; i < model_paths.size(); i++) {
+    if (i == 0)
+      impl_->detector_->LoadModel(model_paths[i]);
+    else
+      impl_->detector_->AddModel(model_paths[i]);
+  }
+}
+
 FaceDetection::~FaceDetection() {
   if (impl_ != nullptr)
     delete impl_;
@@ -81,30 +162,43 @@ FaceDetection::~FaceDetection() {
 
 std::vector<seeta::FaceInfo> FaceDetection::Detect(
     const seeta::ImageData & img) {
+  return Detect(img, nullptr);
+}
+
+std::vector<seeta::FaceInfo> FaceDetection::Detect(
+    const seeta::ImageData & img, std::vector<int32_t>* labels) {
+  if (labels != nullptr)
+    labels->clear();
   if (!impl_->IsLegalImage(img))
     return std::vector<seeta::FaceInfo>();
 
-  int32_t min_img_size = img.height <= img.width ? img.height : img.width;
-  min_img_size = (impl_->max_face_size_ > 0 ?
-    (min_img_size >= impl_->max_face_size_ ? impl_->max_face_size_ : min_img_size) :
-    min_img_size);
-
-  impl_->img_pyramid_.SetImage1x(img.data, img.width, img.height);
-  impl_->img_pyramid_.SetMinScale(static_cast<float>(impl_->kWndSize) / min_img_size);
+  impl_->Prepare(img);
 
-  impl_->detector_->SetWindowSize(impl_->kWndSize);
-  impl_->detector_->SetSlideWindowStep(impl_->slide_wnd_step_x_,
-    impl_->slide_wnd_step_y_);
+  impl_->pos_wnds_ = impl_->detector_->DetectPerModel(&(impl_->img_pyramid_),
+    labels);
 
-  impl_->pos_wnds_ = impl_->detector_->Detect(&(impl_->img_pyramid_));
-
-  for (int32_t i = 0; i < impl_->pos_wnds_.size(); i++) {
+  for (size_t i = 0; i < impl_->pos_wnds_.size(); i++) {
     if (impl_->pos_wnds_[i].score < impl_->cls_thresh_) {
       impl_->pos_wnds_.resize(i);
+      if (labels != nullptr)
+        labels->resize(i);
       break;
     }
   }
 
+  impl_->LearnScalePrior(img);
+  return impl_->pos_wnds_;
+}
+
+std::vector<seeta::FaceInfo> FaceDetection::DetectLargest(
+    const seeta::ImageData & img, int32_t max_faces) {
+  if (!impl_->IsLegalImage(img) || max_faces <= 0)
+    return std::vector<seeta::FaceInfo>();
+
+  impl_->Prepare(img);
+  impl_->pos_wnds_ = impl_->detector_->DetectLargest(&(impl_->img_pyramid_),
+    max_faces, impl_->cls_thresh_);
+  impl_->LearnScalePrior(img);
   return impl_->pos_wnds_;
 }
 
@@ -137,4 +231,44 @@ void FaceDetection::SetScoreThresh(float thresh) {
     impl_->cls_thresh_ = thresh;
 }
 
+void FaceDetection::SetTiledDetection(bool enable, int32_t tile_size) {
+  if (!enable)
+    impl_->tile_size_ = -1;
+  else if (tile_size >= 0)
+    impl_->tile_size_ = tile_size;
+}
+
+void FaceDetection::SetMotionGating(bool enable, int32_t refresh_interval,
+    int32_t diff_thresh) {
+  impl_->motion_gating_ = enable;
+  impl_->refresh_interval_ = (refresh_interval > 0 ? refresh_interval : 1);
+  impl_->frame_count_ = 0;
+  impl_->bg_model_.SetDiffThresh(diff_thresh < 0 ? 0 :
+    (diff_thresh > 255 ? 255 : diff_thresh));
+  impl_->bg_model_.Reset();
+}
+
+void FaceDetection::SetScalePrior(void (*size_range)(int32_t row,
+    int32_t img_height, int32_t* min_size, int32_t* max_size)) {
+  impl_->scale_prior_.SetSizeRangeFunc(size_range);
+}
+
+void FaceDetection::SetScalePriorLearning(bool enable, int32_t min_num_face) {
+  impl_->learn_scale_prior_ = enable;
+  impl_->scale_prior_.Clear();
+  impl_->scale_prior_.SetMinNumFace(min_num_face);
+}
+
+void FaceDetection::SetInt8Inference(bool enable) {
+  impl_->detector_->SetQuantizedMLP(enable);
+}
+
+void FaceDetection::GetWindowStats(int32_t* num_wnd,
+    int32_t* num_scanned) const {
+  if (num_wnd != nullptr)
+    *num_wnd = impl_->detector_->num_wnd();
+  if (num_scanned != nullptr)
+    *num_scanned = impl_->detector_->num_scanned_wnd();
+}
+
 }  // namespace seeta
@@ -32,6 +32,7 @@
 #include "feat/lab_feature_map.h"
 
 #include <cmath>
+#include <cstring>
 
 #include "util/math_func.h"
 
@@ -50,6 +51,37 @@ void LABFeatureMap::Compute(const uint8_t* input, int32_t width,
   ComputeFeatureMap();
 }
 
+void LABFeatureMap::StartStream(const uint8_t* input, int32_t stride,
+    int32_t width, int32_t height, int32_t band_height) {
+  width_ = width;
+  height_ = height;
+  stream_input_ = input;
+  stream_stride_ = stride;
+  stream_height_ = height;
+  stream_row_ = 0;
+  band_height_ = band_height;
+  band_len_ = band_height + 1;
+
+  int32_t len = 2 * band_len_ * width_;
+  feat_map_.resize(len);
+  int_img_.resize(len);
+  square_int_img_.resize(len);
+  rect_sum_.resize(kRectSumRingLen * width_);
+}
+
+bool LABFeatureMap::StreamNextRow() {
+  if (stream_input_ == nullptr || stream_row_ >= stream_height_)
+    return false;
+
+  int32_t r = stream_row_++;
+  ComputeIntegralRow(r);
+  if (r >= rect_height_ - 1)
+    ComputeRectSumRow(r - rect_height_ + 1);
+  if (r >= rect_height_ * num_rect_ - 1)
+    ComputeFeatureRow(r - rect_height_ * num_rect_ + 1);
+  return true;
+}
+
 float LABFeatureMap::GetStdDev() const {
   double mean;
   double m2;
@@ -179,5 +211,87 @@ void LABFeatureMap::ComputeFeatureMap() {
   }
 }
 
+void LABFeatureMap::ComputeIntegralRow(int32_t r) {
+  const uint8_t* src = stream_input_ + r * stream_stride_;
+  int32_t* dest = int_img_.data() + (r % band_len_) * width_;
+  uint32_t* square_dest = square_int_img_.data() + (r % band_len_) * width_;
+  int32_t s = 0;
+  uint32_t square_s = 0;
+
+  if (r == 0) {
+    for (int32_t c = 0; c < width_; c++) {
+      int32_t val = static_cast<int32_t>(src[c]);
+      s += val;
+      square_s += static_cast<uint32_t>(val * val);
+      dest[c] = s;
+      square_dest[c] = square_s;
+    }
+  } else {
+    const int32_t* dest_above = int_img_.data() +
+      ((r - 1) % band_len_) * width_;
+    const uint32_t* square_dest_above = square_int_img_.data() +
+      ((r - 1) % band_len_) * width_;
+    for (int32_t c = 0; c < width_; c++) {
+      int32_t val = static_cast<int32_t>(src[c]);
+      s += val;
+      square_s += static_cast<uint32_t>(val * val);
+      dest[c] = dest_above[c] + s;
+      square_dest[c] = square_dest_above[c] + square_s;
+    }
+  }
+
+  std::memcpy(dest + band_len_ * width_, dest, width_ * sizeof(int32_t));
+  std::memcpy(square_dest + band_len_ * width_, square_dest,
+    width_ * sizeof(uint32_t));
+}
+
+void LABFeatureMap::ComputeRectSumRow(int32_t r) {
+  int32_t width = width_ - rect_width_;
+  const int32_t* bottom_left = int_img_.data() +
+    ((r + rect_height_ - 1) % band_len_) * width_;
+  const int32_t* bottom_right = bottom_left + rect_width_ - 1;
+  int32_t* dest = rect_sum_.data() + (r % kRectSumRingLen) * width_;
+
+  if (r == 0) {
+    *dest = *bottom_right;
+    seeta::fd::MathFunction::VectorSub(bottom_right + 1, bottom_left, dest + 1,
+      width);
+  } else {
+    const int32_t* top_left = int_img_.data() + ((r - 1) % band_len_) * width_;
+    const int32_t* top_right = top_left + rect_width_ - 1;
+
+    *(dest++) = (*bottom_right) - (*top_right);
+    seeta::fd::MathFunction::VectorSub(bottom_right + 1, top_right + 1, dest, width);
+    seeta::fd::MathFunction::VectorSub(dest, bottom_left, dest, width);
+    seeta::fd::MathFunction::VectorAdd(dest, top_left, dest, width);
+  }
+}
+
+void LABFeatureMap::ComputeFeatureRow(int32_t r) {
+  int32_t width = width_ - rect_width_ * num_rect_;
+  const int32_t* top = rect_sum_.data() + (r % kRectSumRingLen) * width_;
+  const int32_t* middle = rect_sum_.data() +
+    ((r + rect_height_) % kRectSumRingLen) * width_;
+  const int32_t* bottom = rect_sum_.data() +
+    ((r + 2 * rect_height_) % kRectSumRingLen) * width_;
+  uint8_t* dest = feat_map_.data() + (r % band_len_) * width_;
+
+  for (int32_t c = 0; c <= width; c++) {
+    int32_t white_rect_sum = middle[c + rect_width_];
+    uint8_t code = 0;
+    code |= (white_rect_sum >= top[c] ? 0x80 : 0x0);
+    code |= (white_rect_sum >= top[c + rect_width_] ? 0x40 : 0x0);
+    code |= (white_rect_sum >= top[c + 2 * rect_width_] ? 0x20 : 0x0);
+    code |= (white_rect_sum >= middle[c + 2 * rect_width_] ? 0x08 : 0x0);
+    code |= (white_rect_sum >= bottom[c + 2 * rect_width_] ? 0x01 : 0x0);
+    code |= (white_rect_sum >= bottom[c + rect_width_] ? 0x02 : 0x0);
+    code |= (white_rect_sum >= bottom[c] ? 0x04 : 0x0);
+    code |= (white_rect_sum >= middle[c] ? 0x10 : 0x0);
+    dest[c] = code;
+  }
+
+  std::memcpy(dest + band_len_ * width_, dest, (width + 1) * sizeof(uint8_t));
+}
+
 }  // namespace fd
 }  // namespace seeta
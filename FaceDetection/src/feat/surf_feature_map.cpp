@@ -111,8 +111,7 @@ void SURFFeatureMap::Compute(const uint8_t* input, int32_t width,
     return;  // @todo handle the error!
   }
   Reshape(width, height);
-  ComputeGradientImages(input);
-  ComputeIntegralImages();
+  ComputeIntegralImages(input);
 }
 
 void SURFFeatureMap::GetFeatureVector(int32_t feat_id, float* feat_vec) {
@@ -152,179 +151,108 @@ void SURFFeatureMap::Reshape(int32_t width, int32_t height) {
   width_ = width;
   height_ = height;
 
-  int32_t len = width_ * height_;
-  grad_x_.resize(len);
-  grad_y_.resize(len);
-  int_img_.resize(len * kNumIntChannel);
-  img_buf_.resize(len);
+  int_img_.resize(width_ * height_ * kNumIntChannel);
 }
 
-void SURFFeatureMap::ComputeGradientImages(const uint8_t* input) {
-  int32_t len = width_ * height_;
-  seeta::fd::MathFunction::UInt8ToInt32(input, img_buf_.data(), len);
-  ComputeGradX(img_buf_.data());
-  ComputeGradY(img_buf_.data());
+void SURFFeatureMap::ComputeIntegralImages(const uint8_t* input) {
+  for (int32_t r = 0; r < height_; r++)
+    ComputeIntegralRow(input, r);
 }
 
-void SURFFeatureMap::ComputeGradX(const int32_t* input) {
-  int32_t* dx = grad_x_.data();
-  int32_t len = width_ - 2;
-
-#pragma omp parallel num_threads(SEETA_NUM_THREADS)
-  {
-#pragma omp for nowait
-    for (int32_t r = 0; r < height_; r++) {
-      const int32_t* src = input + r * width_;
-      int32_t* dest = dx + r * width_;
-      *dest = ((*(src + 1)) - (*src)) << 1;
-      seeta::fd::MathFunction::VectorSub(src + 2, src, dest + 1, len);
-      dest += (width_ - 1);
-      src += (width_ - 1);
-      *dest = ((*src) - (*(src - 1))) << 1;
+void SURFFeatureMap::ComputeIntegralRow(const uint8_t* input, int32_t r) {
+  // Central differences, and one-sided ones (doubled) at the borders
+  const uint8_t* src = input + r * width_;
+  const uint8_t* src_up = (r == 0 ? src : src - width_);
+  const uint8_t* src_down = (r == height_ - 1 ? src : src + width_);
+  int32_t dy_shift = (r == 0 || r == height_ - 1 ? 1 : 0);
+
+  int32_t row_len = width_ * kNumIntChannel;
+  int32_t* dest = int_img_.data() + r * row_len;
+  const int32_t* above = (r == 0 ? nullptr : dest - row_len);
+  int32_t row_sum[kNumIntChannel] = { 0 };
+
+  AccumulatePixel((src[1] - src[0]) << 1, (src_down[0] - src_up[0]) << dy_shift,
+    row_sum, above, dest);
+
+  int32_t x = 1;
+#ifdef USE_AVX2
+  __m256i zero = _mm256_setzero_si256();
+  __m128i shift = _mm_cvtsi32_si128(dy_shift);
+  __m256i sum = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row_sum));
+  __m256i c[kNumIntChannel];
+
+  for (; x + 9 <= width_; x += 8) {
+    __m256i left = _mm256_cvtepu8_epi32(
+      _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + x - 1)));
+    __m256i right = _mm256_cvtepu8_epi32(
+      _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + x + 1)));
+    __m256i up = _mm256_cvtepu8_epi32(
+      _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src_up + x)));
+    __m256i down = _mm256_cvtepu8_epi32(
+      _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src_down + x)));
+    __m256i dx = _mm256_sub_epi32(right, left);
+    __m256i dy = _mm256_sll_epi32(_mm256_sub_epi32(down, up), shift);
+    __m256i dx_abs = _mm256_abs_epi32(dx);
+    __m256i dy_abs = _mm256_abs_epi32(dy);
+    __m256i dx_neg = _mm256_cmpgt_epi32(zero, dx);
+    __m256i dy_neg = _mm256_cmpgt_epi32(zero, dy);
+
+    // Channels of 8 pixels, one vector per channel
+    c[0] = _mm256_andnot_si256(dy_neg, dx);
+    c[1] = _mm256_andnot_si256(dy_neg, dx_abs);
+    c[2] = _mm256_and_si256(dy_neg, dx);
+    c[3] = _mm256_and_si256(dy_neg, dx_abs);
+    c[4] = _mm256_andnot_si256(dx_neg, dy);
+    c[5] = _mm256_andnot_si256(dx_neg, dy_abs);
+    c[6] = _mm256_and_si256(dx_neg, dy);
+    c[7] = _mm256_and_si256(dx_neg, dy_abs);
+
+    // Transpose to one vector (of 8 channels) per pixel
+    __m256i t[kNumIntChannel];
+    for (int32_t i = 0; i < kNumIntChannel; i += 2) {
+      t[i] = _mm256_unpacklo_epi32(c[i], c[i + 1]);
+      t[i + 1] = _mm256_unpackhi_epi32(c[i], c[i + 1]);
     }
-  }
-}
-
-void SURFFeatureMap::ComputeGradY(const int32_t* input) {
-  int32_t* dy = grad_y_.data();
-  int32_t len = width_;
-  seeta::fd::MathFunction::VectorSub(input + width_, input, dy, len);
-  seeta::fd::MathFunction::VectorAdd(dy, dy, dy, len);
-
-#pragma omp parallel num_threads(SEETA_NUM_THREADS)
-  {
-#pragma omp for nowait
-    for (int32_t r = 1; r < height_ - 1; r++) {
-      const int32_t* src = input + (r - 1) * width_;
-      int32_t* dest = dy + r * width_;
-      seeta::fd::MathFunction::VectorSub(src + (width_ << 1), src, dest, len);
+    for (int32_t i = 0; i < kNumIntChannel; i += 4) {
+      c[i] = _mm256_unpacklo_epi64(t[i], t[i + 2]);
+      c[i + 1] = _mm256_unpackhi_epi64(t[i], t[i + 2]);
+      c[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+      c[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+    }
+    for (int32_t i = 0; i < 4; i++) {
+      t[i] = _mm256_permute2x128_si256(c[i], c[i + 4], 0x20);
+      t[i + 4] = _mm256_permute2x128_si256(c[i], c[i + 4], 0x31);
     }
-  }
-  int32_t offset = (height_ - 1) * width_;
-  dy += offset;
-  seeta::fd::MathFunction::VectorSub(input + offset, input + offset - width_,
-    dy, len);
-  seeta::fd::MathFunction::VectorAdd(dy, dy, dy, len);
-}
-
-void SURFFeatureMap::ComputeIntegralImages() {
-  FillIntegralChannel(grad_x_.data(), 0);
-  FillIntegralChannel(grad_y_.data(), 4);
-
-  int32_t len = width_ * height_;
-  seeta::fd::MathFunction::VectorAbs(grad_x_.data(), img_buf_.data(), len);
-  FillIntegralChannel(img_buf_.data(), 1);
-  seeta::fd::MathFunction::VectorAbs(grad_y_.data(), img_buf_.data(), len);
-  FillIntegralChannel(img_buf_.data(), 5);
-  MaskIntegralChannel();
-  Integral();
-}
 
-void SURFFeatureMap::MaskIntegralChannel() {
-  const int32_t* grad_x = grad_x_.data();
-  const int32_t* grad_y = grad_y_.data();
-  int32_t len = width_ * height_;
-#ifdef USE_SSE
-  __m128i dx;
-  __m128i dy;
-  __m128i dx_mask;
-  __m128i dy_mask;
-  __m128i zero = _mm_set1_epi32(0);
-  __m128i xor_bits = _mm_set_epi32(0x0, 0x0, 0xffffffff, 0xffffffff);
-  __m128i data;
-  __m128i result;
-  __m128i* src = reinterpret_cast<__m128i*>(int_img_.data());
-
-  for (int32_t i = 0; i < len; i++) {
-    dx = _mm_set1_epi32(*(grad_x++));
-    dy = _mm_set1_epi32(*(grad_y++));
-    dx_mask = _mm_xor_si128(_mm_cmplt_epi32(dx, zero), xor_bits);
-    dy_mask = _mm_xor_si128(_mm_cmplt_epi32(dy, zero), xor_bits);
-
-    data = _mm_loadu_si128(src);
-    result = _mm_and_si128(data, dy_mask);
-    _mm_storeu_si128(src++, result);
-    data = _mm_loadu_si128(src);
-    result = _mm_and_si128(data, dx_mask);
-    _mm_storeu_si128(src++, result);
-  }
-#else
-  int32_t dx, dy, dx_mask, dy_mask, cmp;
-  int32_t xor_bits[] = {-1, -1, 0, 0};
-
-  int32_t* src = int_img_.data();
-  for (int32_t i = 0; i < len; i++) {
-      dy = *(grad_y++);
-      dx = *(grad_x++);
-      
-      cmp = dy < 0 ? 0xffffffff : 0x0;
-      for (int32_t j = 0; j < 4; j++) {
-          // cmp xor xor_bits
-          dy_mask = cmp ^ xor_bits[j];
-          *(src) = (*src) & dy_mask;
-          src++;
-      }
-      
-      cmp = dx < 0 ? 0xffffffff : 0x0;
-      for (int32_t j = 0; j < 4; j++) {
-          // cmp xor xor_bits
-          dx_mask = cmp ^ xor_bits[j];
-          *(src) = (*src) & dx_mask;
-          src++;
+    int32_t* dest_x = dest + x * kNumIntChannel;
+    for (int32_t i = 0; i < kNumIntChannel; i++) {
+      sum = _mm256_add_epi32(sum, t[i]);
+      __m256i val = sum;
+      if (above != nullptr) {
+        val = _mm256_add_epi32(val, _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(above + (x + i) * kNumIntChannel)));
       }
+      _mm256_storeu_si256(
+        reinterpret_cast<__m256i*>(dest_x + i * kNumIntChannel), val);
+    }
   }
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(row_sum), sum);
 #endif
-}
-
-void SURFFeatureMap::Integral() {
-  int32_t* data = int_img_.data();
-  int32_t len = kNumIntChannel * width_;
 
-  // Cummulative sum by row
-  for (int32_t r = 0; r < height_ - 1; r++) {
-    int32_t* row1 = data + r * len;
-    int32_t* row2 = row1 + len;
-    seeta::fd::MathFunction::VectorAdd(row1, row2, row2, len);
+  for (; x < width_ - 1; x++) {
+    AccumulatePixel(src[x + 1] - src[x - 1],
+      (src_down[x] - src_up[x]) << dy_shift, row_sum,
+      (above != nullptr ? above + x * kNumIntChannel : nullptr),
+      dest + x * kNumIntChannel);
   }
-  // Cummulative sum by column
-  for (int32_t r = 0; r < height_; r++)
-    VectorCumAdd(data + r * len, len, kNumIntChannel);
-}
 
-void SURFFeatureMap::VectorCumAdd(int32_t* x, int32_t len,
-    int32_t num_channel) {
-#ifdef USE_SSE
-  __m128i x1;
-  __m128i y1;
-  __m128i z1;
-  __m128i* x2 = reinterpret_cast<__m128i*>(x);
-  __m128i* y2 = reinterpret_cast<__m128i*>(x + num_channel);
-  __m128i* z2 = y2;
-
-  len = len / num_channel - 1;
-  for (int32_t i = 0; i < len; i++) {
-    // first 4 channels
-    x1 = _mm_loadu_si128(x2++);
-    y1 = _mm_loadu_si128(y2++);
-    z1 = _mm_add_epi32(x1, y1);
-    _mm_storeu_si128(z2, z1);
-    z2 = y2;
-
-    // second 4 channels
-    x1 = _mm_loadu_si128(x2++);
-    y1 = _mm_loadu_si128(y2++);
-    z1 = _mm_add_epi32(x1, y1);
-    _mm_storeu_si128(z2, z1);
-    z2 = y2;
+  if (width_ > 1) {
+    x = width_ - 1;
+    AccumulatePixel((src[x] - src[x - 1]) << 1,
+      (src_down[x] - src_up[x]) << dy_shift, row_sum,
+      (above != nullptr ? above + x * kNumIntChannel : nullptr),
+      dest + x * kNumIntChannel);
   }
-#else
-  int32_t cols = len / num_channel - 1;
-  for (int32_t i = 0; i < cols; i++) {
-    int32_t* col1 = x + i * num_channel;
-    int32_t* col2 = col1 + num_channel;
-    seeta::fd::MathFunction::VectorAdd(col1, col2, col2, num_channel);
-  }
-#endif
 }
 
 void SURFFeatureMap::ComputeFeatureVector(const SURFFeature & feat,
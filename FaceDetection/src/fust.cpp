@@ -31,6 +31,7 @@
 
 #include "fust.h"
 
+#include <cmath>
 #include <map>
 #include <memory>
 #include <string>
@@ -43,39 +44,48 @@
 #include "io/lab_boost_model_reader.h"
 #include "io/surf_mlp_model_reader.h"
 #include "util/nms.h"
+#include "util/scale_prior.h"
+#include "util/scan_mask.h"
 
 namespace seeta {
 namespace fd {
 
 bool FuStDetector::LoadModel(const std::string & model_path) {
+  fust_model_.clear();
+  model_.clear();
+  return AddModel(model_path);
+}
+
+bool FuStDetector::AddModel(const std::string & model_path) {
   std::ifstream model_file(model_path, std::ifstream::binary);
   bool is_loaded = true;
 
   if (!model_file.is_open()) {
     is_loaded = false;
   } else {
-    hierarchy_size_.clear();
-    num_stage_.clear();
-    wnd_src_id_.clear();
+    FuStModel fust_model;
+    fust_model.model_offset = static_cast<int32_t>(model_.size());
 
     int32_t hierarchy_size;
     int32_t num_stage;
     int32_t num_wnd_src;
     int32_t type_id;
-    int32_t feat_map_index = 0;
+    int32_t feat_map_index = static_cast<int32_t>(feat_map_.size());
     std::shared_ptr<seeta::fd::ModelReader> reader;
     std::shared_ptr<seeta::fd::Classifier> classifier;
     seeta::fd::ClassifierType classifier_type;
 
-    model_file.read(reinterpret_cast<char*>(&num_hierarchy_), sizeof(int32_t));
-    for (int32_t i = 0; is_loaded && i < num_hierarchy_; i++) {
+    model_file.read(reinterpret_cast<char*>(&fust_model.num_hierarchy),
+      sizeof(int32_t));
+    is_loaded = !model_file.fail() && fust_model.num_hierarchy > 0;
+    for (int32_t i = 0; is_loaded && i < fust_model.num_hierarchy; i++) {
       model_file.read(reinterpret_cast<char*>(&hierarchy_size),
         sizeof(int32_t));
-      hierarchy_size_.push_back(hierarchy_size);
+      fust_model.hierarchy_size.push_back(hierarchy_size);
 
       for (int32_t j = 0; is_loaded && j < hierarchy_size; j++) {
         model_file.read(reinterpret_cast<char*>(&num_stage), sizeof(int32_t));
-        num_stage_.push_back(num_stage);
+        fust_model.num_stage.push_back(num_stage);
 
         for (int32_t k = 0; is_loaded && k < num_stage; k++) {
           model_file.read(reinterpret_cast<char*>(&type_id), sizeof(int32_t));
@@ -99,12 +109,13 @@ bool FuStDetector::LoadModel(const std::string & model_path) {
           }
         }
 
-        wnd_src_id_.push_back(std::vector<int32_t>());
+        fust_model.wnd_src_id.push_back(std::vector<int32_t>());
         model_file.read(reinterpret_cast<char*>(&num_wnd_src), sizeof(int32_t));
         if (num_wnd_src > 0) {
-          wnd_src_id_.back().resize(num_wnd_src);
+          fust_model.wnd_src_id.back().resize(num_wnd_src);
           for (int32_t k = 0; k < num_wnd_src; k++) {
-            model_file.read(reinterpret_cast<char*>(&(wnd_src_id_.back()[k])),
+            model_file.read(
+              reinterpret_cast<char*>(&(fust_model.wnd_src_id.back()[k])),
               sizeof(int32_t));
           }
         }
@@ -112,60 +123,258 @@ bool FuStDetector::LoadModel(const std::string & model_path) {
     }
 
     model_file.close();
+
+    if (is_loaded) {
+      fust_model_.push_back(fust_model);
+      SetQuantizedMLP(quantized_mlp_);
+    } else {
+      model_.resize(fust_model.model_offset);
+    }
   }
 
   return is_loaded;
 }
 
+void FuStDetector::SetQuantizedMLP(bool quantized) {
+  quantized_mlp_ = quantized;
+  for (size_t i = 0; i < model_.size(); i++) {
+    if (model_[i]->type() == seeta::fd::ClassifierType::SURF_MLP) {
+      dynamic_cast<seeta::fd::SURFMLP*>(model_[i].get())->SetQuantized(
+        quantized);
+    }
+  }
+}
+
 std::vector<seeta::FaceInfo> FuStDetector::Detect(
     seeta::fd::ImagePyramid* img_pyramid) {
-  float score;
-  seeta::FaceInfo wnd_info;
-  seeta::Rect wnd;
+  return DetectPerModel(img_pyramid, nullptr);
+}
+
+std::vector<seeta::FaceInfo> FuStDetector::DetectPerModel(
+    seeta::fd::ImagePyramid* img_pyramid, std::vector<int32_t>* labels) {
+  if (labels != nullptr)
+    labels->clear();
+  num_wnd_ = num_scanned_wnd_ = 0;
+  if (fust_model_.empty())
+    return std::vector<seeta::FaceInfo>();
+
+  // The first hierarchies of all models share one sliding window pass.
+  std::vector<int32_t> first_cls_idx = GetFirstHierarchyClassifiers();
+  std::vector<std::vector<seeta::FaceInfo> > proposals(first_cls_idx.size());
+
   float scale_factor = 0.0;
   const seeta::ImageData* img_scaled =
     img_pyramid->GetNextScaleImage(&scale_factor);
+  while (img_scaled != nullptr) {
+    SlideWindow(*img_scaled, scale_factor, first_cls_idx, &proposals);
+    img_scaled = img_pyramid->GetNextScaleImage(&scale_factor);
+  }
 
-  wnd.height = wnd.width = wnd_size_;
+  std::vector<std::vector<seeta::FaceInfo> > faces =
+    ClassifyProposals(img_pyramid->image1x(), &proposals);
+  if (faces.size() == 1) {
+    if (labels != nullptr)
+      labels->assign(faces[0].size(), 0);
+    return faces[0];
+  }
 
-  // Sliding window
+  std::vector<seeta::FaceInfo> merged_faces;
+  std::vector<int32_t> merged_labels;
+  for (size_t i = 0; i < faces.size(); i++) {
+    merged_faces.insert(merged_faces.end(), faces[i].begin(), faces[i].end());
+    merged_labels.insert(merged_labels.end(), faces[i].size(),
+      static_cast<int32_t>(i));
+  }
 
-  std::vector<std::vector<seeta::FaceInfo> > proposals(hierarchy_size_[0]);
-  std::shared_ptr<seeta::fd::FeatureMap> & feat_map_1 =
-    feat_map_[cls2feat_idx_[model_[0]->type()]];
+  std::vector<int32_t> order(merged_faces.size());
+  for (size_t i = 0; i < order.size(); i++)
+    order[i] = static_cast<int32_t>(i);
+  std::stable_sort(order.begin(), order.end(), CompareScore(merged_faces));
+
+  std::vector<seeta::FaceInfo> sorted_faces(order.size());
+  for (size_t i = 0; i < order.size(); i++)
+    sorted_faces[i] = merged_faces[order[i]];
+  if (labels != nullptr) {
+    labels->resize(order.size());
+    for (size_t i = 0; i < order.size(); i++)
+      (*labels)[i] = merged_labels[order[i]];
+  }
+  return sorted_faces;
+}
 
-  while (img_scaled != nullptr) {
-    feat_map_1->Compute(img_scaled->data, img_scaled->width,
-      img_scaled->height);
+std::vector<seeta::FaceInfo> FuStDetector::DetectLargest(
+    seeta::fd::ImagePyramid* img_pyramid, int32_t max_faces,
+    float score_thresh) {
+  std::vector<seeta::FaceInfo> faces;
+  num_wnd_ = num_scanned_wnd_ = 0;
+  if (fust_model_.empty() || max_faces <= 0)
+    return faces;
+
+  std::vector<int32_t> first_cls_idx = GetFirstHierarchyClassifiers();
+  std::vector<std::vector<seeta::FaceInfo> > proposals(first_cls_idx.size());
+  std::vector<std::vector<seeta::FaceInfo> > scale_proposals;
+  std::vector<seeta::FaceInfo> found_faces;
+  std::vector<seeta::FaceInfo> found_faces_nms;
+  seeta::ImageData img = img_pyramid->image1x();
+  float min_support_size = 0;
+
+  // The windows classified on each scale are classified again with those of
+  // all scales at the end, as by Detect(), so their results are kept.
+  keep_wnd_results_ = true;
+
+  // From coarse to fine, i.e. from the largest faces to the smallest ones.
+  for (int32_t i = img_pyramid->num_scale() - 1; i >= 0; i--) {
+    float scale_factor = 0.0;
+    const seeta::ImageData* img_scaled =
+      img_pyramid->GetScaleImage(i, &scale_factor);
+    if (wnd_size_ / scale_factor < min_support_size)
+      break;
+    scale_proposals.assign(first_cls_idx.size(),
+      std::vector<seeta::FaceInfo>());
+    SlideWindow(*img_scaled, scale_factor, first_cls_idx, &scale_proposals);
+    for (size_t j = 0; j < proposals.size(); j++) {
+      proposals[j].insert(proposals[j].end(), scale_proposals[j].begin(),
+        scale_proposals[j].end());
+    }
+    if (min_support_size > 0)
+      continue;
+
+    // Count the faces confirmed by the following hierarchies on this scale
+    // alone. Once there are enough, the finer scales are still scanned as long
+    // as their windows may be merged into the smallest of them.
+    std::vector<std::vector<seeta::FaceInfo> > model_faces =
+      ClassifyProposals(img, &scale_proposals);
+    for (size_t j = 0; j < model_faces.size(); j++) {
+      for (size_t k = 0; k < model_faces[j].size(); k++) {
+        if (model_faces[j][k].score >= score_thresh)
+          found_faces.push_back(model_faces[j][k]);
+      }
+    }
+    found_faces_nms.clear();
+    seeta::fd::NonMaximumSuppression(&found_faces, &found_faces_nms, 0.3f);
+    found_faces.swap(found_faces_nms);
+    if (static_cast<int32_t>(found_faces.size()) >= max_faces) {
+      std::stable_sort(found_faces.begin(), found_faces.end(),
+        seeta::fd::CompareBBoxSize);
+      min_support_size = found_faces[max_faces - 1].bbox.width *
+        kSupportRatio;
+    }
+  }
 
-    wnd_info.bbox.width = static_cast<int32_t>(wnd_size_ / scale_factor + 0.5);
-    wnd_info.bbox.height = wnd_info.bbox.width;
+  std::vector<std::vector<seeta::FaceInfo> > model_faces =
+    ClassifyProposals(img, &proposals);
+  keep_wnd_results_ = false;
+  wnd_results_.clear();
+  for (size_t i = 0; i < model_faces.size(); i++) {
+    for (size_t j = 0; j < model_faces[i].size(); j++) {
+      if (model_faces[i][j].score >= score_thresh)
+        faces.push_back(model_faces[i][j]);
+    }
+  }
+  std::stable_sort(faces.begin(), faces.end(), seeta::fd::CompareBBoxSize);
+  if (static_cast<int32_t>(faces.size()) > max_faces)
+    faces.resize(max_faces);
+  return faces;
+}
 
-    int32_t max_x = img_scaled->width - wnd_size_;
-    int32_t max_y = img_scaled->height - wnd_size_;
-    for (int32_t y = 0; y <= max_y; y += slide_wnd_step_y_) {
-      wnd.y = y;
-      for (int32_t x = 0; x <= max_x; x += slide_wnd_step_x_) {
-        wnd.x = x;
-        feat_map_1->SetROI(wnd);
+std::vector<int32_t> FuStDetector::GetFirstHierarchyClassifiers() const {
+  std::vector<int32_t> cls_idx;
+  for (size_t i = 0; i < fust_model_.size(); i++) {
+    for (int32_t j = 0; j < fust_model_[i].hierarchy_size[0]; j++)
+      cls_idx.push_back(fust_model_[i].model_offset + j);
+  }
+  return cls_idx;
+}
 
-        wnd_info.bbox.x = static_cast<int32_t>(x / scale_factor + 0.5);
-        wnd_info.bbox.y = static_cast<int32_t>(y / scale_factor + 0.5);
+void FuStDetector::SlideWindow(const seeta::ImageData & img,
+    float scale_factor, const std::vector<int32_t> & cls_idx,
+    std::vector<std::vector<seeta::FaceInfo> >* proposals) {
+  if (CanSlideWindowStreamed(cls_idx)) {
+    SlideWindowStreamed(img, scale_factor, cls_idx, proposals);
+    return;
+  }
 
-        for (int32_t i = 0; i < hierarchy_size_[0]; i++) {
-          if (model_[i]->Classify(&score)) {
-            wnd_info.score = static_cast<double>(score);
-            proposals[i].push_back(wnd_info);
-          }
+  float score;
+  seeta::FaceInfo wnd_info;
+  seeta::Rect wnd;
+  int32_t num_cls = static_cast<int32_t>(cls_idx.size());
+
+  wnd.height = wnd.width = wnd_size_;
+
+  // Feature maps used by the classifiers, each computed once per scale
+  std::vector<std::shared_ptr<seeta::fd::FeatureMap> > feat_maps;
+  for (int32_t i = 0; i < num_cls; i++) {
+    std::shared_ptr<seeta::fd::FeatureMap> & feat_map =
+      feat_map_[cls2feat_idx_[model_[cls_idx[i]]->type()]];
+    if (std::find(feat_maps.begin(), feat_maps.end(), feat_map) ==
+        feat_maps.end())
+      feat_maps.push_back(feat_map);
+  }
+
+  for (size_t i = 0; i < feat_maps.size(); i++)
+    feat_maps[i]->Compute(img.data, img.width, img.height);
+
+  wnd_info.bbox.width = static_cast<int32_t>(wnd_size_ / scale_factor + 0.5);
+  wnd_info.bbox.height = wnd_info.bbox.width;
+
+  int32_t max_x = img.width - wnd_size_;
+  int32_t max_y = img.height - wnd_size_;
+  if (max_x < 0 || max_y < 0)
+    return;
+  num_wnd_ += (max_x / slide_wnd_step_x_ + 1) * (max_y / slide_wnd_step_y_ + 1);
+
+  int32_t min_y = 0;
+  if (!GetScanRows(scale_factor, &min_y, &max_y))
+    return;
+  for (int32_t y = min_y; y <= max_y; y += slide_wnd_step_y_) {
+    wnd.y = y;
+    for (int32_t x = 0; x <= max_x; x += slide_wnd_step_x_) {
+      wnd.x = x;
+      wnd_info.bbox.x = static_cast<int32_t>(x / scale_factor + 0.5);
+      wnd_info.bbox.y = static_cast<int32_t>(y / scale_factor + 0.5);
+      if (scan_mask_ != nullptr && !scan_mask_->Overlaps(wnd_info.bbox))
+        continue;
+      num_scanned_wnd_++;
+
+      for (size_t i = 0; i < feat_maps.size(); i++)
+        feat_maps[i]->SetROI(wnd);
+
+      for (int32_t i = 0; i < num_cls; i++) {
+        if (model_[cls_idx[i]]->Classify(&score)) {
+          wnd_info.score = static_cast<double>(score);
+          (*proposals)[i].push_back(wnd_info);
         }
       }
     }
+  }
+}
 
-    img_scaled = img_pyramid->GetNextScaleImage(&scale_factor);
+std::vector<std::vector<seeta::FaceInfo> > FuStDetector::ClassifyProposals(
+    const seeta::ImageData & img,
+    std::vector<std::vector<seeta::FaceInfo> >* proposals) {
+  int32_t num_model = static_cast<int32_t>(fust_model_.size());
+  std::vector<std::vector<seeta::FaceInfo> > faces(num_model);
+  int32_t proposal_idx = 0;
+  for (int32_t i = 0; i < num_model; i++) {
+    int32_t hierarchy_size = fust_model_[i].hierarchy_size[0];
+    std::vector<std::vector<seeta::FaceInfo> > model_proposals(hierarchy_size);
+    for (int32_t j = 0; j < hierarchy_size; j++)
+      model_proposals[j].swap((*proposals)[proposal_idx++]);
+    faces[i] = ClassifyProposals(fust_model_[i], img, &model_proposals);
   }
+  return faces;
+}
+
+std::vector<seeta::FaceInfo> FuStDetector::ClassifyProposals(
+    const FuStModel & fust_model, const seeta::ImageData & img,
+    std::vector<std::vector<seeta::FaceInfo> >* first_proposals) {
+  const std::vector<int32_t> & hierarchy_size = fust_model.hierarchy_size;
+  const std::vector<int32_t> & num_stage = fust_model.num_stage;
+  const std::vector<std::vector<int32_t> > & wnd_src_id = fust_model.wnd_src_id;
+  std::vector<std::vector<seeta::FaceInfo> > & proposals = *first_proposals;
 
-  std::vector<std::vector<seeta::FaceInfo> > proposals_nms(hierarchy_size_[0]);
-  for (int32_t i = 0; i < hierarchy_size_[0]; i++) {
+  std::vector<std::vector<seeta::FaceInfo> > proposals_nms(hierarchy_size[0]);
+  for (int32_t i = 0; i < hierarchy_size[0]; i++) {
     seeta::fd::NonMaximumSuppression(&(proposals[i]),
       &(proposals_nms[i]), 0.8f);
     proposals[i].clear();
@@ -173,21 +382,15 @@ std::vector<seeta::FaceInfo> FuStDetector::Detect(
 
   // Following classifiers
 
-  seeta::ImageData img = img_pyramid->image1x();
-  seeta::Rect roi;
-  std::vector<float> mlp_predicts(4);  // @todo no hard-coded number!
-  roi.x = roi.y = 0;
-  roi.width = roi.height = wnd_size_;
-
-  int32_t cls_idx = hierarchy_size_[0];
-  int32_t model_idx = hierarchy_size_[0];
+  int32_t cls_idx = hierarchy_size[0];
+  int32_t model_idx = fust_model.model_offset + hierarchy_size[0];
   std::vector<int32_t> buf_idx;
 
-  for (int32_t i = 1; i < num_hierarchy_; i++) {
-    buf_idx.resize(hierarchy_size_[i]);
-    for (int32_t j = 0; j < hierarchy_size_[i]; j++) {
-      int32_t num_wnd_src = static_cast<int32_t>(wnd_src_id_[cls_idx].size());
-      std::vector<int32_t> & wnd_src = wnd_src_id_[cls_idx];
+  for (int32_t i = 1; i < fust_model.num_hierarchy; i++) {
+    buf_idx.resize(hierarchy_size[i]);
+    for (int32_t j = 0; j < hierarchy_size[i]; j++) {
+      int32_t num_wnd_src = static_cast<int32_t>(wnd_src_id[cls_idx].size());
+      const std::vector<int32_t> & wnd_src = wnd_src_id[cls_idx];
       buf_idx[j] = wnd_src[0];
       proposals[buf_idx[j]].clear();
       for (int32_t k = 0; k < num_wnd_src; k++) {
@@ -195,9 +398,7 @@ std::vector<seeta::FaceInfo> FuStDetector::Detect(
           proposals_nms[wnd_src[k]].begin(), proposals_nms[wnd_src[k]].end());
       }
 
-      std::shared_ptr<seeta::fd::FeatureMap> & feat_map =
-        feat_map_[cls2feat_idx_[model_[model_idx]->type()]];
-      for (int32_t k = 0; k < num_stage_[cls_idx]; k++) {
+      for (int32_t k = 0; k < num_stage[cls_idx]; k++) {
         int32_t num_wnd = static_cast<int32_t>(proposals[buf_idx[j]].size());
         std::vector<seeta::FaceInfo> & bboxes = proposals[buf_idx[j]];
         int32_t bbox_idx = 0;
@@ -206,37 +407,18 @@ std::vector<seeta::FaceInfo> FuStDetector::Detect(
           if (bboxes[m].bbox.x + bboxes[m].bbox.width <= 0 ||
               bboxes[m].bbox.y + bboxes[m].bbox.height <= 0)
             continue;
-          GetWindowData(img, bboxes[m].bbox);
-          feat_map->Compute(wnd_data_.data(), wnd_size_, wnd_size_);
-          feat_map->SetROI(roi);
-
-          if (model_[model_idx]->Classify(&score, mlp_predicts.data())) {
-            float x = static_cast<float>(bboxes[m].bbox.x);
-            float y = static_cast<float>(bboxes[m].bbox.y);
-            float w = static_cast<float>(bboxes[m].bbox.width);
-            float h = static_cast<float>(bboxes[m].bbox.height);
-
-            bboxes[bbox_idx].bbox.width =
-              static_cast<int32_t>((mlp_predicts[3] * 2 - 1) * w + w + 0.5);
-            bboxes[bbox_idx].bbox.height = bboxes[bbox_idx].bbox.width;
-            bboxes[bbox_idx].bbox.x =
-              static_cast<int32_t>((mlp_predicts[1] * 2 - 1) * w + x +
-              (w - bboxes[bbox_idx].bbox.width) * 0.5 + 0.5);
-            bboxes[bbox_idx].bbox.y =
-              static_cast<int32_t>((mlp_predicts[2] * 2 - 1) * h + y +
-              (h - bboxes[bbox_idx].bbox.height) * 0.5 + 0.5);
-            bboxes[bbox_idx].score = score;
-            bbox_idx++;
-          }
+          seeta::FaceInfo wnd_info = bboxes[m];
+          if (ClassifyWindow(img, model_idx, &wnd_info))
+            bboxes[bbox_idx++] = wnd_info;
         }
         proposals[buf_idx[j]].resize(bbox_idx);
 
-        if (k < num_stage_[cls_idx] - 1) {
+        if (k < num_stage[cls_idx] - 1) {
           seeta::fd::NonMaximumSuppression(&(proposals[buf_idx[j]]),
             &(proposals_nms[buf_idx[j]]), 0.8f);
           proposals[buf_idx[j]] = proposals_nms[buf_idx[j]];
         } else {
-          if (i == num_hierarchy_ - 1) {
+          if (i == fust_model.num_hierarchy - 1) {
             seeta::fd::NonMaximumSuppression(&(proposals[buf_idx[j]]),
               &(proposals_nms[buf_idx[j]]), 0.3f);
             proposals[buf_idx[j]] = proposals_nms[buf_idx[j]];
@@ -248,13 +430,60 @@ std::vector<seeta::FaceInfo> FuStDetector::Detect(
       cls_idx++;
     }
 
-    for (int32_t j = 0; j < hierarchy_size_[i]; j++)
+    for (int32_t j = 0; j < hierarchy_size[i]; j++)
       proposals_nms[j] = proposals[buf_idx[j]];
   }
 
   return proposals_nms[0];
 }
 
+bool FuStDetector::ClassifyWindow(const seeta::ImageData & img,
+    int32_t model_idx, seeta::FaceInfo* wnd_info) {
+  WindowKey key(model_idx, wnd_info->bbox.x, wnd_info->bbox.y,
+    wnd_info->bbox.width, wnd_info->bbox.height);
+  if (keep_wnd_results_) {
+    std::map<WindowKey, std::pair<bool, seeta::FaceInfo> >::const_iterator
+      result = wnd_results_.find(key);
+    if (result != wnd_results_.end()) {
+      *wnd_info = result->second.second;
+      return result->second.first;
+    }
+  }
+
+  seeta::Rect roi;
+  roi.x = roi.y = 0;
+  roi.width = roi.height = wnd_size_;
+  std::shared_ptr<seeta::fd::FeatureMap> & feat_map =
+    feat_map_[cls2feat_idx_[model_[model_idx]->type()]];
+  GetWindowData(img, wnd_info->bbox);
+  feat_map->Compute(wnd_data_.data(), wnd_size_, wnd_size_);
+  feat_map->SetROI(roi);
+
+  float score;
+  float mlp_predicts[4];  // @todo no hard-coded number!
+  bool is_face = model_[model_idx]->Classify(&score, mlp_predicts);
+  if (is_face) {
+    float x = static_cast<float>(wnd_info->bbox.x);
+    float y = static_cast<float>(wnd_info->bbox.y);
+    float w = static_cast<float>(wnd_info->bbox.width);
+    float h = static_cast<float>(wnd_info->bbox.height);
+
+    wnd_info->bbox.width =
+      static_cast<int32_t>((mlp_predicts[3] * 2 - 1) * w + w + 0.5);
+    wnd_info->bbox.height = wnd_info->bbox.width;
+    wnd_info->bbox.x =
+      static_cast<int32_t>((mlp_predicts[1] * 2 - 1) * w + x +
+      (w - wnd_info->bbox.width) * 0.5 + 0.5);
+    wnd_info->bbox.y =
+      static_cast<int32_t>((mlp_predicts[2] * 2 - 1) * h + y +
+      (h - wnd_info->bbox.height) * 0.5 + 0.5);
+    wnd_info->score = score;
+  }
+  if (keep_wnd_results_)
+    wnd_results_[key] = std::make_pair(is_face, *wnd_info);
+  return is_face;
+}
+
 std::shared_ptr<seeta::fd::ModelReader>
 FuStDetector::CreateModelReader(seeta::fd::ClassifierType type) {
   std::shared_ptr<seeta::fd::ModelReader> reader;
@@ -303,6 +532,208 @@ FuStDetector::CreateFeatureMap(seeta::fd::ClassifierType type) {
   return feat_map;
 }
 
+bool FuStDetector::CanSlideWindowStreamed(
+    const std::vector<int32_t> & cls_idx) {
+  // Regions are classified concurrently through the const path of the LAB
+  // classifier, which requires all the classifiers to be LAB-based.
+  for (size_t i = 0; i < cls_idx.size(); i++) {
+    if (model_[cls_idx[i]]->type() !=
+        seeta::fd::ClassifierType::LAB_Boosted_Classifier)
+      return false;
+  }
+  return true;
+}
+
+void FuStDetector::SlideWindowStreamed(const seeta::ImageData & img,
+    float scale_factor, const std::vector<int32_t> & cls_idx,
+    std::vector<std::vector<seeta::FaceInfo> >* proposals) {
+  int32_t max_x = img.width - wnd_size_;
+  int32_t max_y = img.height - wnd_size_;
+  if (max_x < 0 || max_y < 0)
+    return;
+  num_wnd_ += (max_x / slide_wnd_step_x_ + 1) * (max_y / slide_wnd_step_y_ + 1);
+
+  // Rows of windows [min_y, max_y] allowed by the scale prior
+  int32_t min_y = 0;
+  if (!GetScanRows(scale_factor, &min_y, &max_y))
+    return;
+
+  int32_t num_worker = 1;
+#ifdef USE_OPENMP
+  num_worker = SEETA_NUM_THREADS;
+#endif
+
+  // The regions partition the grid of window positions: adjacent regions
+  // overlap by (wnd_size_ - step) pixels, but each window is evaluated
+  // exactly once, so no border detection is duplicated before NMS.
+  int32_t region_step_x;
+  int32_t region_step_y;
+  if (tile_size_ >= 0) {
+    // A column of the rolling band costs (wnd_size_ + 1) * 2 rows of LAB
+    // codes and the two integral images, plus the rows of rect sums.
+    int32_t tile_size = tile_size_;
+    if (tile_size == 0)
+      tile_size = kL2CacheSize / ((wnd_size_ + 1) * 2 * 9 + 7 * 4);
+    tile_size = std::max(tile_size,
+      wnd_size_ + std::max(slide_wnd_step_x_, slide_wnd_step_y_));
+    region_step_x = ((tile_size - wnd_size_) / slide_wnd_step_x_ + 1) *
+      slide_wnd_step_x_;
+    region_step_y = ((tile_size - wnd_size_) / slide_wnd_step_y_ + 1) *
+      slide_wnd_step_y_;
+  } else {
+    // One horizontal stripe per worker.
+    int32_t num_wnd_y = (max_y - min_y) / slide_wnd_step_y_ + 1;
+    region_step_x = (max_x / slide_wnd_step_x_ + 1) * slide_wnd_step_x_;
+    region_step_y = ((num_wnd_y + num_worker - 1) / num_worker) *
+      slide_wnd_step_y_;
+  }
+  int32_t num_region_x = max_x / region_step_x + 1;
+  int32_t num_region_y = (max_y - min_y) / region_step_y + 1;
+  int32_t num_region = num_region_x * num_region_y;
+
+  while (static_cast<int32_t>(stream_feat_map_.size()) < num_worker) {
+    stream_feat_map_.push_back(std::shared_ptr<seeta::fd::LABFeatureMap>(
+      new seeta::fd::LABFeatureMap()));
+  }
+
+  int32_t num_cls = static_cast<int32_t>(cls_idx.size());
+  std::vector<const seeta::fd::LABBoostedClassifier*> classifiers(num_cls);
+  for (int32_t i = 0; i < num_cls; i++) {
+    classifiers[i] = dynamic_cast<const seeta::fd::LABBoostedClassifier*>(
+      model_[cls_idx[i]].get());
+  }
+
+  int32_t wnd_size_1x = static_cast<int32_t>(wnd_size_ / scale_factor + 0.5);
+  std::vector<std::vector<std::vector<seeta::FaceInfo> > > region_proposals(
+    num_region, std::vector<std::vector<seeta::FaceInfo> >(num_cls));
+  std::vector<int32_t> region_num_scanned(num_region, 0);
+
+#pragma omp parallel for schedule(dynamic) num_threads(SEETA_NUM_THREADS)
+  for (int32_t t = 0; t < num_region; t++) {
+    int32_t worker = 0;
+#ifdef USE_OPENMP
+    worker = omp_get_thread_num();
+#endif
+    seeta::fd::LABFeatureMap* feat_map = stream_feat_map_[worker].get();
+
+    int32_t x0 = (t % num_region_x) * region_step_x;
+    int32_t y0 = min_y + (t / num_region_x) * region_step_y;
+    int32_t x1 = std::min(x0 + region_step_x - slide_wnd_step_x_, max_x);
+    int32_t y1 = std::min(y0 + region_step_y - slide_wnd_step_y_, max_y);
+    if (scan_mask_ != nullptr &&
+        !ShrinkRegion(scale_factor, &x0, &y0, &x1, &y1))
+      continue;
+    feat_map->StartStream(img.data + y0 * img.width + x0, img.width,
+      x1 - x0 + wnd_size_, y1 - y0 + wnd_size_, wnd_size_);
+
+    float score;
+    seeta::Rect wnd;
+    seeta::FaceInfo wnd_info;
+    wnd.width = wnd.height = wnd_size_;
+    wnd_info.bbox.width = wnd_info.bbox.height = wnd_size_1x;
+
+    // Classify each row of windows as soon as its band is complete.
+    while (feat_map->StreamNextRow()) {
+      wnd.y = feat_map->band_top();
+      if (wnd.y < 0 || wnd.y % slide_wnd_step_y_ != 0)
+        continue;
+      wnd_info.bbox.y = static_cast<int32_t>((y0 + wnd.y) / scale_factor + 0.5);
+      for (int32_t x = x0; x <= x1; x += slide_wnd_step_x_) {
+        wnd.x = x - x0;
+        wnd_info.bbox.x = static_cast<int32_t>(x / scale_factor + 0.5);
+        if (scan_mask_ != nullptr && !scan_mask_->Overlaps(wnd_info.bbox))
+          continue;
+        region_num_scanned[t]++;
+        feat_map->SetBandROI(wnd);
+
+        for (int32_t i = 0; i < num_cls; i++) {
+          if (classifiers[i]->Classify(*feat_map, &score)) {
+            wnd_info.score = static_cast<double>(score);
+            region_proposals[t][i].push_back(wnd_info);
+          }
+        }
+      }
+    }
+  }
+
+  for (int32_t t = 0; t < num_region; t++) {
+    num_scanned_wnd_ += region_num_scanned[t];
+    for (int32_t i = 0; i < num_cls; i++) {
+      (*proposals)[i].insert((*proposals)[i].end(),
+        region_proposals[t][i].begin(), region_proposals[t][i].end());
+    }
+  }
+}
+
+bool FuStDetector::GetScanRows(float scale_factor, int32_t* min_y,
+    int32_t* max_y) const {
+  int32_t min_row;
+  int32_t max_row;
+  if (scale_prior_ == nullptr)
+    return true;
+  if (!scale_prior_->GetRowRange(
+      static_cast<int32_t>(wnd_size_ / scale_factor + 0.5), &min_row, &max_row))
+    return false;
+
+  // Convert the rows of face centers in the original image to those of the
+  // window tops on this scale, aligned to the grid of window positions.
+  int32_t half_wnd = wnd_size_ / 2;
+  int32_t y0 = static_cast<int32_t>(std::floor(min_row * scale_factor)) -
+    half_wnd;
+  int32_t y1 = static_cast<int32_t>(std::ceil(max_row * scale_factor)) -
+    half_wnd;
+  y0 = (std::max(y0, 0) + slide_wnd_step_y_ - 1) / slide_wnd_step_y_ *
+    slide_wnd_step_y_;
+  y1 = std::min(y1, *max_y);
+  if (y1 < y0)
+    return false;
+  *min_y = std::max(*min_y, y0);
+  *max_y = y1;
+  return true;
+}
+
+bool FuStDetector::ShrinkRegion(float scale_factor, int32_t* x0, int32_t* y0,
+    int32_t* x1, int32_t* y1) const {
+  // Window rows and columns of the region are tested as a whole against the
+  // scan mask, with their extents in the original image rounded outwards.
+  seeta::Rect rect;
+  rect.x = static_cast<int32_t>(*x0 / scale_factor);
+  rect.width = static_cast<int32_t>((*x1 + wnd_size_) / scale_factor) + 2 -
+    rect.x;
+  rect.height = static_cast<int32_t>(wnd_size_ / scale_factor) + 2;
+  int32_t first = -1;
+  int32_t last = -1;
+  for (int32_t y = *y0; y <= *y1; y += slide_wnd_step_y_) {
+    rect.y = static_cast<int32_t>(y / scale_factor);
+    if (scan_mask_->Overlaps(rect)) {
+      if (first < 0)
+        first = y;
+      last = y;
+    }
+  }
+  if (first < 0)
+    return false;
+  *y0 = first;
+  *y1 = last;
+
+  rect.y = static_cast<int32_t>(*y0 / scale_factor);
+  rect.height = static_cast<int32_t>((*y1 + wnd_size_) / scale_factor) + 2 -
+    rect.y;
+  rect.width = static_cast<int32_t>(wnd_size_ / scale_factor) + 2;
+  first = -1;
+  for (int32_t x = *x0; x <= *x1; x += slide_wnd_step_x_) {
+    rect.x = static_cast<int32_t>(x / scale_factor);
+    if (scan_mask_->Overlaps(rect)) {
+      if (first < 0)
+        first = x;
+      last = x;
+    }
+  }
+  *x0 = first;
+  *x1 = last;
+  return true;
+}
+
 void FuStDetector::GetWindowData(const seeta::ImageData & img,
     const seeta::Rect & wnd) {
   int32_t pad_left;
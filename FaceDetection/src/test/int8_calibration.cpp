@@ -0,0 +1,169 @@
+/*
+ *
+ * This file is part of the open-source SeetaFace engine, which includes three modules:
+ * SeetaFace Detection, SeetaFace Alignment, and SeetaFace Identification.
+ *
+ * This file is part of the SeetaFace Detection module, containing codes implementing the
+ * face detection method described in the following paper:
+ *
+ *
+ *   Funnel-structured cascade for multi-view face detection with alignment awareness,
+ *   Shuzhe Wu, Meina Kan, Zhenliang He, Shiguang Shan, Xilin Chen.
+ *   In Neurocomputing (under review)
+ *
+ *
+ * Copyright (C) 2016, Visual Information Processing and Learning (VIPL) group,
+ * Institute of Computing Technology, Chinese Academy of Sciences, Beijing, China.
+ *
+ * The codes are mainly developed by Shuzhe Wu (a Ph.D supervised by Prof. Shiguang Shan)
+ *
+ * As an open-source face recognition engine: you can redistribute SeetaFace source codes
+ * and/or modify it under the terms of the BSD 2-Clause License.
+ *
+ * You should have received a copy of the BSD 2-Clause License along with the software.
+ * If not, see < https://opensource.org/licenses/BSD-2-Clause>.
+ *
+ * Contact Info: you can send an email to SeetaFace@vipl.ict.ac.cn for any problems.
+ *
+ * Note: the above information must be kept whenever or wherever the codes are used.
+ *
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "opencv2/highgui/highgui.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+
+#include "face_detection.h"
+
+using namespace std;
+
+/**
+ * Compare int8 inference of the MLP stages with fp32 inference on a
+ * validation list. Each line of the list is an image path, optionally
+ * followed by ground-truth boxes as groups of "x y width height". Faces
+ * detected with fp32 serve as ground truth for images without boxes.
+ */
+
+namespace {
+
+float IoU(const seeta::Rect & a, const seeta::Rect & b) {
+  int32_t x0 = max(a.x, b.x);
+  int32_t y0 = max(a.y, b.y);
+  int32_t x1 = min(a.x + a.width, b.x + b.width);
+  int32_t y1 = min(a.y + a.height, b.y + b.height);
+  if (x1 <= x0 || y1 <= y0)
+    return 0.0f;
+  float inter = static_cast<float>(x1 - x0) * (y1 - y0);
+  return inter / (a.width * a.height + b.width * b.height - inter);
+}
+
+/** Number of ground-truth boxes matched by a detection with IoU >= 0.5 */
+int32_t CountMatched(const vector<seeta::Rect> & gt,
+    const vector<seeta::FaceInfo> & faces) {
+  int32_t num_matched = 0;
+  vector<bool> used(faces.size(), false);
+  for (size_t i = 0; i < gt.size(); i++) {
+    for (size_t j = 0; j < faces.size(); j++) {
+      if (!used[j] && IoU(gt[i], faces[j].bbox) >= 0.5f) {
+        used[j] = true;
+        num_matched++;
+        break;
+      }
+    }
+  }
+  return num_matched;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+      cout << "Usage: " << argv[0]
+          << " list_path model_path"
+          << endl;
+      return -1;
+  }
+
+  seeta::FaceDetection detector(argv[2]);
+  detector.SetMinFaceSize(40);
+  detector.SetScoreThresh(2.f);
+  detector.SetImagePyramidScaleFactor(0.8f);
+  detector.SetWindowStep(4, 4);
+
+  ifstream list_file(argv[1]);
+  string line;
+  int32_t num_img = 0;
+  int32_t num_gt = 0;
+  int32_t num_matched_fp32 = 0;
+  int32_t num_matched_int8 = 0;
+  int32_t num_face_fp32 = 0;
+  int32_t num_face_int8 = 0;
+  double secs_fp32 = 0.0;
+  double secs_int8 = 0.0;
+
+  while (getline(list_file, line)) {
+    istringstream fields(line);
+    string img_path;
+    if (!(fields >> img_path))
+      continue;
+    vector<seeta::Rect> gt;
+    seeta::Rect rect;
+    while (fields >> rect.x >> rect.y >> rect.width >> rect.height)
+      gt.push_back(rect);
+
+    cv::Mat img_gray = cv::imread(img_path, cv::IMREAD_GRAYSCALE);
+    if (img_gray.empty()) {
+      cout << "Failed to read " << img_path << endl;
+      continue;
+    }
+    seeta::ImageData img_data;
+    img_data.data = img_gray.data;
+    img_data.width = img_gray.cols;
+    img_data.height = img_gray.rows;
+    img_data.num_channels = 1;
+
+    detector.SetInt8Inference(false);
+    long t0 = cv::getTickCount();
+    vector<seeta::FaceInfo> faces_fp32 = detector.Detect(img_data);
+    long t1 = cv::getTickCount();
+    detector.SetInt8Inference(true);
+    vector<seeta::FaceInfo> faces_int8 = detector.Detect(img_data);
+    long t2 = cv::getTickCount();
+    secs_fp32 += (t1 - t0) / cv::getTickFrequency();
+    secs_int8 += (t2 - t1) / cv::getTickFrequency();
+
+    if (gt.empty()) {
+      for (size_t i = 0; i < faces_fp32.size(); i++)
+        gt.push_back(faces_fp32[i].bbox);
+    }
+    num_img++;
+    num_gt += static_cast<int32_t>(gt.size());
+    num_matched_fp32 += CountMatched(gt, faces_fp32);
+    num_matched_int8 += CountMatched(gt, faces_int8);
+    num_face_fp32 += static_cast<int32_t>(faces_fp32.size());
+    num_face_int8 += static_cast<int32_t>(faces_int8.size());
+  }
+
+  if (num_gt == 0) {
+    cout << "No faces to evaluate." << endl;
+    return -1;
+  }
+
+  double recall_fp32 = static_cast<double>(num_matched_fp32) / num_gt;
+  double recall_int8 = static_cast<double>(num_matched_int8) / num_gt;
+  cout << "Images: " << num_img << ", faces: " << num_gt << endl;
+  cout << "fp32: recall " << recall_fp32 << ", detections " << num_face_fp32
+      << ", " << secs_fp32 << " seconds" << endl;
+  cout << "int8: recall " << recall_int8 << ", detections " << num_face_int8
+      << ", " << secs_int8 << " seconds" << endl;
+  cout << "Recall delta (int8 - fp32): " << recall_int8 - recall_fp32 << endl;
+
+  return 0;
+}
@@ -0,0 +1,231 @@
+/*
+ *
+ * This file is part of the open-source SeetaFace engine, which includes three modules:
+ * SeetaFace Detection, SeetaFace Alignment, and SeetaFace Identification.
+ *
+ * This file is part of the SeetaFace Detection module, containing codes implementing the
+ * face detection method described in the following paper:
+ *
+ *
+ *   Funnel-structured cascade for multi-view face detection with alignment awareness,
+ *   Shuzhe Wu, Meina Kan, Zhenliang He, Shiguang Shan, Xilin Chen.
+ *   In Neurocomputing (under review)
+ *
+ *
+ * Copyright (C) 2016, Visual Information Processing and Learning (VIPL) group,
+ * Institute of Computing Technology, Chinese Academy of Sciences, Beijing, China.
+ *
+ * The codes are mainly developed by Shuzhe Wu (a Ph.D supervised by Prof. Shiguang Shan)
+ *
+ * As an open-source face recognition engine: you can redistribute SeetaFace source codes
+ * and/or modify it under the terms of the BSD 2-Clause License.
+ *
+ * You should have received a copy of the BSD 2-Clause License along with the software.
+ * If not, see < https://opensource.org/licenses/BSD-2-Clause>.
+ *
+ * Contact Info: you can send an email to SeetaFace@vipl.ict.ac.cn for any problems.
+ *
+ * Note: the above information must be kept whenever or wherever the codes are used.
+ *
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "feat/surf_feature_map.h"
+
+using namespace std;
+
+namespace {
+
+const int32_t kNumChannel = 8;
+
+/**
+ * Reference 8-channel integral image, computed pass by pass: gradients,
+ * channels split by sign, then prefix sums.
+ */
+void ComputeReference(const uint8_t* input, int32_t width, int32_t height,
+    vector<int32_t>* int_img) {
+  vector<int32_t> dx(width * height);
+  vector<int32_t> dy(width * height);
+  for (int32_t r = 0; r < height; r++) {
+    const uint8_t* src = input + r * width;
+    for (int32_t c = 0; c < width; c++) {
+      int32_t c0 = (c == 0 ? 0 : c - 1);
+      int32_t c1 = (c == width - 1 ? c : c + 1);
+      int32_t r0 = (r == 0 ? 0 : r - 1);
+      int32_t r1 = (r == height - 1 ? r : r + 1);
+      dx[r * width + c] = (src[c1] - src[c0]) * (c1 - c0 == 1 ? 2 : 1);
+      dy[r * width + c] = (input[r1 * width + c] - input[r0 * width + c]) *
+        (r1 - r0 == 1 ? 2 : 1);
+    }
+  }
+
+  int_img->assign(width * height * kNumChannel, 0);
+  for (int32_t i = 0; i < width * height; i++) {
+    int32_t* val = int_img->data() + i * kNumChannel;
+    int32_t j = (dy[i] >= 0 ? 0 : 2);
+    val[j] = dx[i];
+    val[j + 1] = abs(dx[i]);
+    j = (dx[i] >= 0 ? 4 : 6);
+    val[j] = dy[i];
+    val[j + 1] = abs(dy[i]);
+  }
+
+  int32_t row_len = width * kNumChannel;
+  for (int32_t r = 0; r < height; r++) {
+    int32_t* row = int_img->data() + r * row_len;
+    for (int32_t i = kNumChannel; i < row_len; i++)
+      row[i] += row[i - kNumChannel];
+    if (r > 0) {
+      for (int32_t i = 0; i < row_len; i++)
+        row[i] += row[i - row_len];
+    }
+  }
+}
+
+int32_t RectSum(const vector<int32_t> & int_img, int32_t width, int32_t x,
+    int32_t y, int32_t w, int32_t h, int32_t ch) {
+  int32_t x1 = x + w - 1;
+  int32_t y1 = y + h - 1;
+  int32_t sum = int_img[(y1 * width + x1) * kNumChannel + ch];
+  if (x > 0)
+    sum -= int_img[(y1 * width + x - 1) * kNumChannel + ch];
+  if (y > 0)
+    sum -= int_img[((y - 1) * width + x1) * kNumChannel + ch];
+  if (x > 0 && y > 0)
+    sum += int_img[((y - 1) * width + x - 1) * kNumChannel + ch];
+  return sum;
+}
+
+/** Number of mismatching features of one window */
+int32_t CheckWindow(seeta::fd::SURFFeatureMap* feat_map,
+    const seeta::fd::SURFFeaturePool & pool, const vector<int32_t> & int_img,
+    int32_t width, const seeta::Rect & roi) {
+  int32_t num_mismatch = 0;
+  feat_map->SetROI(roi);
+  for (size_t i = 0; i < pool.size(); i++) {
+    const seeta::fd::SURFFeature & feat = pool[i];
+    int32_t cell_w = feat.patch.width / feat.num_cell_per_row;
+    int32_t cell_h = feat.patch.height / feat.num_cell_per_col;
+    vector<int32_t> ref;
+    for (int32_t cy = 0; cy < feat.num_cell_per_col; cy++) {
+      for (int32_t cx = 0; cx < feat.num_cell_per_row; cx++) {
+        for (int32_t ch = 0; ch < kNumChannel; ch++) {
+          ref.push_back(RectSum(int_img, width,
+            roi.x + feat.patch.x + cx * cell_w,
+            roi.y + feat.patch.y + cy * cell_h, cell_w, cell_h, ch));
+        }
+      }
+    }
+
+    double prod = 0.0;
+    for (size_t j = 0; j < ref.size(); j++)
+      prod += static_cast<double>(ref[j] * ref[j]);
+    float norm_l2 = static_cast<float>(sqrt(prod));
+
+    int32_t dim = feat_map->GetFeatureVectorDim(static_cast<int32_t>(i));
+    vector<float> feat_vec(dim);
+    feat_map->GetFeatureVector(static_cast<int32_t>(i), feat_vec.data());
+    for (int32_t j = 0; j < dim; j++) {
+      float expected = (prod != 0 ? ref[j] / norm_l2 : 0.0f);
+      if (feat_vec[j] != expected) {
+        num_mismatch++;
+        break;
+      }
+    }
+  }
+  return num_mismatch;
+}
+
+double Benchmark(seeta::fd::SURFFeatureMap* feat_map, const uint8_t* input,
+    int32_t width, int32_t height, int32_t num_iter) {
+  auto t0 = chrono::steady_clock::now();
+  for (int32_t i = 0; i < num_iter; i++)
+    feat_map->Compute(input, width, height);
+  auto t1 = chrono::steady_clock::now();
+  return chrono::duration<double, micro>(t1 - t0).count() / num_iter;
+}
+
+double BenchmarkReference(const uint8_t* input, int32_t width, int32_t height,
+    int32_t num_iter) {
+  vector<int32_t> int_img;
+  auto t0 = chrono::steady_clock::now();
+  for (int32_t i = 0; i < num_iter; i++)
+    ComputeReference(input, width, height, &int_img);
+  auto t1 = chrono::steady_clock::now();
+  return chrono::duration<double, micro>(t1 - t0).count() / num_iter;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const int32_t kPatchSize = 40;
+  int32_t level_width = (argc > 2 ? atoi(argv[1]) : 640);
+  int32_t level_height = (argc > 2 ? atoi(argv[2]) : 480);
+
+  vector<uint8_t> img(level_width * level_height);
+  srand(0);
+  for (size_t i = 0; i < img.size(); i++)
+    img[i] = static_cast<uint8_t>(rand() & 0xff);
+
+  // The same features as those of SURFFeatureMap
+  seeta::fd::SURFFeaturePool pool;
+  pool.AddPatchFormat(1, 1, 2, 2);
+  pool.AddPatchFormat(1, 2, 2, 2);
+  pool.AddPatchFormat(2, 1, 2, 2);
+  pool.AddPatchFormat(2, 3, 2, 2);
+  pool.AddPatchFormat(3, 2, 2, 2);
+  pool.Create();
+
+  seeta::fd::SURFFeatureMap feat_map;
+  vector<int32_t> int_img;
+  int32_t num_mismatch = 0;
+  seeta::Rect roi;
+  roi.width = roi.height = kPatchSize;
+
+  // Patches, including ones of constant intensity
+  for (int32_t k = 0; k < 100; k++) {
+    vector<uint8_t> patch(kPatchSize * kPatchSize);
+    for (size_t i = 0; i < patch.size(); i++)
+      patch[i] = (k % 10 == 0 ? 128 : img[(k * 37 + i * 7) % img.size()]);
+    feat_map.Compute(patch.data(), kPatchSize, kPatchSize);
+    ComputeReference(patch.data(), kPatchSize, kPatchSize, &int_img);
+    roi.x = roi.y = 0;
+    num_mismatch += CheckWindow(&feat_map, pool, int_img, kPatchSize, roi);
+  }
+
+  // Windows of a full level
+  feat_map.Compute(img.data(), level_width, level_height);
+  ComputeReference(img.data(), level_width, level_height, &int_img);
+  for (int32_t y = 0; y + kPatchSize <= level_height; y += 37) {
+    for (int32_t x = 0; x + kPatchSize <= level_width; x += 37) {
+      roi.x = x;
+      roi.y = y;
+      num_mismatch += CheckWindow(&feat_map, pool, int_img, level_width, roi);
+    }
+  }
+  cout << "Mismatching features: " << num_mismatch << endl;
+
+  cout << "40x40 patch: " << Benchmark(&feat_map, img.data(), kPatchSize,
+    kPatchSize, 100000) << " us (reference: " << BenchmarkReference(
+    img.data(), kPatchSize, kPatchSize, 100000) << " us)" << endl;
+  cout << level_width << "x" << level_height << " level: " << Benchmark(
+    &feat_map, img.data(), level_width, level_height, 20) << " us (reference: "
+    << BenchmarkReference(img.data(), level_width, level_height, 20) << " us)"
+    << endl;
+
+#ifdef USE_AVX2
+  cout << "AVX2 is used." << endl;
+#elif defined(USE_SSE)
+  cout << "SSE is used." << endl;
+#else
+  cout << "SSE is not used." << endl;
+#endif
+
+  return (num_mismatch == 0 ? 0 : 1);
+}
@@ -0,0 +1,144 @@
+/*
+ *
+ * This file is part of the open-source SeetaFace engine, which includes three modules:
+ * SeetaFace Detection, SeetaFace Alignment, and SeetaFace Identification.
+ *
+ * This file is part of the SeetaFace Detection module, containing codes implementing the
+ * face detection method described in the following paper:
+ *
+ *
+ *   Funnel-structured cascade for multi-view face detection with alignment awareness,
+ *   Shuzhe Wu, Meina Kan, Zhenliang He, Shiguang Shan, Xilin Chen.
+ *   In Neurocomputing (under review)
+ *
+ *
+ * Copyright (C) 2016, Visual Information Processing and Learning (VIPL) group,
+ * Institute of Computing Technology, Chinese Academy of Sciences, Beijing, China.
+ *
+ * The codes are mainly developed by Shuzhe Wu (a Ph.D supervised by Prof. Shiguang Shan)
+ *
+ * As an open-source face recognition engine: you can redistribute SeetaFace source codes
+ * and/or modify it under the terms of the BSD 2-Clause License.
+ *
+ * You should have received a copy of the BSD 2-Clause License along with the software.
+ * If not, see < https://opensource.org/licenses/BSD-2-Clause>.
+ *
+ * Contact Info: you can send an email to SeetaFace@vipl.ict.ac.cn for any problems.
+ *
+ * Note: the above information must be kept whenever or wherever the codes are used.
+ *
+ */
+
+#include "util/background_model.h"
+
+#ifdef USE_SSE
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+
+namespace seeta {
+namespace fd {
+
+bool BackgroundModel::Update(const seeta::ImageData & img,
+    seeta::fd::ScanMask* mask) {
+  mask->Reset(img.width, img.height, kCellSize);
+  int32_t num_cell_x = mask->num_cell_x();
+  int32_t num_cell_y = mask->num_cell_y();
+  int32_t num_cell = num_cell_x * num_cell_y;
+  Downsample(img);
+
+  if (img.width != width_ || img.height != height_) {
+    width_ = img.width;
+    height_ = img.height;
+    background_ = frame_;
+    return false;
+  }
+
+  changed_.resize(num_cell);
+  const uint8_t* frame = frame_.data();
+  uint8_t* bg = background_.data();
+  uint8_t* changed = changed_.data();
+  int32_t i = 0;
+#ifdef USE_SSE
+  __m128i thresh = _mm_set1_epi8(static_cast<char>(diff_thresh_));
+  __m128i zero = _mm_setzero_si128();
+  for (; i + 16 <= num_cell; i += 16) {
+    __m128i f = _mm_loadu_si128(reinterpret_cast<const __m128i*>(frame + i));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bg + i));
+    __m128i diff = _mm_or_si128(_mm_subs_epu8(f, b), _mm_subs_epu8(b, f));
+    // 0xff where diff > thresh, 0 otherwise
+    __m128i c = _mm_cmpeq_epi8(_mm_subs_epu8(diff, thresh), zero);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(changed + i),
+      _mm_andnot_si128(c, _mm_set1_epi8(1)));
+
+    // bg += (f - bg) / 8, computed in 16-bit lanes
+    __m128i f_lo = _mm_unpacklo_epi8(f, zero);
+    __m128i f_hi = _mm_unpackhi_epi8(f, zero);
+    __m128i b_lo = _mm_unpacklo_epi8(b, zero);
+    __m128i b_hi = _mm_unpackhi_epi8(b, zero);
+    b_lo = _mm_add_epi16(b_lo, _mm_srai_epi16(_mm_sub_epi16(f_lo, b_lo), 3));
+    b_hi = _mm_add_epi16(b_hi, _mm_srai_epi16(_mm_sub_epi16(f_hi, b_hi), 3));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(bg + i),
+      _mm_packus_epi16(b_lo, b_hi));
+  }
+#endif
+  for (; i < num_cell; i++) {
+    int32_t diff = static_cast<int32_t>(frame[i]) - bg[i];
+    changed[i] = (diff > diff_thresh_ || -diff > diff_thresh_) ? 1 : 0;
+    bg[i] = static_cast<uint8_t>(bg[i] + (diff >> 3));
+  }
+
+  for (int32_t y = 0; y < num_cell_y; y++) {
+    for (int32_t x = 0; x < num_cell_x; x++) {
+      if (changed[y * num_cell_x + x] != 0)
+        mask->SetCell(x, y);
+    }
+  }
+  return true;
+}
+
+void BackgroundModel::Downsample(const seeta::ImageData & img) {
+  int32_t num_cell_x = (img.width + kCellSize - 1) / kCellSize;
+  int32_t num_cell_y = (img.height + kCellSize - 1) / kCellSize;
+  frame_.resize(num_cell_x * num_cell_y);
+
+  for (int32_t cy = 0; cy < num_cell_y; cy++) {
+    const uint8_t* src = img.data + cy * kCellSize * img.width;
+    int32_t cell_h = std::min(kCellSize, img.height - cy * kCellSize);
+    uint8_t* dest = frame_.data() + cy * num_cell_x;
+    int32_t cx = 0;
+#ifdef USE_SSE
+    // Sum two full cells at a time
+    if (cell_h == kCellSize) {
+      for (; (cx + 2) * kCellSize <= img.width; cx += 2) {
+        __m128i sum = _mm_setzero_si128();
+        const uint8_t* p = src + cx * kCellSize;
+        for (int32_t y = 0; y < kCellSize; y++, p += img.width) {
+          sum = _mm_add_epi64(sum, _mm_sad_epu8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)),
+            _mm_setzero_si128()));
+        }
+        dest[cx] = static_cast<uint8_t>(_mm_cvtsi128_si32(sum) /
+          (kCellSize * kCellSize));
+        dest[cx + 1] = static_cast<uint8_t>(
+          _mm_cvtsi128_si32(_mm_srli_si128(sum, 8)) /
+          (kCellSize * kCellSize));
+      }
+    }
+#endif
+    for (; cx < num_cell_x; cx++) {
+      int32_t cell_w = std::min(kCellSize, img.width - cx * kCellSize);
+      const uint8_t* p = src + cx * kCellSize;
+      int32_t sum = 0;
+      for (int32_t y = 0; y < cell_h; y++, p += img.width) {
+        for (int32_t x = 0; x < cell_w; x++)
+          sum += p[x];
+      }
+      dest[cx] = static_cast<uint8_t>(sum / (cell_w * cell_h));
+    }
+  }
+}
+
+}  // namespace fd
+}  // namespace seeta
@@ -38,26 +38,51 @@ const seeta::ImageData* ImagePyramid::GetNextScaleImage(float* scale_factor) {
   if (scale_factor_ >= min_scale_) {
     if (scale_factor != nullptr)
       *scale_factor = scale_factor_;
-
-    width_scaled_ = static_cast<int32_t>(width1x_ * scale_factor_);
-    height_scaled_ = static_cast<int32_t>(height1x_ * scale_factor_);
-
-    seeta::ImageData src_img(width1x_, height1x_);
-    seeta::ImageData dest_img(width_scaled_, height_scaled_);
-    src_img.data = buf_img_;
-    dest_img.data = buf_img_scaled_;
-    seeta::fd::ResizeImage(src_img, &dest_img);
+    ResizeToScale(scale_factor_);
     scale_factor_ *= scale_step_;
-
-    img_scaled_.data = buf_img_scaled_;
-    img_scaled_.width = width_scaled_;
-    img_scaled_.height = height_scaled_;
     return &img_scaled_;
   } else {
     return nullptr;
   }
 }
 
+int32_t ImagePyramid::num_scale() const {
+  int32_t num = 0;
+  for (float scale = max_scale_; scale >= min_scale_; scale *= scale_step_)
+    num++;
+  return num;
+}
+
+const seeta::ImageData* ImagePyramid::GetScaleImage(int32_t idx,
+    float* scale_factor) {
+  // Accumulate the same way as GetNextScaleImage() for identical scales
+  float scale = max_scale_;
+  for (int32_t i = 0; i < idx; i++)
+    scale *= scale_step_;
+  if (idx < 0 || scale < min_scale_)
+    return nullptr;
+
+  if (scale_factor != nullptr)
+    *scale_factor = scale;
+  return ResizeToScale(scale);
+}
+
+const seeta::ImageData* ImagePyramid::ResizeToScale(float scale) {
+  width_scaled_ = static_cast<int32_t>(width1x_ * scale);
+  height_scaled_ = static_cast<int32_t>(height1x_ * scale);
+
+  seeta::ImageData src_img(width1x_, height1x_);
+  seeta::ImageData dest_img(width_scaled_, height_scaled_);
+  src_img.data = buf_img_;
+  dest_img.data = buf_img_scaled_;
+  seeta::fd::ResizeImage(src_img, &dest_img);
+
+  img_scaled_.data = buf_img_scaled_;
+  img_scaled_.width = width_scaled_;
+  img_scaled_.height = height_scaled_;
+  return &img_scaled_;
+}
+
 void ImagePyramid::SetImage1x(const uint8_t* img_data, int32_t width,
     int32_t height) {
   if (width > buf_img_width_ || height > buf_img_height_) {
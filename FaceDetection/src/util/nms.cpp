@@ -42,6 +42,10 @@ bool CompareBBox(const seeta::FaceInfo & a, const seeta::FaceInfo & b) {
   return a.score > b.score;
 }
 
+bool CompareBBoxSize(const seeta::FaceInfo & a, const seeta::FaceInfo & b) {
+  return a.bbox.width * a.bbox.height > b.bbox.width * b.bbox.height;
+}
+
 void NonMaximumSuppression(std::vector<seeta::FaceInfo>* bboxes,
   std::vector<seeta::FaceInfo>* bboxes_nms, float iou_thresh) {
   bboxes_nms->clear();
@@ -0,0 +1,129 @@
+/*
+ *
+ * This file is part of the open-source SeetaFace engine, which includes three modules:
+ * SeetaFace Detection, SeetaFace Alignment, and SeetaFace Identification.
+ *
+ * This file is part of the SeetaFace Detection module, containing codes implementing the
+ * face detection method described in the following paper:
+ *
+ *
+ *   Funnel-structured cascade for multi-view face detection with alignment awareness,
+ *   Shuzhe Wu, Meina Kan, Zhenliang He, Shiguang Shan, Xilin Chen.
+ *   In Neurocomputing (under review)
+ *
+ *
+ * Copyright (C) 2016, Visual Information Processing and Learning (VIPL) group,
+ * Institute of Computing Technology, Chinese Academy of Sciences, Beijing, China.
+ *
+ * The codes are mainly developed by Shuzhe Wu (a Ph.D supervised by Prof. Shiguang Shan)
+ *
+ * As an open-source face recognition engine: you can redistribute SeetaFace source codes
+ * and/or modify it under the terms of the BSD 2-Clause License.
+ *
+ * You should have received a copy of the BSD 2-Clause License along with the software.
+ * If not, see < https://opensource.org/licenses/BSD-2-Clause>.
+ *
+ * Contact Info: you can send an email to SeetaFace@vipl.ict.ac.cn for any problems.
+ *
+ * Note: the above information must be kept whenever or wherever the codes are used.
+ *
+ */
+
+#include "util/scale_prior.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace seeta {
+namespace fd {
+
+void ScalePrior::Clear() {
+  num_face_ = 0;
+  sum_r_ = sum_s_ = sum_rr_ = sum_rs_ = sum_ss_ = 0.0;
+  height_ = 0;
+}
+
+void ScalePrior::AddFace(const seeta::FaceInfo & face, int32_t img_height) {
+  double r = (face.bbox.y + face.bbox.height * 0.5) / img_height;
+  double s = face.bbox.height;
+  num_face_++;
+  sum_r_ += r;
+  sum_s_ += s;
+  sum_rr_ += r * r;
+  sum_rs_ += r * s;
+  sum_ss_ += s * s;
+}
+
+bool ScalePrior::Update(int32_t img_height) {
+  if (size_range_func_ == nullptr && num_face_ < min_num_face_) {
+    height_ = 0;
+    return false;
+  }
+  height_ = img_height;
+  min_size_.resize(kNumBin);
+  max_size_.resize(kNumBin);
+
+  if (size_range_func_ != nullptr) {
+    // Sample each bin at both ends and in the middle.
+    for (int32_t i = 0; i < kNumBin; i++) {
+      int32_t row0 = i * img_height / kNumBin;
+      int32_t row1 = std::max((i + 1) * img_height / kNumBin - 1, row0);
+      int32_t rows[3] = { row0, (row0 + row1) / 2, row1 };
+      min_size_[i] = INT32_MAX;
+      max_size_[i] = -1;
+      for (int32_t j = 0; j < 3; j++) {
+        int32_t min_size;
+        int32_t max_size;
+        size_range_func_(rows[j], img_height, &min_size, &max_size);
+        min_size_[i] = std::min(min_size_[i], min_size);
+        max_size_[i] = std::max(max_size_[i], max_size);
+      }
+    }
+    return true;
+  }
+
+  double n = num_face_;
+  double var_r = sum_rr_ / n - (sum_r_ / n) * (sum_r_ / n);
+  double slope = 0.0;
+  if (var_r > 1e-6)
+    slope = (sum_rs_ / n - (sum_r_ / n) * (sum_s_ / n)) / var_r;
+  double intercept = sum_s_ / n - slope * sum_r_ / n;
+  // Mean squared residual of the fit
+  double var_res = sum_ss_ / n - 2 * slope * sum_rs_ / n -
+    2 * intercept * sum_s_ / n + slope * slope * sum_rr_ / n +
+    2 * slope * intercept * sum_r_ / n + intercept * intercept;
+  double margin = 3.0 * std::sqrt(std::max(var_res, 0.0));
+
+  for (int32_t i = 0; i < kNumBin; i++) {
+    double s0 = slope * i / kNumBin + intercept;
+    double s1 = slope * (i + 1) / kNumBin + intercept;
+    double lo = std::min(s0, s1);
+    double hi = std::max(s0, s1);
+    // Allow at least a factor of 2 on either side, so that faces are still
+    // supported by windows of the neighbouring scales.
+    min_size_[i] = static_cast<int32_t>(std::min(lo - margin, lo / 2.0));
+    max_size_[i] = static_cast<int32_t>(std::max(hi + margin, hi * 2.0) + 1);
+  }
+  return true;
+}
+
+bool ScalePrior::GetRowRange(int32_t face_size, int32_t* min_row,
+    int32_t* max_row) const {
+  int32_t first = -1;
+  int32_t last = -1;
+  for (int32_t i = 0; i < kNumBin; i++) {
+    if (face_size >= min_size_[i] && face_size <= max_size_[i]) {
+      if (first < 0)
+        first = i;
+      last = i;
+    }
+  }
+  if (first < 0)
+    return false;
+  *min_row = first * height_ / kNumBin;
+  *max_row = (last + 1) * height_ / kNumBin - 1;
+  return true;
+}
+
+}  // namespace fd
+}  // namespace seeta
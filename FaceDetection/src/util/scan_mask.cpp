@@ -0,0 +1,95 @@
+/*
+ *
+ * This file is part of the open-source SeetaFace engine, which includes three modules:
+ * SeetaFace Detection, SeetaFace Alignment, and SeetaFace Identification.
+ *
+ * This file is part of the SeetaFace Detection module, containing codes implementing the
+ * face detection method described in the following paper:
+ *
+ *
+ *   Funnel-structured cascade for multi-view face detection with alignment awareness,
+ *   Shuzhe Wu, Meina Kan, Zhenliang He, Shiguang Shan, Xilin Chen.
+ *   In Neurocomputing (under review)
+ *
+ *
+ * Copyright (C) 2016, Visual Information Processing and Learning (VIPL) group,
+ * Institute of Computing Technology, Chinese Academy of Sciences, Beijing, China.
+ *
+ * The codes are mainly developed by Shuzhe Wu (a Ph.D supervised by Prof. Shiguang Shan)
+ *
+ * As an open-source face recognition engine: you can redistribute SeetaFace source codes
+ * and/or modify it under the terms of the BSD 2-Clause License.
+ *
+ * You should have received a copy of the BSD 2-Clause License along with the software.
+ * If not, see < https://opensource.org/licenses/BSD-2-Clause>.
+ *
+ * Contact Info: you can send an email to SeetaFace@vipl.ict.ac.cn for any problems.
+ *
+ * Note: the above information must be kept whenever or wherever the codes are used.
+ *
+ */
+
+#include "util/scan_mask.h"
+
+#include <algorithm>
+
+namespace seeta {
+namespace fd {
+
+void ScanMask::Reset(int32_t width, int32_t height, int32_t cell_size) {
+  width_ = width;
+  height_ = height;
+  cell_size_ = cell_size;
+  num_cell_x_ = (width + cell_size - 1) / cell_size;
+  num_cell_y_ = (height + cell_size - 1) / cell_size;
+  cells_.assign(num_cell_x_ * num_cell_y_, 0);
+  cell_sum_.assign((num_cell_x_ + 1) * (num_cell_y_ + 1), 0);
+}
+
+void ScanMask::SetRect(const seeta::Rect & rect) {
+  int32_t x0 = std::max(rect.x, 0);
+  int32_t y0 = std::max(rect.y, 0);
+  int32_t x1 = std::min(rect.x + rect.width, width_) - 1;
+  int32_t y1 = std::min(rect.y + rect.height, height_) - 1;
+  if (x1 < x0 || y1 < y0)
+    return;
+
+  for (int32_t y = y0 / cell_size_; y <= y1 / cell_size_; y++) {
+    for (int32_t x = x0 / cell_size_; x <= x1 / cell_size_; x++)
+      SetCell(x, y);
+  }
+}
+
+void ScanMask::Update() {
+  int32_t sum_width = num_cell_x_ + 1;
+  for (int32_t y = 0; y < num_cell_y_; y++) {
+    const uint8_t* cells = cells_.data() + y * num_cell_x_;
+    const int32_t* sum_above = cell_sum_.data() + y * sum_width;
+    int32_t* sum = cell_sum_.data() + (y + 1) * sum_width;
+    int32_t row_sum = 0;
+    for (int32_t x = 0; x < num_cell_x_; x++) {
+      row_sum += cells[x];
+      sum[x + 1] = sum_above[x + 1] + row_sum;
+    }
+  }
+}
+
+bool ScanMask::Overlaps(const seeta::Rect & rect) const {
+  int32_t x0 = std::max(rect.x, 0);
+  int32_t y0 = std::max(rect.y, 0);
+  int32_t x1 = std::min(rect.x + rect.width, width_) - 1;
+  int32_t y1 = std::min(rect.y + rect.height, height_) - 1;
+  if (x1 < x0 || y1 < y0)
+    return false;
+
+  x0 /= cell_size_;
+  y0 /= cell_size_;
+  x1 = x1 / cell_size_ + 1;
+  y1 = y1 / cell_size_ + 1;
+  int32_t sum_width = num_cell_x_ + 1;
+  return cell_sum_[y1 * sum_width + x1] - cell_sum_[y0 * sum_width + x1] -
+    cell_sum_[y1 * sum_width + x0] + cell_sum_[y0 * sum_width + x0] > 0;
+}
+
+}  // namespace fd
+}  // namespace seeta
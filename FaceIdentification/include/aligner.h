@@ -49,6 +49,12 @@ class Aligner {
   void Alignment(const ImageData &src_img, 
       const float* const llpoint, 
       Blob* const dst_blob); 
+  // Alignment of num faces of the same image, with 5 points each, and return
+  // to a Blob of num crops
+  void Alignment(const ImageData &src_img,
+      const float* const llpoint,
+      int num,
+      Blob* const dst_blob);
 
   void set_height(int height) { crop_height_ = height; }
   void set_width(int width) {crop_width_ = width; }
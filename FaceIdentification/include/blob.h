@@ -77,6 +77,13 @@ class Blob {
   void CopyTo(float* const data);
   void ToFile(const std::string file_name);
   void ToBinaryFile(const std::string file_name);
+  // Give the blob memory of capacity floats, e.g. in the arena of a memory
+  // plan, which SetData and CopyData then use instead of allocating as long
+  // as the data fits. The memory is kept by Release.
+  void SetStorage(const std::shared_ptr<float>& storage, int capacity);
+  // The number of times SetData and CopyData allocated memory because the
+  // data did not fit in the storage of the blob, over all blobs.
+  static int num_allocations();
 
   inline const float operator [](int i) const {
     return data_.get()[i];
@@ -96,9 +103,13 @@ class Blob {
   inline int shape(int index) const {
     return index < shape_.size() ? shape_[index] : 1;
   }
+  // point data_ to count_ floats, of the storage if they fit in it
+  void Allocate();
   std::shared_ptr<float> data_;
   std::vector<int> shape_;
   int count_;
+  std::shared_ptr<float> storage_;
+  int capacity_;
 };
 
 #endif // BLOB_H_
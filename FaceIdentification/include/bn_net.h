@@ -40,10 +40,17 @@ class BnNet : public Net {
   BnNet(): Net() {}
   virtual ~BnNet() {}
   virtual void SetUp();
+  virtual void Prepare();
   virtual void Execute();
+  // the mean and the standard deviation of each channel, by which Execute
+  // normalizes the input
+  void Normalization(std::vector<float>* mean, std::vector<float>* stddev);
 
  private:
   float epsilon_;
+  // the normalization computed by Prepare
+  std::vector<float> mean_;
+  std::vector<float> stddev_;
 };
 
 
@@ -37,14 +37,31 @@
 #include "net_factory.h"
 #include "net.h"
 
+#include <cstddef>
 #include <vector>
 
 class CommonNet : public Net {
  public:
   CommonNet();
   ~CommonNet();
-  // load model
-  static std::shared_ptr<Net> Load(FILE* file);
+  // load model, fusing the nets of each common net unless fuse is false
+  static std::shared_ptr<Net> Load(FILE* file, bool fuse = true);
+  // Fold the chains of subnets of a common net into fewer nets computing
+  // the same outputs: a Pad into the following Conv, and the Bn, the scaling,
+  // the bias adders and the clamping following a Conv or an InnerProduct into
+  // its weights, bias and clamping. The nets folded are removed.
+  static void Fuse(Net* net);
+  // Plan the memory of the activations of a net for the shapes of its input
+  // blobs, set by reshape: infer the shapes of all the blobs, and give each
+  // output blob of a subnet, input blob of the net and workspace of a subnet
+  // a block of one arena, shared by the blocks never alive at the same time.
+  // The net then executes without allocating memory, as long as its input is
+  // not larger. Returns the size of the arena in bytes, i.e. the peak memory
+  // of the activations, and the size they would take without sharing in
+  // total_size if given.
+  static size_t Plan(Net* net, size_t* total_size = nullptr);
+  // infer the shapes of the blobs of the subnets, as Execute passes the data
+  virtual void InferShape();
   // initialize the networks from a binary file
   virtual void SetUp();
   // execute the networks
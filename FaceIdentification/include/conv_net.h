@@ -35,20 +35,80 @@
 #include "net.h"
 #include "net_factory.h"
 
+#include <cfloat>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <vector>
 
 class ConvNet: public Net {
  public:
-  ConvNet(): Net() {}
+  // algorithms of the convolution
+  enum Algorithm {
+    AUTO,         // chosen per input size by the number of operations
+    IM2COL,       // matrix product of the weights and the unrolled input
+    WINOGRAD_2X2, // Winograd F(2x2, 3x3), for 3x3 kernels with stride 1
+    WINOGRAD_4X4  // Winograd F(4x4, 3x3), for 3x3 kernels with stride 1
+  };
+
+  ConvNet(): Net(), algorithm_(AUTO), pad_(0), lower_(-FLT_MAX),
+    upper_(FLT_MAX) {}
   virtual ~ConvNet() {}
   virtual void SetUp();
+  virtual void Prepare();
   virtual void Execute();
+  virtual void InferShape();
+  // the im2col tiles or the transformed tiles, and the workspace of their
+  // products
+  virtual int WorkspaceSize();
+
+  // force an algorithm, ignored if it does not apply to the layer
+  void SetAlgorithm(Algorithm algorithm) { algorithm_ = algorithm; }
+  // the algorithm used for an output of dst_h x dst_w
+  Algorithm SelectAlgorithm(int dst_h, int dst_w);
+
+  // The zero padding of the input, and the bias and the clamping to
+  // [lower, upper] of the outputs, none by default. They are taken over from
+  // the nets around the convolution by CommonNet::Fuse, and the bias and the
+  // clamping are applied to each tile of the product while it is in cache.
+  // Prepare must be called again if the weights change.
+  void SetPad(int pad) { pad_ = pad; }
+  int pad() const { return pad_; }
+  std::vector<float>& bias() { return bias_; }
+  void SetClamp(float lower, float upper);
+  bool clamped() const { return lower_ != -FLT_MAX || upper_ != FLT_MAX; }
  
  protected:
+  // convolution of num images by Winograd F(m x m, 3x3), m = 2 or 4, with a
+  // workspace of WorkspaceSize() floats
+  void WinogradConv(const float* src_data, int num, int src_h, int src_w,
+    int m, float* dst_data, float* workspace);
+  // the output rows of an im2col tile, for an output of dst_h x dst_w
+  int TileHeight(int dst_h, int dst_w);
+  // the images convolved together by Winograd F(m x m, 3x3), for an output
+  // of dst_h x dst_w
+  int WinogradGroup(int dst_h, int dst_w, int m);
+
+  // the floats of the im2col matrix of one tile of output rows
+  static const int kIm2colTileSize = 64 * 1024;
+  // the tiles of the images transformed together by Winograd, at least, so
+  // that the products of small images have enough columns
+  static const int kWinogradTiles = 128;
+
   int stride_h_;
   int stride_w_;
+  Algorithm algorithm_;
+  int pad_;
+  std::vector<float> bias_;
+  float lower_;
+  float upper_;
+  // the weights (dst_channels, kernel size) packed by pack_matrix
+  std::vector<float> packed_weight_;
+  // the weights transformed for Winograd F(2x2, 3x3) and F(4x4, 3x3), one
+  // matrix (dst_channels, src_channels) per element of the transformed tile,
+  // packed by pack_matrix; empty if the layer is not 3x3 with stride 1
+  std::vector<float> winograd2_weight_;
+  std::vector<float> winograd4_weight_;
 };
 
 #endif //CONV_NET_H_
@@ -42,6 +42,11 @@ class EltwiseNet: public Net {
   virtual ~EltwiseNet() {}
   virtual void SetUp();
   virtual void Execute();
+  // the operation, with the factor of SCALE and the bounds of CLOSE
+  const std::string& op() const { return op_; }
+  float scale() const { return scale_; }
+  float lower() const { return lower_; }
+  float upper() const { return upper_; }
  protected:
   std::string op_;
   float scale_;
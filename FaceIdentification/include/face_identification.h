@@ -35,6 +35,8 @@
 
 #include "common.h"
 
+#include <vector>
+
 typedef float* FaceFeatures;
 
 namespace seeta {
@@ -85,6 +87,22 @@ public:
       const FacialLandmark *llpoint,
       FaceFeatures const feats);
 
+  // Extract features of many cropping faces, pushed through the network in
+  // batches so that each layer processes several faces at once.
+  // 'feats' must be initialized with size of crops.size() * feature_size(),
+  // and receives the features in the order of the crops.
+  SEETA_API uint8_t ExtractFeatures(const std::vector<ImageData> &crops,
+      FaceFeatures const feats);
+
+  // Extract features for many faces in a 3-channels image, given 5 located   \
+  landmark points per face, i.e. llpoints[5 * i] to llpoints[5 * i + 4] for  \
+  the i-th face.
+  // 'feats' must be initialized with size of llpoints.size() / 5 *           \
+  feature_size().
+  SEETA_API uint8_t ExtractFeaturesWithCrop(const ImageData &src_image,
+      const std::vector<FacialLandmark> &llpoints,
+      FaceFeatures const feats);
+
   // Calculate similarity of face features fc1 and fc2.
   // dim = -1 default feature size
   SEETA_API float CalcSimilarity(FaceFeatures const fc1,
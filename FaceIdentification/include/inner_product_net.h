@@ -35,18 +35,34 @@
 #include "net.h"
 #include "net_factory.h"
 
+#include <cfloat>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <vector>
 
 class InnerProductNet: public Net {
  public:
-  InnerProductNet(): Net() {}
+  InnerProductNet(): Net(), lower_(-FLT_MAX), upper_(FLT_MAX) {}
   virtual ~InnerProductNet() {}
   virtual void SetUp();
   virtual void Execute();
+  virtual void InferShape();
+  virtual int WorkspaceSize();
+
+  // The bias and the clamping to [lower, upper] of the outputs, none by
+  // default, taken over from the following nets by CommonNet::Fuse.
+  std::vector<float>& bias() { return bias_; }
+  void SetClamp(float lower, float upper) {
+    lower_ = lower;
+    upper_ = upper;
+  }
+  bool clamped() const { return lower_ != -FLT_MAX || upper_ != FLT_MAX; }
  
  protected:
+  std::vector<float> bias_;
+  float lower_;
+  float upper_;
 };
 
 #endif //INNER_PRODUCT_NET_H_
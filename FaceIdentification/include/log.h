@@ -68,7 +68,11 @@ class ViplLog {
  public:
   template<class T>
   ViplLog(const T &options) {
+#ifdef __VIPL_LOG__
     my_cout_ << options;
+#else
+    (void)options;
+#endif
   }
   ~ViplLog();
   template<class T>
@@ -51,7 +51,37 @@ float simd_dot(const float* x, const float* y, const long& len);
 // MA = ta ? A^T : A;
 // MB = tb ? B^T : B;
 // return C(n, m) = MA(n, k) * MB(k, m);
+// Without _BLAS, only ta && !tb is supported, i.e. C[i * n + j] is the inner
+// product of the i-th row of B and the j-th row of A (both of length k). It is
+// computed by blocks packed for AVX2/FMA (6 x 16) or SSE (4 x 8) micro-kernels,
+// chosen at run time, or by inner products if m is too small to fill them.
+// The workspace of product_workspace_size(n, m) floats is allocated by each
+// call if null.
 void matrix_procuct(const float* A, const float* B, float* C, const int n,
-    const int m, const int k, bool ta = false, bool tb = false);
+    const int m, const int k, bool ta = false, bool tb = false,
+    float* workspace = nullptr);
+int product_workspace_size(const int n, const int m);
+
+// what is applied to each tile of the product before it leaves the cache:
+// C[i * ldc + j] = min(max(C[i * ldc + j] + bias[i], lower), upper), without
+// the bias if it is null
+struct ProductEpilogue {
+  const float* bias;
+  float lower;
+  float upper;
+};
+
+// matrix product with B packed beforehand, e.g. the weights of a layer at load
+// time: C[i * ldc + j] is the inner product of the i-th row of B(m, k) and the
+// j-th row of A(n, k), as matrix_procuct(A, B, C, n, m, k, true, false) with
+// ldc = n. packed_matrix_size gives the number of floats of the packed B, and
+// packed_product_workspace_size those of the workspace, which is allocated by
+// each call if null.
+int packed_matrix_size(const int m, const int k);
+void pack_matrix(const float* B, const int m, const int k, float* packed);
+int packed_product_workspace_size(const int n);
+void matrix_procuct_packed(const float* A, const float* packed_B, float* C,
+    const int n, const int m, const int k, const int ldc,
+    float* workspace = nullptr, const ProductEpilogue* epilogue = nullptr);
 
 #endif // MATH_FUNCTIONS_H_
@@ -45,6 +45,7 @@ class MaxPoolingNet: public Net {
   virtual ~MaxPoolingNet() {}
   virtual void SetUp();
   virtual void Execute();
+  virtual void InferShape();
  
  protected:
   int kernel_h_;
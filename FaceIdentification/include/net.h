@@ -48,6 +48,25 @@ class Net {
   // execute the networks
   virtual void Execute() = 0;
 
+  // compute what depends only on the params (e.g. transformed weights), once
+  // they are loaded
+  virtual void Prepare() {}
+
+  // set the shapes of the output blobs from those of the input blobs, given
+  // by reshape, without computing anything; the output has the shape of the
+  // input by default
+  virtual void InferShape();
+
+  // the floats of scratch memory Execute needs for the shapes of the input
+  // blobs, none by default
+  virtual int WorkspaceSize() { return 0; }
+
+  // scratch memory of size floats for Execute, e.g. assigned by a memory plan
+  void SetWorkspace(float* workspace, int size) {
+    workspace_ = workspace;
+    workspace_size_ = size;
+  }
+
   // check input blobs
   virtual void CheckInput();
 
@@ -133,6 +152,15 @@ class Net {
   // params in the networks
   HyperParam hyper_params_;
   std::vector<Blob> params_;
+
+  // scratch memory of at least size floats: the one set by SetWorkspace if it
+  // is large enough, or else memory kept by the net
+  float* Workspace(int size);
+
+ private:
+  float* workspace_;
+  int workspace_size_;
+  std::vector<float> own_workspace_;
 };
 
 #endif //NET_H_
@@ -45,6 +45,9 @@ class PadNet: public Net {
   virtual ~PadNet() {}
   virtual void SetUp();
   virtual void Execute();
+  virtual void InferShape();
+  // the padding on each side, the same for all as set up from "pad"
+  int pad() const { return left_; }
  
  protected:
   int left_, right_, bottom_, top_;
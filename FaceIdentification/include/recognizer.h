@@ -52,6 +52,7 @@ public:
       net_ = nullptr;
       aligner_.reset(new Aligner(crop_height_, crop_width_, "linear"));
       feat_size_ = 0;
+      planned_batch_ = 0;
     } 
     else {
 	  crop_width_ = 0;
@@ -60,6 +61,7 @@ public:
 	  net_ = nullptr;
 	  aligner_ = nullptr;
 	  feat_size_ = 0;
+	  planned_batch_ = 0;
       LoadModel(model_path);
     }
   }
@@ -81,6 +83,9 @@ public:
 		||  crop_width_ != aligner_->CropHeight())*/
     aligner_.reset(new Aligner(crop_height_, crop_width_, "linear"));
     net_ = CommonNet::Load(file);
+    // the activations of one face take one arena, reused by each extraction
+    planned_batch_ = 0;
+    PlanBatch(1);
     return 1;
   }
 
@@ -92,27 +97,48 @@ public:
 
   uint8_t ExtractFeature(unsigned char* const u_data, float* const feat, 
       int n = 1) {
-    net_->input_blobs(0)->CopyData(n, crop_height_, crop_width_, 
-		                           crop_channels_, u_data);
-    net_->input_blobs(0)->Permute(1, 4, 2, 3);
-    net_->Execute();
+    // the crops are n x height x width x channels
+    const int crop_size = crop_mem_size();
+    for (int i = 0; i < n; i += kMaxBatchSize) {
+      const int num = n - i < kMaxBatchSize ? n - i : kMaxBatchSize;
+      PlanBatch(num);
+      Blob* const input = net_->input_blobs(0);
+      input->SetData(num, crop_channels_, crop_height_, crop_width_);
+      for (int j = 0; j < num; ++ j)
+        CopyCrop(u_data + (i + j) * crop_size, input->data().get() +
+          input->offset(j));
+      Forward(feat + i * feat_size_);
+    }
+    return 1;
+  }
 
-    net_->output_blobs(0)->CopyTo(feat);
-    net_->Release();
+  uint8_t ExtractFeatures(const ImageData* const crops, float* const feat,
+      int n) {
+    for (int i = 0; i < n; i += kMaxBatchSize) {
+      const int num = n - i < kMaxBatchSize ? n - i : kMaxBatchSize;
+      PlanBatch(num);
+      Blob* const input = net_->input_blobs(0);
+      input->SetData(num, crop_channels_, crop_height_, crop_width_);
+      for (int j = 0; j < num; ++ j)
+        CopyCrop(crops[i + j].data, input->data().get() + input->offset(j));
+      Forward(feat + i * feat_size_);
+    }
     return 1;
   }
 
   uint8_t ExtractFeatureWithCrop(const ImageData &src_img, 
-      float* const points, float* const feat) {
-    // crop
+      float* const points, float* const feat, int n = 1) {
+    // the points are 5 (x, y) pairs per face
     Blob crop_blob;
-    aligner_->Alignment(src_img, points, &crop_blob);
-    // extract feature
-    net_->input_blobs(0)->SetData(crop_blob);
-    net_->Execute();
-
-    net_->output_blobs(0)->CopyTo(feat);
-    net_->Release();
+    for (int i = 0; i < n; i += kMaxBatchSize) {
+      const int num = n - i < kMaxBatchSize ? n - i : kMaxBatchSize;
+      PlanBatch(num);
+      // crop
+      aligner_->Alignment(src_img, points + i * 10, num, &crop_blob);
+      // extract feature
+      net_->input_blobs(0)->SetData(crop_blob);
+      Forward(feat + i * feat_size_);
+    }
 	return 1;
   }
 
@@ -127,7 +153,38 @@ public:
   uint32_t crop_mem_size() { return crop_width_ * crop_height_ * crop_channels_; }
   uint32_t feature_size() { return feat_size_; }
 
+  // The faces pushed through the net together by the extractions of many
+  // faces, so that the fully connected layers multiply matrices.
+  static const int kMaxBatchSize = 16;
+
 private:
+  // Plan the arena of the activations for batches of num faces, if the arena
+  // of the largest batch planned so far is smaller.
+  void PlanBatch(int num) {
+    if (num <= planned_batch_)
+      return;
+    net_->input_blobs(0)->reshape(num, crop_channels_, crop_height_,
+                                  crop_width_);
+    CommonNet::Plan(net_.get());
+    planned_batch_ = num;
+  }
+
+  // Convert a crop from height x width x channels to channels x height x
+  // width.
+  void CopyCrop(const unsigned char* const u_data, float* const data) {
+    const int size = crop_height_ * crop_width_;
+    for (int c = 0; c < crop_channels_; ++ c) {
+      for (int j = 0; j < size; ++ j)
+        data[c * size + j] = u_data[j * crop_channels_ + c];
+    }
+  }
+
+  void Forward(float* const feat) {
+    net_->Execute();
+    net_->output_blobs(0)->CopyTo(feat);
+    net_->Release();
+  }
+
   std::shared_ptr<Net> net_;
   std::shared_ptr<Aligner> aligner_;
   uint32_t crop_width_;
@@ -135,6 +192,7 @@ private:
   uint32_t crop_channels_;
 
   uint32_t feat_size_;
+  int planned_batch_;
   uint8_t isLoadModel() {
     return net_ != nullptr;
   }
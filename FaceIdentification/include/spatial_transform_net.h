@@ -41,6 +41,7 @@ class SpatialTransformNet : public Net {
   virtual ~SpatialTransformNet() {}
   virtual void SetUp();
   virtual void Execute();
+  virtual void InferShape();
  
  protected:
   // sampling for common blob data
@@ -41,6 +41,7 @@ class TransformationMakerNet: public Net {
   virtual ~TransformationMakerNet() {}
   virtual void SetUp();
   virtual void Execute();
+  virtual void InferShape();
  protected:
   // the number of feature points
   int points_num_;
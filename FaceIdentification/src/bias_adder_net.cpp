@@ -58,7 +58,8 @@ void BiasAdderNet::Execute() {
   LOG(DEBUG) << "bias blob: (" << bias->num() << "," << bias->channels() 
     << "," << bias->height() << "," << bias->width() << ")";
   
-  float* const dst_head = new float[num*channels*height*width];
+  output->SetData(num, channels, height, width);
+  float* const dst_head = output->data().get();
 
   int size = height * width;
   for (int n = 0, offset = 0; n < num; ++n) {
@@ -69,8 +70,6 @@ void BiasAdderNet::Execute() {
     }
   }
 
-  output->CopyData(num, channels, height, width, dst_head);
-  delete []dst_head;
   CheckOutput();
 }
 
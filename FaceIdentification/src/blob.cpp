@@ -31,13 +31,18 @@
 
 #include "blob.h"
 
+#include <atomic>
 #include <cstdio>
 #include <cstring>
 #include <fstream>
 
+static std::atomic<int> g_num_allocations(0);
+
 Blob::Blob() {
   data_ = nullptr;
   shape_.clear();
+  count_ = 0;
+  capacity_ = 0;
 }
 
 Blob::Blob(const Blob &source) {
@@ -46,6 +51,7 @@ Blob::Blob(const Blob &source) {
   shape_ = source.shape();
   count_ = source.count();
   data_ = source.data();
+  capacity_ = 0;
 }
 
 Blob::Blob(int n, int c, int h, int w) {
@@ -57,6 +63,7 @@ Blob::Blob(int n, int c, int h, int w) {
   shape_[2] = h;
   shape_[3] = w;
   count_ = n * c * h * w;
+  capacity_ = 0;
 }
 
 Blob::Blob(int n, int c, int h, int w, float* data) {
@@ -68,6 +75,7 @@ Blob::Blob(int n, int c, int h, int w, float* data) {
   shape_[2] = h;
   shape_[3] = w;
   count_ = n * c * h * w;
+  capacity_ = 0;
   data_.reset(new float[count_], std::default_delete<float[]>());
   memcpy(data_.get(), data, count_ * sizeof(float));
 }
@@ -79,6 +87,7 @@ Blob::Blob(FILE* file) {
   CHECK_EQ(fread(&(shape_[2]), sizeof(int), 1, file), 1);
   CHECK_EQ(fread(&(shape_[3]), sizeof(int), 1, file), 1);
   count_ = shape_[0] * shape_[1] * shape_[2] * shape_[3];
+  capacity_ = 0;
   data_.reset(new float[count_], std::default_delete<float[]>());
   CHECK_EQ(fread(data_.get(), sizeof(float), count_, file), count_);
 }
@@ -135,16 +144,16 @@ void Blob::Release() {
 
 void Blob::SetData() {
   if (!data_)
-    data_.reset(new float[count_], std::default_delete<float[]>());
+    Allocate();
 }
 
 
 void Blob::SetData(Blob &source) {
   if (data_)
     data_ = nullptr;
-  shape_ = source.shape();
+  shape_ = source.shape_;
   count_ = num() * channels() * height() * width();
-  data_ = source.data();
+  data_ = source.data_;
 }
 
 void Blob::SetData(int n, int c, int h, int w) {
@@ -156,7 +165,7 @@ void Blob::SetData(int n, int c, int h, int w) {
   shape_[2] = h;
   shape_[3] = w;
   count_ = n * c * h * w;
-  data_.reset(new float[count_], std::default_delete<float[]>());
+  Allocate();
 }
 
 
@@ -169,7 +178,7 @@ void Blob::CopyData(int n, int c, int h, int w, const float* const data) {
   shape_[2] = h;
   shape_[3] = w;
   count_ = n * c * h * w;
-  data_.reset(new float[count_], std::default_delete<float[]>());
+  Allocate();
   memcpy(data_.get(), data, count_ * sizeof(float));
 }
 
@@ -183,12 +192,30 @@ void Blob::CopyData(int n, int c, int h, int w,
   shape_[2] = h;
   shape_[3] = w;
   count_ = n * c * h * w;
-  data_.reset(new float[count_], std::default_delete<float[]>());
+  Allocate();
   float* data_head = data_.get();
   for (int i = 0; i < count_; ++ i)
     data_head[i] = data[i];
 }
 
+void Blob::SetStorage(const std::shared_ptr<float>& storage, int capacity) {
+  storage_ = storage;
+  capacity_ = capacity;
+}
+
+void Blob::Allocate() {
+  if (count_ > 0 && count_ <= capacity_) {
+    data_ = storage_;
+  } else {
+    data_.reset(new float[count_], std::default_delete<float[]>());
+    ++g_num_allocations;
+  }
+}
+
+int Blob::num_allocations() {
+  return g_num_allocations;
+}
+
 void Blob::CopyTo(unsigned char* const data) {
   const float* const data_head = data_.get();
   for (int i = 0; i < count_; ++ i)
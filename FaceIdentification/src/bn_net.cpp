@@ -43,24 +43,44 @@ void BnNet::SetUp() {
   this->params().resize(3);
 }
 
+void BnNet::Prepare() {
+  Normalization(&mean_, &stddev_);
+}
+
 void BnNet::Execute() {
   CheckInput();
  
   const Blob* const input = this->input_blobs(0);
-  const Blob* const para_mean = this->params(0);
-  const Blob* const para_var = this->params(1);
-  const Blob* const para_scale = this->params(2);
   Blob* const output = this->output_blobs(0);
   
   int channels = input->channels();
-  CHECK_EQ(channels, para_mean->channels());
-  CHECK_EQ(channels, para_var->channels());
+  CHECK_EQ(channels, mean_.size());
+  CHECK_EQ(channels, stddev_.size());
 
   int height = input->height();
   int width = input->width();
   int num = input->num();
   
-  float* const dst_head = new float[num*channels*height*width];
+  output->SetData(num, channels, height, width);
+  float* const dst_head = output->data().get();
+
+  int size = height * width;
+  for (int n = 0, offset = 0; n < num; ++n) {
+    for (int ichannel = 0; ichannel < channels; ++ichannel) {
+      for (int i = 0; i < size; ++i, ++offset) {
+        dst_head[offset] = ((*input)[offset] - mean_[ichannel]) /
+          stddev_[ichannel];
+      }
+	}
+  }
+  CheckOutput(); 
+}
+
+void BnNet::Normalization(std::vector<float>* mean,
+    std::vector<float>* stddev) {
+  const Blob* const para_mean = this->params(0);
+  const Blob* const para_var = this->params(1);
+  const Blob* const para_scale = this->params(2);
 
   float scale = (*para_scale)[0];
   if (scale > 0){
@@ -73,19 +93,13 @@ void BnNet::Execute() {
 	}
   }
 
-  int size = height * width;
-  for (int n = 0, offset = 0; n < num; ++n) {
-    for (int ichannel = 0; ichannel < channels; ++ichannel) {
-      float mean = (*para_mean)[ichannel] * scale;
-      float var = sqrt((*para_var)[ichannel] * scale + epsilon_);
-      for (int i = 0; i < size; ++i, ++offset) {
-        dst_head[offset] = ((*input)[offset] - mean) / var;
-      }
-	}
+  int channels = para_mean->channels();
+  mean->resize(channels);
+  stddev->resize(channels);
+  for (int ichannel = 0; ichannel < channels; ++ichannel) {
+    (*mean)[ichannel] = (*para_mean)[ichannel] * scale;
+    (*stddev)[ichannel] = sqrt((*para_var)[ichannel] * scale + epsilon_);
   }
-  output->CopyData(num, channels, height, width, dst_head); 
-  delete[] dst_head;
-  CheckOutput(); 
 }
 
 REGISTER_NET_CLASS(Bn);
@@ -30,6 +30,17 @@
  */
 
 #include "common_net.h"
+#include "bias_adder_net.h"
+#include "bn_net.h"
+#include "conv_net.h"
+#include "eltwise_net.h"
+#include "inner_product_net.h"
+#include "pad_net.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <map>
 
 CommonNet::CommonNet() {
   nets_.clear();
@@ -55,7 +66,7 @@ CommonNet::~CommonNet() {
   params_.clear();
 }
 
-std::shared_ptr<Net> CommonNet::Load(FILE* file) {
+std::shared_ptr<Net> CommonNet::Load(FILE* file, bool fuse) {
   // Todo: assert file format
   int len;
   CHECK_EQ(fread(&len, sizeof(int), 1, file), 1);
@@ -77,6 +88,7 @@ std::shared_ptr<Net> CommonNet::Load(FILE* file) {
     << param.channels() << "," << param.height() << ","<< param.width() << ")";
     net->params(i)->SetData(param);
   }
+  net->Prepare();
 
   int num_subnet = net->nets().size();
   int num_in = net->input_blobs().size();
@@ -90,7 +102,7 @@ std::shared_ptr<Net> CommonNet::Load(FILE* file) {
 
   // subnet
   for (int i = 0; i < num_subnet; ++ i) {
-    nets[i] = Load(file);
+    nets[i] = Load(file, fuse);
     nets[i]->SetFather(net.get());
   }
   // input and output plugs
@@ -131,11 +143,341 @@ std::shared_ptr<Net> CommonNet::Load(FILE* file) {
         exit(0);
       }
     }
+    if (fuse) {
+      Fuse(net.get());
+    }
   }
   delete []net_type;
   return net;
 }
 
+namespace {
+
+// the subnet of father whose only input is the only destination of the first
+// output of producer, if it has a single output too
+Net* SoleConsumer(Net* father, Net* producer) {
+  if (producer->output_blobs().size() != 1 ||
+      producer->output_plugs(0).size() != 1) {
+    return nullptr;
+  }
+  std::vector<std::shared_ptr<Net> >& nets = father->nets();
+  for (int i = 0; i < nets.size(); ++ i) {
+    if (nets[i]->input_blobs().size() == 1 &&
+        nets[i]->output_blobs().size() == 1 &&
+        nets[i]->input_blobs(0) == producer->output_plugs(0)[0]) {
+      return nets[i].get();
+    }
+  }
+  return nullptr;
+}
+
+// fold consumer into producer, a ConvNet or an InnerProductNet whose weights
+// have one row per output channel, if it is a net that can be folded
+template <typename ProducerNet>
+bool FoldInto(ProducerNet* producer, Net* consumer) {
+  Blob* const weight = producer->params(0);
+  int channels = weight->num();
+  int row_len = weight->count() / channels;
+  // the bias is either empty or one per output channel
+  std::vector<float>& bias = producer->bias();
+
+  if (BnNet* bn = dynamic_cast<BnNet*>(consumer)) {
+    if (producer->clamped() || bn->params(0)->channels() != channels) {
+      return false;
+    }
+    bias.resize(channels);
+    std::vector<float> mean, stddev;
+    bn->Normalization(&mean, &stddev);
+    for (int c = 0; c < channels; ++ c) {
+      for (int i = 0; i < row_len; ++ i) {
+        (*weight)[c * row_len + i] /= stddev[c];
+      }
+      bias[c] = (bias[c] - mean[c]) / stddev[c];
+    }
+    return true;
+  }
+  if (BiasAdderNet* adder = dynamic_cast<BiasAdderNet*>(consumer)) {
+    const Blob* const other = adder->params(0);
+    if (producer->clamped() || other->channels() != channels) {
+      return false;
+    }
+    bias.resize(channels);
+    for (int c = 0; c < channels; ++ c) {
+      bias[c] += (*other)[c];
+    }
+    return true;
+  }
+  EltwiseNet* eltwise = dynamic_cast<EltwiseNet*>(consumer);
+  if (eltwise == nullptr) {
+    return false;
+  }
+  if (eltwise->op() == "SCALE") {
+    if (producer->clamped()) {
+      return false;
+    }
+    bias.resize(channels);
+    for (int i = 0; i < weight->count(); ++ i) {
+      (*weight)[i] *= eltwise->scale();
+    }
+    for (int c = 0; c < channels; ++ c) {
+      bias[c] *= eltwise->scale();
+    }
+    return true;
+  }
+  if (eltwise->op() == "BAIS_ADDER") {
+    // only a bias per channel, as a bias per pixel depends on the input size
+    const Blob* const other = eltwise->params(0);
+    if (producer->clamped() || other->channels() != channels ||
+        other->count() != channels) {
+      return false;
+    }
+    bias.resize(channels);
+    for (int c = 0; c < channels; ++ c) {
+      bias[c] += (*other)[c];
+    }
+    return true;
+  }
+  if (eltwise->op() == "CLOSE") {
+    if (producer->clamped() || eltwise->lower() > eltwise->upper()) {
+      return false;
+    }
+    producer->SetClamp(eltwise->lower(), eltwise->upper());
+    return true;
+  }
+  return false;
+}
+
+// replace the plugs of father and its subnets to from by plugs to to
+void Replug(Net* father, Blob* from, Blob* to) {
+  std::vector<std::vector<Blob*> >& input_plugs = father->input_plugs();
+  for (int i = 0; i < input_plugs.size(); ++ i) {
+    std::replace(input_plugs[i].begin(), input_plugs[i].end(), from, to);
+  }
+  std::vector<std::shared_ptr<Net> >& nets = father->nets();
+  for (int i = 0; i < nets.size(); ++ i) {
+    std::vector<std::vector<Blob*> >& output_plugs = nets[i]->output_plugs();
+    for (int j = 0; j < output_plugs.size(); ++ j) {
+      std::replace(output_plugs[j].begin(), output_plugs[j].end(), from, to);
+    }
+  }
+}
+
+// floats by which the blocks of a memory plan are aligned, i.e. 64 bytes
+const int kArenaAlignment = 16;
+
+// A block of the arena of a memory plan, holding an output blob of a net (or
+// an input blob of the net planned), or the workspace of a net if blob is
+// null. It is alive from the step, i.e. the execution of a net without
+// subnets, which writes it, to the last one which reads it.
+struct ArenaBlock {
+  Blob* blob;
+  Net* net;
+  int size;
+  int first_step;
+  int last_step;
+  int offset;
+};
+
+// The blocks of a memory plan, the block of the data held by each blob, and
+// the step executing.
+struct MemoryPlanner {
+  std::vector<ArenaBlock> blocks;
+  std::map<const Blob*, int> block_of;
+  int step;
+
+  void AddBlock(Blob* blob, Net* net, int size) {
+    ArenaBlock block = {blob, net,
+      (size + kArenaAlignment - 1) / kArenaAlignment * kArenaAlignment,
+      step, step, 0};
+    if (blob != nullptr)
+      block_of[blob] = blocks.size();
+    blocks.push_back(block);
+  }
+};
+
+// pass the shape of from, and the block of its data if planning, to the plug to
+void PassShape(const Blob* from, Blob* to, MemoryPlanner* planner) {
+  to->reshape(from->num(), from->channels(), from->height(), from->width());
+  if (planner == nullptr)
+    return;
+  std::map<const Blob*, int>::const_iterator block =
+    planner->block_of.find(from);
+  if (block != planner->block_of.end())
+    planner->block_of[to] = block->second;
+}
+
+// Infer the shapes of the output blobs of net from those of its input blobs,
+// through its subnets if any, and pass them to its output plugs, the same way
+// as Execute passes the data. The planner, if any, records the blocks written
+// and read by each net without subnets.
+void InferShapes(Net* net, MemoryPlanner* planner) {
+  if (net->nets().empty()) {
+    net->InferShape();
+    if (planner != nullptr) {
+      for (int i = 0; i < net->input_blobs().size(); ++ i) {
+        std::map<const Blob*, int>::const_iterator block =
+          planner->block_of.find(net->input_blobs(i));
+        if (block != planner->block_of.end())
+          planner->blocks[block->second].last_step = planner->step;
+      }
+      net->SetWorkspace(nullptr, 0);
+      if (net->WorkspaceSize() > 0)
+        planner->AddBlock(nullptr, net, net->WorkspaceSize());
+      for (int i = 0; i < net->output_blobs().size(); ++ i)
+        planner->AddBlock(net->output_blobs(i), net,
+          net->output_blobs(i)->count());
+      ++ planner->step;
+    }
+  }
+  else {
+    for (int i = 0; i < net->input_blobs().size(); ++ i) {
+      for (int j = 0; j < net->input_plugs(i).size(); ++ j)
+        PassShape(net->input_blobs(i), net->input_plugs(i)[j], planner);
+    }
+    for (int i = 0; i < net->nets().size(); ++ i)
+      InferShapes(net->nets(i).get(), planner);
+  }
+  for (int i = 0; i < net->output_blobs().size(); ++ i) {
+    for (int j = 0; j < net->output_plugs(i).size(); ++ j)
+      PassShape(net->output_blobs(i), net->output_plugs(i)[j], planner);
+  }
+}
+
+bool LargerBlock(const ArenaBlock* a, const ArenaBlock* b) {
+  return a->size > b->size;
+}
+
+bool LowerBlock(const ArenaBlock* a, const ArenaBlock* b) {
+  return a->offset < b->offset;
+}
+
+}  // namespace
+
+void CommonNet::InferShape() {
+  InferShapes(this, nullptr);
+}
+
+size_t CommonNet::Plan(Net* net, size_t* total_size) {
+  MemoryPlanner planner;
+  planner.step = -1;
+  for (int i = 0; i < net->input_blobs().size(); ++ i)
+    planner.AddBlock(net->input_blobs(i), nullptr,
+      net->input_blobs(i)->count());
+  planner.step = 0;
+  InferShapes(net, &planner);
+  // the outputs are read after the execution
+  for (int i = 0; i < net->output_blobs().size(); ++ i) {
+    std::map<const Blob*, int>::const_iterator block =
+      planner.block_of.find(net->output_blobs(i));
+    if (block != planner.block_of.end())
+      planner.blocks[block->second].last_step = INT_MAX;
+  }
+
+  // place the blocks from the largest one, each at the lowest offset where it
+  // overlaps none of the blocks placed that are alive at the same time
+  std::vector<ArenaBlock*> blocks;
+  for (int i = 0; i < planner.blocks.size(); ++ i)
+    blocks.push_back(&planner.blocks[i]);
+  std::stable_sort(blocks.begin(), blocks.end(), LargerBlock);
+  std::vector<ArenaBlock*> placed;
+  size_t arena_size = 0, sum = 0;
+  for (int i = 0; i < blocks.size(); ++ i) {
+    ArenaBlock* block = blocks[i];
+    std::vector<ArenaBlock*> alive;
+    for (int j = 0; j < placed.size(); ++ j) {
+      if (placed[j]->first_step <= block->last_step &&
+          block->first_step <= placed[j]->last_step)
+        alive.push_back(placed[j]);
+    }
+    std::sort(alive.begin(), alive.end(), LowerBlock);
+    block->offset = 0;
+    for (int j = 0; j < alive.size(); ++ j) {
+      if (block->offset + block->size <= alive[j]->offset)
+        break;
+      block->offset = std::max(block->offset,
+        alive[j]->offset + alive[j]->size);
+    }
+    placed.push_back(block);
+    arena_size = std::max(arena_size, size_t(block->offset + block->size));
+    sum += block->size;
+  }
+
+  std::shared_ptr<float> arena(new float[arena_size + kArenaAlignment],
+    std::default_delete<float[]>());
+  float* const base = arena.get() + (kArenaAlignment -
+    (reinterpret_cast<uintptr_t>(arena.get()) / sizeof(float)) %
+    kArenaAlignment) % kArenaAlignment;
+  for (int i = 0; i < planner.blocks.size(); ++ i) {
+    const ArenaBlock& block = planner.blocks[i];
+    if (block.blob != nullptr) {
+      block.blob->SetStorage(std::shared_ptr<float>(arena,
+        base + block.offset), block.size);
+    }
+    else {
+      block.net->SetWorkspace(base + block.offset, block.size);
+    }
+  }
+  LOG(INFO) << "Activations: " << arena_size * sizeof(float) << " bytes in "
+    << planner.blocks.size() << " blocks of " << sum * sizeof(float)
+    << " bytes";
+  if (total_size != nullptr)
+    *total_size = sum * sizeof(float);
+  return arena_size * sizeof(float);
+}
+
+void CommonNet::Fuse(Net* net) {
+  std::vector<std::shared_ptr<Net> >& nets = net->nets();
+  std::vector<Net*> fused;
+  for (int i = 0; i < nets.size(); ++ i) {
+    Net* producer = nets[i].get();
+    if (std::find(fused.begin(), fused.end(), producer) != fused.end()) {
+      continue;
+    }
+    bool changed = false;
+
+    // a zero padding followed by a convolution: the convolution pads itself
+    PadNet* pad = dynamic_cast<PadNet*>(producer);
+    if (pad != nullptr && pad->pad() > 0) {
+      ConvNet* conv = dynamic_cast<ConvNet*>(SoleConsumer(net, pad));
+      if (conv != nullptr && conv->pad() == 0) {
+        conv->SetPad(pad->pad());
+        Replug(net, pad->input_blobs(0), conv->input_blobs(0));
+        fused.push_back(pad);
+        producer = conv;
+        changed = true;
+      }
+    }
+
+    ConvNet* conv = dynamic_cast<ConvNet*>(producer);
+    InnerProductNet* inner_product = dynamic_cast<InnerProductNet*>(producer);
+    if (conv == nullptr && inner_product == nullptr) {
+      continue;
+    }
+    for (Net* consumer = SoleConsumer(net, producer); consumer != nullptr;
+        consumer = SoleConsumer(net, producer)) {
+      if (!(conv != nullptr ? FoldInto(conv, consumer) :
+            FoldInto(inner_product, consumer))) {
+        break;
+      }
+      producer->output_plugs(0) = consumer->output_plugs(0);
+      fused.push_back(consumer);
+      changed = true;
+    }
+    if (changed) {
+      producer->Prepare();
+    }
+  }
+
+  std::vector<std::shared_ptr<Net> > remaining;
+  for (int i = 0; i < nets.size(); ++ i) {
+    if (std::find(fused.begin(), fused.end(), nets[i].get()) == fused.end()) {
+      remaining.push_back(nets[i]);
+    }
+  }
+  LOG(INFO) << "Fused " << fused.size() << " of " << nets.size() << " nets";
+  nets.swap(remaining);
+}
+
 void CommonNet::SetUp() {
   int num_subnet = *(int*)(this->hyper_param()->param("num_subnet"));
   int num_in = *(int*)(this->hyper_param()->param("num_in"));
@@ -31,10 +31,168 @@
 
 #include "conv_net.h"
 #include "math_functions.h"
+#include <xmmintrin.h>
+#include <algorithm>
 #ifdef __VIPL_LOG__
 #include <ctime>
 #endif
 
+namespace {
+
+// Filter transforms G of Winograd F(2x2, 3x3) and F(4x4, 3x3): U = G g G^T.
+const float kWinograd2G[4][3] = {
+  {1.0f, 0.0f, 0.0f},
+  {0.5f, 0.5f, 0.5f},
+  {0.5f, -0.5f, 0.5f},
+  {0.0f, 0.0f, 1.0f}
+};
+const float kWinograd4G[6][3] = {
+  {1.0f / 4, 0.0f, 0.0f},
+  {-1.0f / 6, -1.0f / 6, -1.0f / 6},
+  {-1.0f / 6, 1.0f / 6, -1.0f / 6},
+  {1.0f / 24, 1.0f / 12, 1.0f / 6},
+  {1.0f / 24, -1.0f / 12, 1.0f / 6},
+  {0.0f, 0.0f, 1.0f}
+};
+
+// The input (B^T d) and output (A^T m) transforms along one dimension, on
+// four channels or tiles at once, reading with stride s and writing with
+// stride t.
+inline void Winograd2Input(const __m128* d, int s, __m128* r, int t) {
+  r[0] = _mm_sub_ps(d[0], d[2 * s]);
+  r[t] = _mm_add_ps(d[s], d[2 * s]);
+  r[2 * t] = _mm_sub_ps(d[2 * s], d[s]);
+  r[3 * t] = _mm_sub_ps(d[s], d[3 * s]);
+}
+
+inline void Winograd4Input(const __m128* d, int s, __m128* r, int t) {
+  const __m128 two = _mm_set1_ps(2.0f);
+  const __m128 four = _mm_set1_ps(4.0f);
+  const __m128 five = _mm_set1_ps(5.0f);
+  __m128 d1_4 = _mm_mul_ps(four, d[s]);
+  __m128 d2_4 = _mm_mul_ps(four, d[2 * s]);
+  __m128 d3_plus_d4 = _mm_add_ps(d[3 * s], d[4 * s]);
+  __m128 d4_minus_d3 = _mm_sub_ps(d[4 * s], d[3 * s]);
+  __m128 d4_minus_d2 = _mm_sub_ps(d[4 * s], d[2 * s]);
+  __m128 d3_minus_d1_2 = _mm_mul_ps(two, _mm_sub_ps(d[3 * s], d[s]));
+  r[0] = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(four, d[0]),
+    _mm_mul_ps(five, d[2 * s])), d[4 * s]);
+  r[t] = _mm_sub_ps(d3_plus_d4, _mm_add_ps(d1_4, d2_4));
+  r[2 * t] = _mm_add_ps(_mm_sub_ps(d1_4, d2_4), d4_minus_d3);
+  r[3 * t] = _mm_add_ps(d4_minus_d2, d3_minus_d1_2);
+  r[4 * t] = _mm_sub_ps(d4_minus_d2, d3_minus_d1_2);
+  r[5 * t] = _mm_add_ps(_mm_sub_ps(d1_4, _mm_mul_ps(five, d[3 * s])),
+    d[5 * s]);
+}
+
+inline void Winograd2Output(const __m128* m, int s, __m128* r, int t) {
+  r[0] = _mm_add_ps(_mm_add_ps(m[0], m[s]), m[2 * s]);
+  r[t] = _mm_sub_ps(_mm_sub_ps(m[s], m[2 * s]), m[3 * s]);
+}
+
+inline void Winograd4Output(const __m128* m, int s, __m128* r, int t) {
+  const __m128 two = _mm_set1_ps(2.0f);
+  const __m128 four = _mm_set1_ps(4.0f);
+  const __m128 eight = _mm_set1_ps(8.0f);
+  __m128 m1_plus_m2 = _mm_add_ps(m[s], m[2 * s]);
+  __m128 m1_minus_m2 = _mm_sub_ps(m[s], m[2 * s]);
+  __m128 m3_plus_m4 = _mm_add_ps(m[3 * s], m[4 * s]);
+  __m128 m3_minus_m4 = _mm_sub_ps(m[3 * s], m[4 * s]);
+  r[0] = _mm_add_ps(_mm_add_ps(m[0], m1_plus_m2), m3_plus_m4);
+  r[t] = _mm_add_ps(m1_minus_m2, _mm_mul_ps(two, m3_minus_m4));
+  r[2 * t] = _mm_add_ps(m1_plus_m2, _mm_mul_ps(four, m3_plus_m4));
+  r[3 * t] = _mm_add_ps(_mm_add_ps(m1_minus_m2, _mm_mul_ps(eight, m3_minus_m4)),
+    m[5 * s]);
+}
+
+// Transforms a tile of a x a (a = m + 2) inputs into v = B^T d B, or a tile of
+// a x a products into the m x m outputs y = A^T m A.
+inline void WinogradInputTile(int m, const __m128* d, __m128* v) {
+  __m128 temp[36];
+  int a = m + 2;
+  for (int j = 0; j < a; ++j) {
+    if (m == 2)
+      Winograd2Input(d + j, a, temp + j, a);
+    else
+      Winograd4Input(d + j, a, temp + j, a);
+  }
+  for (int i = 0; i < a; ++i) {
+    if (m == 2)
+      Winograd2Input(temp + i * a, 1, v + i * a, 1);
+    else
+      Winograd4Input(temp + i * a, 1, v + i * a, 1);
+  }
+}
+
+inline void WinogradOutputTile(int m, const __m128* p, __m128* y) {
+  __m128 temp[24];
+  int a = m + 2;
+  for (int j = 0; j < a; ++j) {
+    if (m == 2)
+      Winograd2Output(p + j, a, temp + j, a);
+    else
+      Winograd4Output(p + j, a, temp + j, a);
+  }
+  for (int i = 0; i < m; ++i) {
+    if (m == 2)
+      Winograd2Output(temp + i * a, 1, y + i * m, 1);
+    else
+      Winograd4Output(temp + i * a, 1, y + i * m, 1);
+  }
+}
+
+// Transforms the 3x3 kernels of weight (dst_channels, src_channels, 3, 3) into
+// one matrix (dst_channels, src_channels) per element of the a x a tile, each
+// packed by pack_matrix.
+template <int a>
+void TransformWeight(const float* weight, int dst_channels, int src_channels,
+    const float (*G)[3], std::vector<float>* packed) {
+  int kernel_num = dst_channels * src_channels;
+  std::vector<float> transformed(a * a * kernel_num);
+  for (int k = 0; k < kernel_num; ++k) {
+    const float* g = weight + k * 9;
+    float temp[a][3];
+    for (int i = 0; i < a; ++i) {
+      for (int j = 0; j < 3; ++j) {
+        temp[i][j] = G[i][0] * g[j] + G[i][1] * g[3 + j] + G[i][2] * g[6 + j];
+      }
+    }
+    for (int i = 0; i < a; ++i) {
+      for (int j = 0; j < a; ++j) {
+        transformed[(i * a + j) * kernel_num + k] = temp[i][0] * G[j][0] +
+          temp[i][1] * G[j][1] + temp[i][2] * G[j][2];
+      }
+    }
+  }
+  int size = packed_matrix_size(dst_channels, src_channels);
+  packed->resize(a * a * size);
+  for (int e = 0; e < a * a; ++e) {
+    pack_matrix(&transformed[e * kernel_num], dst_channels, src_channels,
+      &(*packed)[e * size]);
+  }
+}
+
+// Copies the kernel_h x kernel_w window of a channel whose top left corner is
+// at (y, x), reading the pixels outside the channel as zero.
+void UnrollPaddedWindow(const float* src, int src_h, int src_w, int y, int x,
+    int kernel_h, int kernel_w, float* dst) {
+  int left = std::max(0, -x);
+  int right = std::max(left, std::min(kernel_w, src_w - x));
+  for (int i = 0; i < kernel_h; ++i, dst += kernel_w) {
+    int sy = y + i;
+    if (sy < 0 || sy >= src_h) {
+      memset(dst, 0, sizeof(float) * kernel_w);
+      continue;
+    }
+    memset(dst, 0, sizeof(float) * left);
+    memcpy(dst + left, src + sy * src_w + x + left,
+      sizeof(float) * (right - left));
+    memset(dst + right, 0, sizeof(float) * (kernel_w - right));
+  }
+}
+
+}  // namespace
+
 void ConvNet::SetUp() {
   stride_h_ = stride_w_ =
       *(int*)(this->hyper_param()->param("stride"));
@@ -47,6 +205,215 @@ void ConvNet::SetUp() {
   this->params().resize(1);
 }
 
+void ConvNet::Prepare() {
+  const Blob* const weight = this->params(0);
+  int kernel_size = weight->channels() * weight->height() * weight->width();
+  packed_weight_.resize(packed_matrix_size(weight->num(), kernel_size));
+  pack_matrix(weight->data().get(), weight->num(), kernel_size,
+    &packed_weight_[0]);
+
+  winograd2_weight_.clear();
+  winograd4_weight_.clear();
+  if (weight->height() != 3 || weight->width() != 3 || stride_h_ != 1 ||
+      stride_w_ != 1)
+    return;
+  TransformWeight<4>(weight->data().get(), weight->num(), weight->channels(),
+    kWinograd2G, &winograd2_weight_);
+  TransformWeight<6>(weight->data().get(), weight->num(), weight->channels(),
+    kWinograd4G, &winograd4_weight_);
+}
+
+void ConvNet::SetClamp(float lower, float upper) {
+  lower_ = lower;
+  upper_ = upper;
+}
+
+void ConvNet::InferShape() {
+  const Blob* const input = this->input_blobs(0);
+  const Blob* const weight = this->params(0);
+  int dst_h = (input->height() + 2 * pad_ - weight->height()) / stride_h_ + 1;
+  int dst_w = (input->width() + 2 * pad_ - weight->width()) / stride_w_ + 1;
+  this->output_blobs(0)->reshape(input->num(), weight->num(), dst_h, dst_w);
+}
+
+int ConvNet::TileHeight(int dst_h, int dst_w) {
+  const Blob* const weight = this->params(0);
+  int kernel_size = weight->channels() * weight->height() * weight->width();
+  return std::max(1, std::min(dst_h, kIm2colTileSize / (dst_w * kernel_size)));
+}
+
+int ConvNet::WorkspaceSize() {
+  const Blob* const input = this->input_blobs(0);
+  const Blob* const weight = this->params(0);
+  int src_channels = weight->channels();
+  int dst_channels = weight->num();
+  int dst_h = (input->height() + 2 * pad_ - weight->height()) / stride_h_ + 1;
+  int dst_w = (input->width() + 2 * pad_ - weight->width()) / stride_w_ + 1;
+  Algorithm algorithm = SelectAlgorithm(dst_h, dst_w);
+  if (algorithm == WINOGRAD_2X2 || algorithm == WINOGRAD_4X4) {
+    // transformed input, (tiles, src_channels) per element of the tile, and
+    // products, (dst_channels, tiles) per element of the tile
+    int m = algorithm == WINOGRAD_2X2 ? 2 : 4;
+    int tiles = std::min(input->num(), WinogradGroup(dst_h, dst_w, m)) *
+      ((dst_h + m - 1) / m) * ((dst_w + m - 1) / m);
+    return (m + 2) * (m + 2) * tiles * (src_channels + dst_channels) +
+      packed_product_workspace_size(tiles);
+  }
+  int tile_size = TileHeight(dst_h, dst_w) * dst_w;
+  return tile_size * src_channels * weight->height() * weight->width() +
+    packed_product_workspace_size(tile_size);
+}
+
+int ConvNet::WinogradGroup(int dst_h, int dst_w, int m) {
+  int tiles = ((dst_h + m - 1) / m) * ((dst_w + m - 1) / m);
+  return std::max(1, (kWinogradTiles + tiles - 1) / tiles);
+}
+
+ConvNet::Algorithm ConvNet::SelectAlgorithm(int dst_h, int dst_w) {
+  if (winograd4_weight_.empty())
+    return IM2COL;
+  if (algorithm_ != AUTO)
+    return algorithm_;
+  const Blob* const weight = this->params(0);
+  double src_channels = weight->channels();
+  double dst_channels = weight->num();
+  // multiplications of the matrix products, plus the transforms weighted as
+  // about as costly per element as a multiplication by kTransformCost channels
+  const double kTransformCost = 12;
+  double im2col_cost = 9.0 * dst_h * dst_w * src_channels * dst_channels;
+  Algorithm best = IM2COL;
+  double best_cost = im2col_cost;
+  for (int m = 2; m <= 4; m += 2) {
+    double tiles = ((dst_h + m - 1) / m) * ((dst_w + m - 1) / m);
+    double a2 = (m + 2) * (m + 2);
+    double cost = tiles * a2 * (src_channels * dst_channels +
+      kTransformCost * (src_channels + dst_channels));
+    if (cost < best_cost) {
+      best = m == 2 ? WINOGRAD_2X2 : WINOGRAD_4X4;
+      best_cost = cost;
+    }
+  }
+  return best;
+}
+
+void ConvNet::WinogradConv(const float* src_data, int num, int src_h,
+    int src_w, int m, float* dst_data, float* workspace) {
+  const Blob* const weight = this->params(0);
+  const int src_channels = weight->channels();
+  const int dst_channels = weight->num();
+  const int dst_h = src_h + 2 * pad_ - 2;
+  const int dst_w = src_w + 2 * pad_ - 2;
+  const int a = m + 2;
+  const int a2 = a * a;
+  const int tiles_h = (dst_h + m - 1) / m;
+  const int tiles_w = (dst_w + m - 1) / m;
+  // the tiles of the images one after the other
+  const int image_tiles = tiles_h * tiles_w;
+  const int tiles = num * image_tiles;
+  const int src_size = src_h * src_w;
+  const int dst_size = dst_h * dst_w;
+  const float* packed_weight = m == 2 ? &winograd2_weight_[0] :
+    &winograd4_weight_[0];
+  const int weight_size = packed_matrix_size(dst_channels, src_channels);
+
+  // transformed input, (tiles, src_channels) per element of the tile, and
+  // products, (dst_channels, tiles) per element of the tile
+  float* const input_head = workspace;
+  float* const product_head = input_head + a2 * tiles * src_channels;
+  float* const gemm_workspace = product_head + a2 * dst_channels * tiles;
+
+  __m128 d[36], v[36];
+  float lanes[36][4];
+  for (int t = 0; t < tiles; ++t) {
+    // the top left corner of the tile in its image, whose padding and
+    // whatever the last tiles go past are read as zero
+    int image = t / image_tiles;
+    int y0 = t % image_tiles / tiles_w * m - pad_;
+    int x0 = t % image_tiles % tiles_w * m - pad_;
+    bool inside = y0 >= 0 && x0 >= 0 && y0 + a <= src_h && x0 + a <= src_w;
+    for (int c = 0; c < src_channels; c += 4) {
+      int lane_num = std::min(4, src_channels - c);
+      const float* src = src_data + (image * src_channels + c) * src_size;
+      if (inside && lane_num == 4) {
+        for (int i = 0; i < a; ++i) {
+          for (int j = 0; j < a; ++j) {
+            const float* p = src + (y0 + i) * src_w + x0 + j;
+            d[i * a + j] = _mm_setr_ps(p[0], p[src_size], p[2 * src_size],
+              p[3 * src_size]);
+          }
+        }
+      } else {
+        for (int i = 0; i < a; ++i) {
+          for (int j = 0; j < a; ++j) {
+            int sy = y0 + i;
+            int sx = x0 + j;
+            bool valid = sy >= 0 && sy < src_h && sx >= 0 && sx < src_w;
+            for (int l = 0; l < 4; ++l) {
+              lanes[i * a + j][l] = valid && l < lane_num ?
+                src[l * src_size + sy * src_w + sx] : 0;
+            }
+            d[i * a + j] = _mm_loadu_ps(lanes[i * a + j]);
+          }
+        }
+      }
+      WinogradInputTile(m, d, v);
+      float* dst = input_head + t * src_channels + c;
+      for (int e = 0; e < a2; ++e, dst += tiles * src_channels) {
+        if (lane_num == 4) {
+          _mm_storeu_ps(dst, v[e]);
+        } else {
+          _mm_storeu_ps(lanes[e], v[e]);
+          memcpy(dst, lanes[e], sizeof(float) * lane_num);
+        }
+      }
+    } // for c
+  } // for t
+
+  for (int e = 0; e < a2; ++e) {
+    matrix_procuct_packed(input_head + e * tiles * src_channels,
+      packed_weight + e * weight_size, product_head + e * dst_channels * tiles,
+      tiles, dst_channels, src_channels, tiles, gemm_workspace);
+  }
+
+  __m128 p[36], y[16];
+  const __m128 lower = _mm_set1_ps(lower_);
+  const __m128 upper = _mm_set1_ps(upper_);
+  for (int k = 0; k < dst_channels; ++k) {
+    const __m128 bias = _mm_set1_ps(bias_.empty() ? 0 : bias_[k]);
+    for (int t = 0; t < tiles; t += 4) {
+      int lane_num = std::min(4, tiles - t);
+      const float* src = product_head + k * tiles + t;
+      for (int e = 0; e < a2; ++e, src += dst_channels * tiles) {
+        if (lane_num == 4) {
+          p[e] = _mm_loadu_ps(src);
+        } else {
+          for (int l = 0; l < 4; ++l)
+            lanes[e][l] = l < lane_num ? src[l] : 0;
+          p[e] = _mm_loadu_ps(lanes[e]);
+        }
+      }
+      WinogradOutputTile(m, p, y);
+      for (int e = 0; e < m * m; ++e) {
+        y[e] = _mm_min_ps(_mm_max_ps(_mm_add_ps(y[e], bias), lower), upper);
+        _mm_storeu_ps(lanes[e], y[e]);
+      }
+      for (int l = 0; l < lane_num; ++l) {
+        int image = (t + l) / image_tiles;
+        int y0 = (t + l) % image_tiles / tiles_w * m;
+        int x0 = (t + l) % image_tiles % tiles_w * m;
+        float* dst = dst_data + (image * dst_channels + k) * dst_size;
+        int h = std::min(m, dst_h - y0);
+        int w = std::min(m, dst_w - x0);
+        for (int i = 0; i < h; ++i) {
+          for (int j = 0; j < w; ++j) {
+            dst[(y0 + i) * dst_w + x0 + j] = lanes[i * m + j][l];
+          }
+        }
+      }
+    } // for t
+  } // for k
+}
+
 void ConvNet::Execute() {
 #ifdef __VIPL_LOG__
   double t_start, t_end, scan_time, math_time;
@@ -71,58 +438,87 @@ void ConvNet::Execute() {
   LOG(DEBUG) << "input blob: (" <<src_num << "," << src_channels << "," << src_h
     << "," << src_w << ")";
 
-  int dst_h = (src_h - kernel_h) / stride_h_ + 1;
-  int dst_w = (src_w - kernel_w) / stride_w_ + 1;
-  int end_h = src_h - kernel_h + 1;
-  int end_w = src_w - kernel_w + 1;
+  // the input is padded by pad_ zeros on each side
+  int dst_h = (src_h + 2 * pad_ - kernel_h) / stride_h_ + 1;
+  int dst_w = (src_w + 2 * pad_ - kernel_w) / stride_w_ + 1;
+  int end_w = src_w + 2 * pad_ - kernel_w + 1;
   int dst_size = dst_h * dst_w;
   int kernel_size = src_channels * kernel_h * kernel_w;
 
   const int src_num_offset = src_channels * src_h * src_w;
-  float* const dst_head =
-      new float[src_num * dst_size * dst_channels];
-  float* const mat_head =
-      new float[dst_size * kernel_size];
+  const Algorithm algorithm = SelectAlgorithm(dst_h, dst_w);
+  // the output rows are unrolled and multiplied by tiles of about
+  // kIm2colTileSize floats, which stay in L2
+  const int tile_h = TileHeight(dst_h, dst_w);
+  const int tile_size = tile_h * dst_w;
+  float* const mat_head = Workspace(WorkspaceSize());
+  float* const gemm_workspace = mat_head + tile_size * kernel_size;
+  // the bias and the clamping taken over from the following nets
+  const ProductEpilogue epilogue = {bias_.empty() ? nullptr : &bias_[0],
+    lower_, upper_};
+  const bool has_epilogue = !bias_.empty() || clamped();
 
+  output->SetData(src_num, dst_channels, dst_h, dst_w);
   const float* src_data = input->data().get();
-  float* dst_data = dst_head;
+  float* dst_data = output->data().get();
   int didx = 0;
 #ifdef __VIPL_LOG__
   scan_time = math_time = 0;
 #endif
+  if (algorithm == WINOGRAD_2X2 || algorithm == WINOGRAD_4X4) {
+    // the images are convolved by groups, whose tiles share the products
+    int m = algorithm == WINOGRAD_2X2 ? 2 : 4;
+    int group = WinogradGroup(dst_h, dst_w, m);
+    for (int sn = 0; sn < src_num; sn += group) {
+      WinogradConv(src_data + sn * src_num_offset,
+        std::min(group, src_num - sn), src_h, src_w, m,
+        dst_data + sn * dst_channels * dst_size, mat_head);
+    }
+    CheckOutput();
+    return;
+  }
   for (int sn = 0; sn < src_num; ++sn) {
+    for (int dh = 0; dh < dst_h; dh += tile_h) {
 #ifdef __VIPL_LOG__
-    t_start = clock();
+      t_start = clock();
 #endif
-    float* mat_data = mat_head;
-    for (int sh = 0; sh < end_h; sh += stride_h_) {
-      for (int sw = 0; sw < end_w; sw += stride_w_) {
-        for (int sc = 0; sc < src_channels; ++sc) {
-          int src_off = (sc * src_h + sh) * src_w + sw;
-          for (int hidx = 0; hidx < kernel_h; ++hidx) {
-            memcpy(mat_data, src_data + src_off,
-                    sizeof(float) * kernel_w);
-            mat_data += kernel_w;
-            src_off += src_w;
-          }
-        } // for sc
-      } // for sw
-    } // for sh
-    src_data += src_num_offset;
+      int rows = std::min(tile_h, dst_h - dh);
+      float* mat_data = mat_head;
+      for (int sh = dh * stride_h_; sh < (dh + rows) * stride_h_;
+          sh += stride_h_) {
+        for (int sw = 0; sw < end_w; sw += stride_w_) {
+          for (int sc = 0; sc < src_channels; ++sc) {
+            if (pad_ > 0) {
+              UnrollPaddedWindow(src_data + sc * src_h * src_w, src_h, src_w,
+                sh - pad_, sw - pad_, kernel_h, kernel_w, mat_data);
+              mat_data += kernel_h * kernel_w;
+              continue;
+            }
+            int src_off = (sc * src_h + sh) * src_w + sw;
+            for (int hidx = 0; hidx < kernel_h; ++hidx) {
+              memcpy(mat_data, src_data + src_off,
+                      sizeof(float) * kernel_w);
+              mat_data += kernel_w;
+              src_off += src_w;
+            }
+          } // for sc
+        } // for sw
+      } // for sh
 #ifdef __VIPL_LOG__
-    t_end = clock();
-    scan_time += t_end - t_start;
+      t_end = clock();
+      scan_time += t_end - t_start;
 
-    t_start = clock();
+      t_start = clock();
 #endif
-
-    const float* weight_head = weight->data().get();
-    matrix_procuct(mat_head, weight_head, dst_data, dst_size, dst_channels,
-      kernel_size, true, false);
+      matrix_procuct_packed(mat_head, &packed_weight_[0],
+        dst_data + dh * dst_w, rows * dst_w, dst_channels, kernel_size,
+        dst_size, gemm_workspace, has_epilogue ? &epilogue : nullptr);
 #ifdef __VIPL_LOG__
-    t_end = clock();
-    math_time += t_end - t_start;
+      t_end = clock();
+      math_time += t_end - t_start;
 #endif
+    } // for dh
+    src_data += src_num_offset;
     dst_data += dst_channels * dst_size;
   } // for sn
 
@@ -130,9 +526,6 @@ void ConvNet::Execute() {
   LOG(INFO) << "scan time: " << scan_time / CLOCKS_PER_SEC * 1000 << "ms";
   LOG(INFO) << "math time: " << math_time / CLOCKS_PER_SEC * 1000 << "ms";
 #endif
-  output->CopyData(src_num, dst_channels, dst_h, dst_w, dst_head);
-  delete[] mat_head;
-  delete[] dst_head;
 
   LOG(DEBUG) << "output blob: (" << output->num() << "," << output->channels()
     << "," << output->height() << "," << output->width() << ")";
@@ -84,7 +84,8 @@ void EltwiseNet::Execute() {
     LOG(DEBUG) << "bias blob: (" << bias->num() << "," << bias->channels() 
       << "," << bias->height() << "," << bias->width() << ")";
     
-    float* const dst_head = new float[num*channels*height*width];
+    output->SetData(num, channels, height, width);
+    float* const dst_head = output->data().get();
 
     int bn = (bias->num() != 1);
     int bc = (bias->channels() != 1);
@@ -100,9 +101,6 @@ void EltwiseNet::Execute() {
         }
       }
     }
-
-    output->CopyData(num, channels, height, width, dst_head);    
-	delete[] dst_head;
   }
   else if (op_ == "SCALE") {
     const Blob* const input = this->input_blobs(0);
@@ -112,12 +110,11 @@ void EltwiseNet::Execute() {
 		<< input->width() << ")";
     int count = input->count();
     Blob* const output = this->output_blobs(0);
-    float* const dst_head = new float[count];
+    output->SetData(input->num(), input->channels(), input->height(),
+                    input->width());
+    float* const dst_head = output->data().get();
     for (int i = 0; i < count; ++ i)
       dst_head[i] = (*input)[i] * scale_;
-    output->CopyData(input->num(), input->channels(), input->height(), 
-                    input->width(), dst_head);
-	delete[] dst_head;
   }
   else if (op_ == "CLOSE") {
     const Blob* const input = this->input_blobs(0);
@@ -127,15 +124,14 @@ void EltwiseNet::Execute() {
 		<< input->width() << ")";
     int count = input->count();
     Blob* const output = this->output_blobs(0);
-    float* const dst_head = new float[count];
+    output->SetData(input->num(), input->channels(), input->height(),
+                    input->width());
+    float* const dst_head = output->data().get();
     for (int i = 0; i < count; ++ i) {
       dst_head[i] = (*input)[i];
       dst_head[i] = std::min(dst_head[i], upper_);
       dst_head[i] = std::max(dst_head[i], lower_);
     }
-    output->CopyData(input->num(), input->channels(), input->height(), 
-                    input->width(), dst_head);
-	delete[] dst_head;
   }
   // SUM
   // PROD
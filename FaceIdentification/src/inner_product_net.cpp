@@ -32,6 +32,8 @@
 #include "inner_product_net.h"
 #include "math_functions.h"
 
+#include <algorithm>
+
 void InnerProductNet::SetUp() {
   // check input and output blob size
   this->input_blobs().resize(1);
@@ -41,6 +43,16 @@ void InnerProductNet::SetUp() {
   this->params().resize(1);
 }
 
+void InnerProductNet::InferShape() {
+  this->output_blobs(0)->reshape(this->input_blobs(0)->num(),
+    this->params(0)->num(), 1, 1);
+}
+
+int InnerProductNet::WorkspaceSize() {
+  return product_workspace_size(this->params(0)->num(),
+    this->input_blobs(0)->num());
+}
+
 void InnerProductNet::Execute() {
   CheckInput();
   const Blob* const input = this->input_blobs(0); // src_num * vec_len
@@ -57,20 +69,21 @@ void InnerProductNet::Execute() {
     << "," << src_w << ")";
 
   const int vec_len = src_channels * src_h * src_w;
-  float* const dst_head = new float[src_num * dst_channels];
-  const float* src_data = input->data().get();
-  for (int sn = 0, didx = 0; sn < src_num; ++sn) {
-    const float* weight_data = weight->data().get();
-    for (int dc = 0; dc < dst_channels; ++dc) {
-      dst_head[didx++] = simd_dot(src_data, weight_data, vec_len);
-      weight_data += vec_len;
-    } // for dc
-    
-    src_data += vec_len;
-  } // for sn
+  output->SetData(src_num, dst_channels, 1, 1);
+  float* const dst_head = output->data().get();
+  // dst(src_num, dst_channels) = src(src_num, vec_len) * weight^T
+  matrix_procuct(weight->data().get(), input->data().get(), dst_head,
+    dst_channels, src_num, vec_len, true, false,
+    Workspace(WorkspaceSize()));
+  if (!bias_.empty() || clamped()) {
+    for (int sn = 0, didx = 0; sn < src_num; ++sn) {
+      for (int dc = 0; dc < dst_channels; ++dc, ++didx) {
+        float value = dst_head[didx] + (bias_.empty() ? 0 : bias_[dc]);
+        dst_head[didx] = std::min(std::max(value, lower_), upper_);
+      }
+    }
+  }
   
-  output->CopyData(src_num, dst_channels, 1, 1, dst_head);
-  delete[] dst_head;
   LOG(DEBUG) << "output blob: (" << output->num() << "," << output->channels() 
     << "," << output->height() << "," << output->width() << ")";
   CheckOutput();
@@ -32,6 +32,7 @@
 #include "math_functions.h"
 #include <xmmintrin.h>
 #include <cstdint>
+#include <algorithm>
 
 #ifdef _WIN32
 #include <intrin.h>
@@ -39,30 +40,382 @@
 #include <x86intrin.h>
 #endif
 
-float simd_dot(const float* x, const float* y, const long& len) {
-  float inner_prod = 0.0f;
-  __m128 X, Y; // 128-bit values
-  __m128 acc = _mm_setzero_ps(); // set to (0, 0, 0, 0)
+// The AVX2 functions are compiled for AVX2 and FMA whatever the flags of the
+// build, and only called if the CPU supports them.
+#if defined(__GNUC__)
+#define AVX2_FMA_TARGET __attribute__((target("avx2,fma")))
+#else
+#define AVX2_FMA_TARGET
+#endif
+
+namespace {
+
+// Blocking of matrix_procuct, C(m, n) = B(m, k) * A(n, k)^T: a KC x NR panel of
+// A stays in L1 and a MC x KC block of B in L2 while a KC x NC block of A is
+// multiplied. MC and NC are multiples of the register blocks of all kernels.
+const int kGemmKc = 256;
+const int kGemmMc = 96;
+const int kGemmNc = 2048;
+
+bool CpuSupportsAvx2Fma() {
+#if defined(__GNUC__)
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#elif defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7)
+    return false;
+  // FMA, OSXSAVE and AVX, with the YMM registers saved by the OS
+  const int features = (1 << 12) | (1 << 27) | (1 << 28);
+  __cpuid(info, 1);
+  if ((info[2] & features) != features || (_xgetbv(0) & 6) != 6)
+    return false;
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  return false;
+#endif
+}
+
+const bool g_use_avx2 = CpuSupportsAvx2Fma();
+
+inline float HorizontalSum(__m128 x) {
   float temp[4];
+  _mm_storeu_ps(&temp[0], x);
+  return temp[0] + temp[1] + temp[2] + temp[3];
+}
 
+float DotSse(const float* x, const float* y, long len) {
+  __m128 acc = _mm_setzero_ps();
   long i;
-  for (i = 0; i + 4 < len; i += 4) {
-      X = _mm_loadu_ps(x + i); // load chunk of 4 floats
-      Y = _mm_loadu_ps(y + i);
-      acc = _mm_add_ps(acc, _mm_mul_ps(X, Y));
+  for (i = 0; i + 4 <= len; i += 4) {
+    acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(y + i)));
+  }
+  float inner_prod = HorizontalSum(acc);
+  for (; i < len; ++i) {
+    inner_prod += x[i] * y[i];
   }
-  _mm_storeu_ps(&temp[0], acc); // store acc into an array
-  inner_prod = temp[0] + temp[1] + temp[2] + temp[3];
+  return inner_prod;
+}
 
-  // add the remaining values
+AVX2_FMA_TARGET float DotAvx2(const float* x, const float* y, long len) {
+  __m256 acc0 = _mm256_setzero_ps();
+  __m256 acc1 = _mm256_setzero_ps();
+  long i;
+  for (i = 0; i + 16 <= len; i += 16) {
+    acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i), acc0);
+    acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i + 8),
+      _mm256_loadu_ps(y + i + 8), acc1);
+  }
+  for (; i + 8 <= len; i += 8) {
+    acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i), acc0);
+  }
+  acc0 = _mm256_add_ps(acc0, acc1);
+  float inner_prod = HorizontalSum(_mm_add_ps(_mm256_castps256_ps128(acc0),
+    _mm256_extractf128_ps(acc0, 1)));
   for (; i < len; ++i) {
-      inner_prod += x[i] * y[i];
+    inner_prod += x[i] * y[i];
   }
   return inner_prod;
 }
 
+// Inner products of x with the four consecutive rows of y, sharing the loads
+// of x.
+void Dot4Sse(const float* x, const float* y, long len, float* out) {
+  const float* y0 = y;
+  const float* y1 = y0 + len;
+  const float* y2 = y1 + len;
+  const float* y3 = y2 + len;
+  __m128 acc0 = _mm_setzero_ps();
+  __m128 acc1 = _mm_setzero_ps();
+  __m128 acc2 = _mm_setzero_ps();
+  __m128 acc3 = _mm_setzero_ps();
+  long i;
+  for (i = 0; i + 4 <= len; i += 4) {
+    __m128 X = _mm_loadu_ps(x + i);
+    acc0 = _mm_add_ps(acc0, _mm_mul_ps(X, _mm_loadu_ps(y0 + i)));
+    acc1 = _mm_add_ps(acc1, _mm_mul_ps(X, _mm_loadu_ps(y1 + i)));
+    acc2 = _mm_add_ps(acc2, _mm_mul_ps(X, _mm_loadu_ps(y2 + i)));
+    acc3 = _mm_add_ps(acc3, _mm_mul_ps(X, _mm_loadu_ps(y3 + i)));
+  }
+  out[0] = HorizontalSum(acc0);
+  out[1] = HorizontalSum(acc1);
+  out[2] = HorizontalSum(acc2);
+  out[3] = HorizontalSum(acc3);
+  for (; i < len; ++i) {
+    out[0] += x[i] * y0[i];
+    out[1] += x[i] * y1[i];
+    out[2] += x[i] * y2[i];
+    out[3] += x[i] * y3[i];
+  }
+}
+
+AVX2_FMA_TARGET void Dot4Avx2(const float* x, const float* y, long len,
+    float* out) {
+  const float* y0 = y;
+  const float* y1 = y0 + len;
+  const float* y2 = y1 + len;
+  const float* y3 = y2 + len;
+  __m256 acc0 = _mm256_setzero_ps();
+  __m256 acc1 = _mm256_setzero_ps();
+  __m256 acc2 = _mm256_setzero_ps();
+  __m256 acc3 = _mm256_setzero_ps();
+  long i;
+  for (i = 0; i + 8 <= len; i += 8) {
+    __m256 X = _mm256_loadu_ps(x + i);
+    acc0 = _mm256_fmadd_ps(X, _mm256_loadu_ps(y0 + i), acc0);
+    acc1 = _mm256_fmadd_ps(X, _mm256_loadu_ps(y1 + i), acc1);
+    acc2 = _mm256_fmadd_ps(X, _mm256_loadu_ps(y2 + i), acc2);
+    acc3 = _mm256_fmadd_ps(X, _mm256_loadu_ps(y3 + i), acc3);
+  }
+  __m256* acc[4] = {&acc0, &acc1, &acc2, &acc3};
+  for (int r = 0; r < 4; ++r) {
+    out[r] = HorizontalSum(_mm_add_ps(_mm256_castps256_ps128(*acc[r]),
+      _mm256_extractf128_ps(*acc[r], 1)));
+  }
+  for (; i < len; ++i) {
+    out[0] += x[i] * y0[i];
+    out[1] += x[i] * y1[i];
+    out[2] += x[i] * y2[i];
+    out[3] += x[i] * y3[i];
+  }
+}
+
+// A micro-kernel computes a MR x NR tile of C from a panel of B (MR rows) and a
+// panel of A (NR rows), both packed along k:
+// c[r * ldc + j] (+)= sum_p pb[p * MR + r] * pa[p * NR + j].
+typedef void (*MicroKernel)(int kc, const float* pb, const float* pa,
+  float* c, int ldc, bool accumulate);
+
+struct GemmKernel {
+  int mr;
+  int nr;
+  MicroKernel run;
+};
+
+// 4 x 8 tile in 8 SSE registers.
+void KernelSse4x8(int kc, const float* pb, const float* pa, float* c, int ldc,
+    bool accumulate) {
+  __m128 c00 = _mm_setzero_ps(), c01 = _mm_setzero_ps();
+  __m128 c10 = _mm_setzero_ps(), c11 = _mm_setzero_ps();
+  __m128 c20 = _mm_setzero_ps(), c21 = _mm_setzero_ps();
+  __m128 c30 = _mm_setzero_ps(), c31 = _mm_setzero_ps();
+  for (int p = 0; p < kc; ++p, pb += 4, pa += 8) {
+    __m128 a0 = _mm_load_ps(pa);
+    __m128 a1 = _mm_load_ps(pa + 4);
+    __m128 b = _mm_set1_ps(pb[0]);
+    c00 = _mm_add_ps(c00, _mm_mul_ps(b, a0));
+    c01 = _mm_add_ps(c01, _mm_mul_ps(b, a1));
+    b = _mm_set1_ps(pb[1]);
+    c10 = _mm_add_ps(c10, _mm_mul_ps(b, a0));
+    c11 = _mm_add_ps(c11, _mm_mul_ps(b, a1));
+    b = _mm_set1_ps(pb[2]);
+    c20 = _mm_add_ps(c20, _mm_mul_ps(b, a0));
+    c21 = _mm_add_ps(c21, _mm_mul_ps(b, a1));
+    b = _mm_set1_ps(pb[3]);
+    c30 = _mm_add_ps(c30, _mm_mul_ps(b, a0));
+    c31 = _mm_add_ps(c31, _mm_mul_ps(b, a1));
+  }
+  __m128 tile[8] = {c00, c01, c10, c11, c20, c21, c30, c31};
+  for (int r = 0; r < 4; ++r, c += ldc) {
+    if (accumulate) {
+      tile[r * 2] = _mm_add_ps(tile[r * 2], _mm_loadu_ps(c));
+      tile[r * 2 + 1] = _mm_add_ps(tile[r * 2 + 1], _mm_loadu_ps(c + 4));
+    }
+    _mm_storeu_ps(c, tile[r * 2]);
+    _mm_storeu_ps(c + 4, tile[r * 2 + 1]);
+  }
+}
+
+// 6 x 16 tile in 12 AVX registers, with 2 for the panel of A and 1 for the
+// broadcast element of B.
+AVX2_FMA_TARGET void KernelAvx6x16(int kc, const float* pb, const float* pa,
+    float* c, int ldc, bool accumulate) {
+  __m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+  __m256 c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+  __m256 c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+  __m256 c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+  __m256 c40 = _mm256_setzero_ps(), c41 = _mm256_setzero_ps();
+  __m256 c50 = _mm256_setzero_ps(), c51 = _mm256_setzero_ps();
+  for (int p = 0; p < kc; ++p, pb += 6, pa += 16) {
+    __m256 a0 = _mm256_load_ps(pa);
+    __m256 a1 = _mm256_load_ps(pa + 8);
+    __m256 b = _mm256_broadcast_ss(pb);
+    c00 = _mm256_fmadd_ps(b, a0, c00);
+    c01 = _mm256_fmadd_ps(b, a1, c01);
+    b = _mm256_broadcast_ss(pb + 1);
+    c10 = _mm256_fmadd_ps(b, a0, c10);
+    c11 = _mm256_fmadd_ps(b, a1, c11);
+    b = _mm256_broadcast_ss(pb + 2);
+    c20 = _mm256_fmadd_ps(b, a0, c20);
+    c21 = _mm256_fmadd_ps(b, a1, c21);
+    b = _mm256_broadcast_ss(pb + 3);
+    c30 = _mm256_fmadd_ps(b, a0, c30);
+    c31 = _mm256_fmadd_ps(b, a1, c31);
+    b = _mm256_broadcast_ss(pb + 4);
+    c40 = _mm256_fmadd_ps(b, a0, c40);
+    c41 = _mm256_fmadd_ps(b, a1, c41);
+    b = _mm256_broadcast_ss(pb + 5);
+    c50 = _mm256_fmadd_ps(b, a0, c50);
+    c51 = _mm256_fmadd_ps(b, a1, c51);
+  }
+  __m256 tile[12] = {c00, c01, c10, c11, c20, c21, c30, c31, c40, c41,
+    c50, c51};
+  for (int r = 0; r < 6; ++r, c += ldc) {
+    if (accumulate) {
+      tile[r * 2] = _mm256_add_ps(tile[r * 2], _mm256_loadu_ps(c));
+      tile[r * 2 + 1] = _mm256_add_ps(tile[r * 2 + 1], _mm256_loadu_ps(c + 8));
+    }
+    _mm256_storeu_ps(c, tile[r * 2]);
+    _mm256_storeu_ps(c + 8, tile[r * 2 + 1]);
+  }
+}
+
+const GemmKernel g_sse_kernel = {4, 8, KernelSse4x8};
+const GemmKernel g_avx_kernel = {6, 16, KernelAvx6x16};
+
+// Packs kc columns of the first rows of a row-major matrix into panels of
+// height rows, interleaved along the columns: panel[p * height + r] =
+// mat[r * ld + p]. The rows missing from the last panel are set to zero.
+void PackPanels(const float* mat, int ld, int rows, int kc, int height,
+    float* packed) {
+  for (int i = 0; i < rows; i += height) {
+    int h = std::min(height, rows - i);
+    for (int r = 0; r < h; ++r) {
+      const float* src = mat + (i + r) * ld;
+      for (int p = 0; p < kc; ++p) {
+        packed[p * height + r] = src[p];
+      }
+    }
+    for (int r = h; r < height; ++r) {
+      for (int p = 0; p < kc; ++p) {
+        packed[p * height + r] = 0;
+      }
+    }
+    packed += kc * height;
+  }
+}
+
+// Applies the epilogue to the h x w tile of C whose first row is row.
+void ApplyEpilogue(const ProductEpilogue& epilogue, int row, float* c, int h,
+    int w, int ldc) {
+  __m128 lower = _mm_set1_ps(epilogue.lower);
+  __m128 upper = _mm_set1_ps(epilogue.upper);
+  for (int r = 0; r < h; ++r, c += ldc) {
+    float bias = epilogue.bias != nullptr ? epilogue.bias[row + r] : 0;
+    __m128 bias4 = _mm_set1_ps(bias);
+    int j = 0;
+    for (; j + 4 <= w; j += 4) {
+      __m128 x = _mm_add_ps(_mm_loadu_ps(c + j), bias4);
+      _mm_storeu_ps(c + j, _mm_min_ps(_mm_max_ps(x, lower), upper));
+    }
+    for (; j < w; ++j)
+      c[j] = std::min(std::max(c[j] + bias, epilogue.lower), epilogue.upper);
+  }
+}
+
+// The floats of the workspace of PackedProduct for n rows of A: the packed
+// blocks of A and B, the partial tile and the alignment to 64 bytes.
+int WorkspaceSize(const GemmKernel& kernel, const int n) {
+  int nc = (std::min(n, kGemmNc) + kernel.nr - 1) / kernel.nr * kernel.nr;
+  return (nc + kGemmMc + kernel.mr) * kGemmKc + kernel.mr * kernel.nr + 16;
+}
+
+// C(m, n) = B(m, k) * A(n, k)^T by blocks of A and B packed into panels for the
+// micro-kernel, with rows of C ldc apart. If packed_B is given, B is already
+// packed into panels over the whole k by pack_matrix. The workspace of
+// WorkspaceSize(kernel, n) floats is allocated if not given. The epilogue, if
+// any, is applied to each tile once its last block of k is added.
+void PackedProduct(const GemmKernel& kernel, const float* A, const float* B,
+    const float* packed_B, float* C, const int n, const int m, const int k,
+    const int ldc, float* workspace, const ProductEpilogue* epilogue) {
+  const int mr = kernel.mr;
+  const int nr = kernel.nr;
+  float* const buffer = workspace != nullptr ? workspace :
+    new float[WorkspaceSize(kernel, n)];
+  float* const pack_a = buffer + (16 - (reinterpret_cast<uintptr_t>(buffer)
+    / sizeof(float)) % 16) % 16;
+  float* const pack_b = pack_a +
+    (std::min(n, kGemmNc) + nr - 1) / nr * nr * kGemmKc;
+  float* const tile = pack_b + (kGemmMc + mr) * kGemmKc;
+
+  for (int jc = 0; jc < n; jc += kGemmNc) {
+    int nc = std::min(kGemmNc, n - jc);
+    for (int pc = 0; pc < k; pc += kGemmKc) {
+      int kc = std::min(kGemmKc, k - pc);
+      bool accumulate = pc > 0;
+      bool last = pc + kc == k;
+      PackPanels(A + jc * k + pc, k, nc, kc, nr, pack_a);
+      for (int ic = 0; ic < m; ic += kGemmMc) {
+        int mc = std::min(kGemmMc, m - ic);
+        if (packed_B == nullptr)
+          PackPanels(B + ic * k + pc, k, mc, kc, mr, pack_b);
+        for (int jr = 0; jr < nc; jr += nr) {
+          int w = std::min(nr, nc - jr);
+          const float* pa = pack_a + jr * kc;
+          for (int ir = 0; ir < mc; ir += mr) {
+            int h = std::min(mr, mc - ir);
+            const float* pb = packed_B == nullptr ? pack_b + ir * kc :
+              packed_B + (ic + ir) * k + pc * mr;
+            float* c = C + (ic + ir) * ldc + jc + jr;
+            if (h == mr && w == nr) {
+              kernel.run(kc, pb, pa, c, ldc, accumulate);
+            } else {
+              // partial tile at the border of C
+              kernel.run(kc, pb, pa, tile, nr, false);
+              for (int r = 0; r < h; ++r) {
+                for (int j = 0; j < w; ++j) {
+                  c[r * ldc + j] = (accumulate ? c[r * ldc + j] : 0) +
+                    tile[r * nr + j];
+                }
+              }
+            }
+            if (last && epilogue != nullptr)
+              ApplyEpilogue(*epilogue, ic + ir, c, h, w, ldc);
+          }
+        }
+      }
+    }
+  }
+  if (workspace == nullptr)
+    delete[] buffer;
+}
+
+// C(m, n) = B(m, k) * A(n, k)^T as inner products, for a few rows of B (e.g. a
+// fully connected layer on one image), where packing A would cost as much as
+// reading it.
+void DotProduct(const float* A, const float* B, float* C, const int n,
+    const int m, const int k) {
+  for (int j = 0; j < n; j += 4) {
+    const float* y = A + j * k;
+    for (int i = 0; i < m; ++i) {
+      const float* x = B + i * k;
+      float* c = C + i * n + j;
+      if (j + 4 <= n) {
+        if (g_use_avx2)
+          Dot4Avx2(x, y, k, c);
+        else
+          Dot4Sse(x, y, k, c);
+        continue;
+      }
+      for (int jj = 0; j + jj < n; ++jj) {
+        c[jj] = simd_dot(x, y + jj * k, k);
+      }
+    }
+  }
+}
+
+}  // namespace
+
+float simd_dot(const float* x, const float* y, const long& len) {
+  if (g_use_avx2)
+    return DotAvx2(x, y, len);
+  return DotSse(x, y, len);
+}
+
 void matrix_procuct(const float* A, const float* B, float* C, const int n,
-    const int m, const int k, bool ta, bool tb) {
+    const int m, const int k, bool ta, bool tb, float* workspace) {
 #ifdef _BLAS
   arma::fmat mA = ta ? arma::fmat(A, k, n).t() : arma::fmat(A, n, k);
   arma::fmat mB = tb ? arma::fmat(B, m, k).t() : arma::fmat(B, k, m);
@@ -70,14 +423,41 @@ void matrix_procuct(const float* A, const float* B, float* C, const int n,
   mC = mA * mB;
 #else
   CHECK_TRUE(ta && !tb);
-  const float* x = B;
-  for (int i = 0, idx = 0; i < m; ++i) {
-    const float* y = A;
-    for (int j = 0; j < n; ++j, ++idx) {
-      C[idx] = simd_dot(x, y, k);
-      y += k;
-    }
-    x += k;
-  }
+  const GemmKernel& kernel = g_use_avx2 ? g_avx_kernel : g_sse_kernel;
+  if (m < kernel.mr)
+    DotProduct(A, B, C, n, m, k);
+  else
+    PackedProduct(kernel, A, B, nullptr, C, n, m, k, n, workspace, nullptr);
 #endif
 }
+
+int product_workspace_size(const int n, const int m) {
+#ifdef _BLAS
+  return 0;
+#else
+  const GemmKernel& kernel = g_use_avx2 ? g_avx_kernel : g_sse_kernel;
+  return m < kernel.mr ? 0 : WorkspaceSize(kernel, n);
+#endif
+}
+
+int packed_matrix_size(const int m, const int k) {
+  const GemmKernel& kernel = g_use_avx2 ? g_avx_kernel : g_sse_kernel;
+  return (m + kernel.mr - 1) / kernel.mr * kernel.mr * k;
+}
+
+void pack_matrix(const float* B, const int m, const int k, float* packed) {
+  const GemmKernel& kernel = g_use_avx2 ? g_avx_kernel : g_sse_kernel;
+  PackPanels(B, k, m, k, kernel.mr, packed);
+}
+
+int packed_product_workspace_size(const int n) {
+  return WorkspaceSize(g_use_avx2 ? g_avx_kernel : g_sse_kernel, n);
+}
+
+void matrix_procuct_packed(const float* A, const float* packed_B, float* C,
+    const int n, const int m, const int k, const int ldc, float* workspace,
+    const ProductEpilogue* epilogue) {
+  const GemmKernel& kernel = g_use_avx2 ? g_avx_kernel : g_sse_kernel;
+  PackedProduct(kernel, A, nullptr, packed_B, C, n, m, k, ldc, workspace,
+    epilogue);
+}
@@ -48,6 +48,15 @@ void MaxPoolingNet::SetUp() {
   this->output_plugs().resize(1);
 }
 
+void MaxPoolingNet::InferShape() {
+  const Blob* const input = this->input_blobs(0);
+  int dst_h = static_cast<int>(ceil(static_cast<float>(
+    input->height() - kernel_h_) / stride_h_)) + 1;
+  int dst_w = static_cast<int>(ceil(static_cast<float>(
+    input->width() - kernel_w_) / stride_w_)) + 1;
+  this->output_blobs(0)->reshape(input->num(), input->channels(), dst_h, dst_w);
+}
+
 void MaxPoolingNet::Execute() {
   // *** Argument *** //
   const float MIN_THRESHOLD = 0.0f;
@@ -67,8 +76,8 @@ void MaxPoolingNet::Execute() {
   int dst_w = static_cast<int>(ceil(static_cast<float>(
     src_w - kernel_w_) / stride_w_)) + 1;
 
-  int dst_count = num * channels * dst_h * dst_w;
-  float* const dst_head = new float[dst_count];
+  output->SetData(num, channels, dst_h, dst_w);
+  float* const dst_head = output->data().get();
   const float* src_data = input->data().get();
   float* dst_data = dst_head;
   int src_channel_off = src_h * src_w;
@@ -102,8 +111,6 @@ void MaxPoolingNet::Execute() {
     } // for c
   } // for n
 
-  output->CopyData(num, channels, dst_h, dst_w, dst_head);
-  delete[] dst_head;
   CheckOutput();
 }
 
@@ -41,6 +41,8 @@ Net::Net() {
   output_plugs_.clear();
 
   father_ = nullptr;
+  workspace_ = nullptr;
+  workspace_size_ = 0;
 }
 
 Net::~Net() {
@@ -78,6 +80,20 @@ void Net::Execute() {
   CheckOutput();
 }
 
+void Net::InferShape() {
+  const Blob* const input = input_blobs(0);
+  output_blobs(0)->reshape(input->num(), input->channels(), input->height(),
+    input->width());
+}
+
+float* Net::Workspace(int size) {
+  if (size <= workspace_size_)
+    return workspace_;
+  if (own_workspace_.size() < size)
+    own_workspace_.resize(size);
+  return own_workspace_.data();
+}
+
 void Net::CheckInput() {
   for (int i = 0; i < input_blobs_.size(); ++ i) {
     if (input_blobs_[i].data() == nullptr) {
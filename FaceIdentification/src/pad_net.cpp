@@ -44,6 +44,12 @@ void PadNet::SetUp() {
   this->output_plugs().resize(1);
 }
 
+void PadNet::InferShape() {
+  const Blob* const input = this->input_blobs(0);
+  this->output_blobs(0)->reshape(input->num(), input->channels(),
+    input->height() + top_ + bottom_, input->width() + left_ + right_);
+}
+
 void PadNet::Execute() {
   CheckInput();
   const Blob* const input = this->input_blobs(0);
@@ -62,9 +68,9 @@ void PadNet::Execute() {
   int height = std::min(src_h, dst_h);
   int width = std::min(src_w, dst_w);
 
-  output->reshape(num, channels, dst_h, dst_w);
-
-  float* const data = new float[num * channels * dst_h * dst_w]();
+  output->SetData(num, channels, dst_h, dst_w);
+  float* const data = output->data().get();
+  memset(data, 0, sizeof(float) * output->count());
 
   for (int n = 0; n < num; ++ n) {
     int src_off = input->offset(n), dst_off = output->offset(n);
@@ -87,8 +93,6 @@ void PadNet::Execute() {
       }
     }
   }
-  output->CopyData(num, channels, dst_h, dst_w, data);
-  delete[] data;
   CheckOutput();
 }
 
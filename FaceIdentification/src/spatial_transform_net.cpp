@@ -51,15 +51,23 @@ void SpatialTransformNet::SetUp() {
   this->output_plugs().resize(1);
 }
 
+void SpatialTransformNet::InferShape() {
+  const Blob* const input = this->input_blobs(0);
+  const Blob* const theta = this->input_blobs(1);
+  this->output_blobs(0)->reshape(theta->num(), input->channels(), new_height_,
+    new_width_);
+}
+
 void SpatialTransformNet::Execute() {
   CheckInput();
   const Blob* const input = this->input_blobs(0);
   const Blob* const theta = this->input_blobs(1);
   Blob* const output = this->output_blobs(0);
 
-  CHECK_EQ(input->num(), theta->num());
+  // one transformation per input, or several of a single input
+  CHECK_TRUE(input->num() == theta->num() || input->num() == 1);
 
-  int num = input->num();
+  int num = theta->num();
   int channels = input->channels();
   
   int src_w = input->width();
@@ -86,6 +94,7 @@ void SpatialTransformNet::Execute() {
   float* output_data = output->data().get();
 
   for (int n = 0; n < num; ++ n) {
+    int src_n = input->num() == 1 ? 0 : n;
     double scale = sqrt(theta_data[0] * theta_data[0] 
         + theta_data[3] * theta_data[3]);
     for (int x = 0; x < dst_h; ++ x)
@@ -96,13 +105,13 @@ void SpatialTransformNet::Execute() {
         for (int c = 0; c < channels; ++ c) {
           if (!is_mat_data_) {
             output_data[output->offset(n, c, x, y)]
-              = Sampling(input_data + input->offset(n, c), src_h, src_w,
-              src_x, src_y, 1.0 / scale);
+              = Sampling(input_data + input->offset(src_n, c),
+              src_h, src_w, src_x, src_y, 1.0 / scale);
           }
           else {
             output_data[output->offset(n, c, x, y)]
               = Sampling(reinterpret_cast<unsigned char*>(
-                  input_data + input->offset(n)), c, src_h, src_w,
+                  input_data + input->offset(src_n)), c, src_h, src_w,
               this->output_blobs(0)->channels(), src_x, src_y, 1.0 / scale);
           }
         }
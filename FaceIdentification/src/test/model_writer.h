@@ -0,0 +1,247 @@
+/*
+ *
+ * This file is part of the open-source SeetaFace engine, which includes three modules:
+ * SeetaFace Detection, SeetaFace Alignment, and SeetaFace Identification.
+ *
+ * This file is part of the SeetaFace Identification module, containing codes implementing the
+ * face identification method described in the following paper:
+ *
+ *   
+ *   VIPLFaceNet: An Open Source Deep Face Recognition SDK,
+ *   Xin Liu, Meina Kan, Wanglong Wu, Shiguang Shan, Xilin Chen.
+ *   In Frontiers of Computer Science.
+ *
+ *
+ * Copyright (C) 2016, Visual Information Processing and Learning (VIPL) group,
+ * Institute of Computing Technology, Chinese Academy of Sciences, Beijing, China.
+ *
+ * The codes are mainly developed by Zining Xu(a M.S. supervised by Prof. Shiguang Shan)
+ *
+ * As an open-source face recognition engine: you can redistribute SeetaFace source codes
+ * and/or modify it under the terms of the BSD 2-Clause License.
+ *
+ * You should have received a copy of the BSD 2-Clause License along with the software.
+ * If not, see < https://opensource.org/licenses/BSD-2-Clause>.
+ *
+ * Contact Info: you can send an email to SeetaFace@vipl.ict.ac.cn for any problems. 
+ *
+ * Note: the above information must be kept whenever or wherever the codes are used.
+ *
+ */
+
+#ifndef MODEL_WRITER_H_
+#define MODEL_WRITER_H_
+
+#include "hyper_param.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// Writes nets in the format read by CommonNet::Load.
+class ModelWriter {
+ public:
+  explicit ModelWriter(FILE* file): file_(file) {}
+
+  void String(const std::string& str) {
+    Int(str.size());
+    fwrite(str.c_str(), sizeof(char), str.size(), file_);
+  }
+  void Int(int value) { fwrite(&value, sizeof(int), 1, file_); }
+
+  // a net of the type with the hyper params written by Param, up to End
+  void Begin(const std::string& type) { String(type); }
+  void Param(const std::string& name, int value) {
+    String(name);
+    Int(PARAM_INT);
+    Int(value);
+  }
+  void Param(const std::string& name, float value) {
+    String(name);
+    Int(PARAM_FLOAT);
+    fwrite(&value, sizeof(float), 1, file_);
+  }
+  void Param(const std::string& name, const std::string& value) {
+    String(name);
+    Int(PARAM_STRING);
+    String(value);
+  }
+  void End() { String("end"); }
+
+  // a param blob of random values in [low, high)
+  void Blob(int n, int c, int h, int w, float low, float high) {
+    Int(n);
+    Int(c);
+    Int(h);
+    Int(w);
+    for (int i = 0; i < n * c * h * w; ++i) {
+      float value = low + (high - low) * (rand() / (RAND_MAX + 1.0f));
+      fwrite(&value, sizeof(float), 1, file_);
+    }
+  }
+
+  // the source (net_idx, blob_idx) of a subnet input or of an output
+  void Link(int net_idx, int blob_idx) {
+    Int(net_idx);
+    Int(blob_idx);
+  }
+
+ private:
+  FILE* file_;
+};
+
+inline void WriteConv(ModelWriter* writer, int src_channels,
+    int dst_channels, int kernel_size, int stride) {
+  writer->Begin("Conv");
+  writer->Param("stride", stride);
+  writer->End();
+  float scale = 1.0f / sqrt(float(src_channels * kernel_size * kernel_size));
+  writer->Blob(dst_channels, src_channels, kernel_size, kernel_size, -scale,
+    scale);
+}
+
+inline void WriteBn(ModelWriter* writer, int channels) {
+  writer->Begin("Bn");
+  writer->Param("epsilon", 1e-5f);
+  writer->End();
+  // the mean and the variance, both scaled by the last blob
+  writer->Blob(1, channels, 1, 1, -0.5f, 0.5f);
+  writer->Blob(1, channels, 1, 1, 0.5f, 2.0f);
+  writer->Blob(1, 1, 1, 1, 1.0f, 2.0f);
+}
+
+inline void WriteBiasAdder(ModelWriter* writer, int channels) {
+  writer->Begin("BiasAdder");
+  writer->End();
+  writer->Blob(1, channels, 1, 1, -0.5f, 0.5f);
+}
+
+inline void WriteEltwise(ModelWriter* writer, const std::string& op,
+    float param1, float param2, int channels) {
+  writer->Begin("Eltwise");
+  writer->Param("eltwise_op", op);
+  if (op == "SCALE") {
+    writer->Param("scale", param1);
+  } else if (op == "CLOSE") {
+    writer->Param("lower", param1);
+    writer->Param("upper", param2);
+  }
+  writer->End();
+  if (op == "BAIS_ADDER")
+    writer->Blob(1, channels, 1, 1, -0.5f, 0.5f);
+}
+
+inline void WritePad(ModelWriter* writer, int pad) {
+  writer->Begin("Pad");
+  writer->Param("pad", pad);
+  writer->End();
+}
+
+// A common net of a chain of kChainNets nets shaped like the layers of
+// VIPLFaceNet, each one reading the output of the previous one:
+//   Pad Conv Bn SCALE BiasAdder CLOSE, Pad Conv BAIS_ADDER CLOSE, MaxPooling,
+//   Conv BiasAdder, InnerProduct Bn SCALE
+// for an input of 3x50x50 and an output of 64 features per image.
+static const int kChainNets = 16;
+
+inline void WriteChainModel(FILE* file) {
+  ModelWriter writer(file);
+  writer.Begin("Common");
+  writer.Param("num_subnet", kChainNets);
+  writer.Param("num_in", 1);
+  writer.Param("num_out", 1);
+  writer.End();
+
+  WritePad(&writer, 1);
+  WriteConv(&writer, 3, 16, 3, 1);
+  WriteBn(&writer, 16);
+  WriteEltwise(&writer, "SCALE", 0.5f, 0, 16);
+  WriteBiasAdder(&writer, 16);
+  WriteEltwise(&writer, "CLOSE", 0, 6.0f, 16);
+
+  WritePad(&writer, 1);
+  WriteConv(&writer, 16, 32, 3, 1);
+  WriteEltwise(&writer, "BAIS_ADDER", 0, 0, 32);
+  WriteEltwise(&writer, "CLOSE", -1.0f, 1.0f, 32);
+
+  writer.Begin("MaxPooling");
+  writer.Param("kernel_size", 3);
+  writer.Param("stride", 2);
+  writer.End();
+
+  WriteConv(&writer, 32, 24, 5, 2);
+  WriteBiasAdder(&writer, 24);
+
+  writer.Begin("InnerProduct");
+  writer.End();
+  writer.Blob(64, 24 * 11 * 11, 1, 1, -0.02f, 0.02f);
+  WriteBn(&writer, 64);
+  WriteEltwise(&writer, "SCALE", 2.0f, 0, 64);
+
+  for (int i = 0; i < kChainNets; ++i)
+    writer.Link(i - 1, 0);
+  writer.Link(kChainNets - 1, 0);
+}
+
+// Writes a net of the shape of VIPLFaceNet, with random weights, for an input
+// of 3x228x228: convolutions followed by a bias and a ReLU (a CLOSE from 0),
+// some of them padded or followed by max pooling, and two fully connected
+// layers.
+inline void WriteVIPLFaceNet(FILE* file) {
+  struct Layer {
+    int src_channels, dst_channels, kernel_size, stride, pad;
+    bool pool;
+  };
+  static const Layer kConvs[] = {
+    {3, 48, 9, 4, 0, true},
+    {48, 128, 3, 1, 1, false},
+    {128, 128, 3, 1, 1, true},
+    {128, 256, 3, 1, 1, false},
+    {256, 192, 3, 1, 1, false},
+    {192, 192, 3, 1, 1, false},
+    {192, 128, 3, 1, 1, true},
+  };
+  const int conv_num = sizeof(kConvs) / sizeof(kConvs[0]);
+  int net_num = 5;  // the fully connected layers
+  for (int i = 0; i < conv_num; ++i)
+    net_num += 3 + (kConvs[i].pad > 0) + kConvs[i].pool;
+
+  ModelWriter writer(file);
+  writer.Begin("Common");
+  writer.Param("num_subnet", net_num);
+  writer.Param("num_in", 1);
+  writer.Param("num_out", 1);
+  writer.End();
+  for (int i = 0; i < conv_num; ++i) {
+    const Layer& conv = kConvs[i];
+    if (conv.pad > 0)
+      WritePad(&writer, conv.pad);
+    WriteConv(&writer, conv.src_channels, conv.dst_channels, conv.kernel_size,
+      conv.stride);
+    WriteBiasAdder(&writer, conv.dst_channels);
+    WriteEltwise(&writer, "CLOSE", 0, FLT_MAX, conv.dst_channels);
+    if (conv.pool) {
+      writer.Begin("MaxPooling");
+      writer.Param("kernel_size", 3);
+      writer.Param("stride", 2);
+      writer.End();
+    }
+  }
+  writer.Begin("InnerProduct");
+  writer.End();
+  writer.Blob(4096, 128 * 6 * 6, 1, 1, -0.02f, 0.02f);
+  WriteBiasAdder(&writer, 4096);
+  WriteEltwise(&writer, "CLOSE", 0, FLT_MAX, 4096);
+  writer.Begin("InnerProduct");
+  writer.End();
+  writer.Blob(2048, 4096, 1, 1, -0.02f, 0.02f);
+  WriteBiasAdder(&writer, 2048);
+
+  for (int i = 0; i < net_num; ++i)
+    writer.Link(i - 1, 0);
+  writer.Link(net_num - 1, 0);
+}
+
+#endif  // MODEL_WRITER_H_
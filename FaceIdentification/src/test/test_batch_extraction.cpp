@@ -0,0 +1,179 @@
+/*
+ *
+ * This file is part of the open-source SeetaFace engine, which includes three modules:
+ * SeetaFace Detection, SeetaFace Alignment, and SeetaFace Identification.
+ *
+ * This file is part of the SeetaFace Identification module, containing codes implementing the
+ * face identification method described in the following paper:
+ *
+ *   
+ *   VIPLFaceNet: An Open Source Deep Face Recognition SDK,
+ *   Xin Liu, Meina Kan, Wanglong Wu, Shiguang Shan, Xilin Chen.
+ *   In Frontiers of Computer Science.
+ *
+ *
+ * Copyright (C) 2016, Visual Information Processing and Learning (VIPL) group,
+ * Institute of Computing Technology, Chinese Academy of Sciences, Beijing, China.
+ *
+ * The codes are mainly developed by Zining Xu(a M.S. supervised by Prof. Shiguang Shan)
+ *
+ * As an open-source face recognition engine: you can redistribute SeetaFace source codes
+ * and/or modify it under the terms of the BSD 2-Clause License.
+ *
+ * You should have received a copy of the BSD 2-Clause License along with the software.
+ * If not, see < https://opensource.org/licenses/BSD-2-Clause>.
+ *
+ * Contact Info: you can send an email to SeetaFace@vipl.ict.ac.cn for any problems. 
+ *
+ * Note: the above information must be kept whenever or wherever the codes are used.
+ *
+ */
+
+#include "face_identification.h"
+#include "model_writer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#define TEST(major, minor) major##_##minor##_Tester()
+
+using seeta::FaceIdentification;
+using seeta::FacialLandmark;
+using seeta::ImageData;
+
+static const char* kModelPath = "test_batch_extraction.bin";
+static const int kFaceNum = 20;
+
+// Writes an identification model of the shape of VIPLFaceNet, with random
+// weights, for crops of 3x228x228 and features of 2048 floats.
+static void WriteModel() {
+  srand(0);
+  FILE* file = fopen(kModelPath, "wb");
+  const int header[4] = {3, 228, 228, 2048};
+  fwrite(header, sizeof(int), 4, file);
+  WriteVIPLFaceNet(file);
+  fclose(file);
+}
+
+static void RandomImage(std::vector<uint8_t>* pixels) {
+  for (int i = 0; i < pixels->size(); ++i)
+    (*pixels)[i] = rand() % 256;
+}
+
+// The largest difference of the features relative to the largest feature.
+static float RelativeError(const std::vector<float>& feats,
+    const std::vector<float>& expected) {
+  float error = 0, norm = 0;
+  for (int i = 0; i < expected.size(); ++i) {
+    error = std::max(error, fabs(feats[i] - expected[i]));
+    norm = std::max(norm, fabs(expected[i]));
+  }
+  return error / norm;
+}
+
+void TEST(BatchExtractionTest, Crops) {
+  FaceIdentification recognizer(kModelPath);
+  const int feat_size = recognizer.feature_size();
+  const int crop_size = recognizer.crop_width() * recognizer.crop_height() *
+    recognizer.crop_channels();
+
+  std::vector<uint8_t> pixels(kFaceNum * crop_size);
+  RandomImage(&pixels);
+  std::vector<ImageData> crops(kFaceNum, ImageData(recognizer.crop_width(),
+    recognizer.crop_height(), recognizer.crop_channels()));
+  for (int i = 0; i < kFaceNum; ++i)
+    crops[i].data = &pixels[i * crop_size];
+
+  std::vector<float> expected(kFaceNum * feat_size);
+  for (int i = 0; i < kFaceNum; ++i)
+    recognizer.ExtractFeature(crops[i], &expected[i * feat_size]);
+  std::vector<float> feats(kFaceNum * feat_size);
+  recognizer.ExtractFeatures(crops, &feats[0]);
+  float error = RelativeError(feats, expected);
+  std::cout << kFaceNum << " crops: relative error "
+    << std::scientific << std::setprecision(2) << error << std::endl;
+
+  // the throughput for batches of each size
+  std::cout << "batch  faces/s" << std::endl;
+  double single_rate = 0, best_rate = 0;
+  for (int batch = 1; batch <= 16; batch *= 2) {
+    std::vector<ImageData> group(crops.begin(), crops.begin() + batch);
+    int faces = 0;
+    double elapsed = 0;
+    std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+    do {
+      recognizer.ExtractFeatures(group, &feats[0]);
+      faces += batch;
+      elapsed = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    } while (elapsed < 1.0);
+    double rate = faces / elapsed;
+    if (batch == 1)
+      single_rate = rate;
+    best_rate = std::max(best_rate, rate);
+    std::cout << std::setw(5) << batch << "  " << std::fixed
+      << std::setprecision(1) << std::setw(7) << rate << std::endl;
+  }
+  std::cout << "speedup " << std::setprecision(2) << best_rate / single_rate
+    << std::endl;
+
+  if (error < 1e-4)
+    std::cout << "Test successful!" << std::endl;
+  else
+    std::cout << "ERROR: the batched features differ." << std::endl;
+}
+
+void TEST(BatchExtractionTest, ImageWithCrop) {
+  FaceIdentification recognizer(kModelPath);
+  const int feat_size = recognizer.feature_size();
+
+  std::vector<uint8_t> pixels(640 * 480 * 3);
+  RandomImage(&pixels);
+  ImageData image(640, 480, 3);
+  image.data = &pixels[0];
+
+  // faces of different positions, sizes and rotations
+  static const double kStdPoints[10] = {
+    89.3, 72.9, 169.3, 72.9, 127.9, 127.0, 96.9, 184.9, 159.1, 184.8,
+  };
+  std::vector<FacialLandmark> points(kFaceNum * 5);
+  for (int i = 0; i < kFaceNum; ++i) {
+    double scale = 0.5 + 0.05 * i, angle = 0.03 * (i - kFaceNum / 2);
+    double x = 20 + 17 * i, y = 30 + 11 * i;
+    for (int j = 0; j < 5; ++j) {
+      double u = kStdPoints[j * 2] * scale, v = kStdPoints[j * 2 + 1] * scale;
+      points[i * 5 + j].x = x + u * cos(angle) - v * sin(angle);
+      points[i * 5 + j].y = y + u * sin(angle) + v * cos(angle);
+    }
+  }
+
+  std::vector<float> expected(kFaceNum * feat_size);
+  for (int i = 0; i < kFaceNum; ++i) {
+    recognizer.ExtractFeatureWithCrop(image, &points[i * 5],
+      &expected[i * feat_size]);
+  }
+  std::vector<float> feats(kFaceNum * feat_size);
+  recognizer.ExtractFeaturesWithCrop(image, points, &feats[0]);
+  float error = RelativeError(feats, expected);
+  std::cout << kFaceNum << " faces of an image: relative error "
+    << std::scientific << std::setprecision(2) << error << std::endl;
+  if (error < 1e-4)
+    std::cout << "Test successful!" << std::endl;
+  else
+    std::cout << "ERROR: the batched features differ." << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  WriteModel();
+  TEST(BatchExtractionTest, Crops);
+  TEST(BatchExtractionTest, ImageWithCrop);
+  remove(kModelPath);
+  return 0;
+}
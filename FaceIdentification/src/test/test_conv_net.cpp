@@ -0,0 +1,169 @@
+/*
+ *
+ * This file is part of the open-source SeetaFace engine, which includes three modules:
+ * SeetaFace Detection, SeetaFace Alignment, and SeetaFace Identification.
+ *
+ * This file is part of the SeetaFace Identification module, containing codes implementing the
+ * face identification method described in the following paper:
+ *
+ *   
+ *   VIPLFaceNet: An Open Source Deep Face Recognition SDK,
+ *   Xin Liu, Meina Kan, Wanglong Wu, Shiguang Shan, Xilin Chen.
+ *   In Frontiers of Computer Science.
+ *
+ *
+ * Copyright (C) 2016, Visual Information Processing and Learning (VIPL) group,
+ * Institute of Computing Technology, Chinese Academy of Sciences, Beijing, China.
+ *
+ * The codes are mainly developed by Zining Xu(a M.S. supervised by Prof. Shiguang Shan)
+ *
+ * As an open-source face recognition engine: you can redistribute SeetaFace source codes
+ * and/or modify it under the terms of the BSD 2-Clause License.
+ *
+ * You should have received a copy of the BSD 2-Clause License along with the software.
+ * If not, see < https://opensource.org/licenses/BSD-2-Clause>.
+ *
+ * Contact Info: you can send an email to SeetaFace@vipl.ict.ac.cn for any problems. 
+ *
+ * Note: the above information must be kept whenever or wherever the codes are used.
+ *
+ */
+
+#include "conv_net.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#define TEST(major, minor) major##_##minor##_Tester()
+
+// The 3x3 convolutions of VIPLFaceNet on one 228x228 face, with the input
+// padded by PadNet.
+struct LayerShape {
+  const char* name;
+  int src_channels;
+  int dst_channels;
+  int src_size;
+};
+
+static const LayerShape kLayers[] = {
+  {"conv2", 48, 128, 29},
+  {"conv3", 128, 128, 29},
+  {"conv4", 128, 256, 15},
+  {"conv5", 256, 192, 15},
+  {"conv6", 192, 192, 15},
+  {"conv7", 192, 128, 15},
+};
+
+// Largest absolute error of the Winograd convolutions allowed, for outputs of
+// a standard deviation of about 1/3.
+static const float kTolerance = 1e-4f;
+
+static const char* AlgorithmName(ConvNet::Algorithm algorithm) {
+  switch (algorithm) {
+    case ConvNet::IM2COL: return "im2col";
+    case ConvNet::WINOGRAD_2X2: return "F(2x2)";
+    case ConvNet::WINOGRAD_4X4: return "F(4x4)";
+    default: return "auto";
+  }
+}
+
+// Runs the convolution of the input by the algorithm until at least 0.2s have
+// passed, returning the time of one run in seconds and the output.
+static double TimeConv(ConvNet* conv, ConvNet::Algorithm algorithm,
+    const Blob& input, std::vector<float>* output) {
+  conv->SetAlgorithm(algorithm);
+  int runs = 0;
+  double elapsed = 0;
+  std::chrono::steady_clock::time_point start;
+  do {
+    if (runs == 1)
+      start = std::chrono::steady_clock::now();
+    Blob src(input);
+    conv->input_blobs(0)->SetData(src);
+    conv->Execute();
+    ++runs;
+    if (runs > 1) {
+      elapsed = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    }
+  } while (elapsed < 0.2);
+  Blob* dst = conv->output_blobs(0);
+  output->resize(dst->count());
+  dst->CopyTo(&(*output)[0]);
+  return elapsed / (runs - 1);
+}
+
+void TEST(ConvNetTest, Winograd) {
+  srand(0);
+  const ConvNet::Algorithm algorithms[] = {ConvNet::IM2COL,
+    ConvNet::WINOGRAD_2X2, ConvNet::WINOGRAD_4X4, ConvNet::AUTO};
+  std::cout << std::setw(8) << "layer";
+  for (int a = 0; a < 4; ++a)
+    std::cout << std::setw(12) << AlgorithmName(algorithms[a]);
+  std::cout << std::setw(10) << "chosen" << std::setw(12) << "F(2x2) err"
+    << std::setw(12) << "F(4x4) err" << std::endl;
+
+  bool success = true;
+  double total[4] = {0, 0, 0, 0};
+  for (int l = 0; l < sizeof(kLayers) / sizeof(kLayers[0]); ++l) {
+    const LayerShape& layer = kLayers[l];
+    ConvNet conv;
+    conv.hyper_param()->InsertInt("stride", 1);
+    conv.SetUp();
+    float scale = 1.0f / sqrt(9.0f * layer.src_channels);
+    std::vector<float> weight(layer.dst_channels * layer.src_channels * 9);
+    for (int i = 0; i < weight.size(); ++i)
+      weight[i] = (rand() / (float)RAND_MAX * 2 - 1) * scale;
+    conv.params(0)->CopyData(layer.dst_channels, layer.src_channels, 3, 3,
+      &weight[0]);
+    conv.Prepare();
+
+    std::vector<float> data(layer.src_channels * layer.src_size *
+      layer.src_size);
+    for (int i = 0; i < data.size(); ++i)
+      data[i] = rand() / (float)RAND_MAX;
+    Blob input(1, layer.src_channels, layer.src_size, layer.src_size,
+      &data[0]);
+
+    std::vector<float> outputs[4];
+    std::cout << std::setw(8) << layer.name << std::fixed
+      << std::setprecision(2);
+    for (int a = 0; a < 4; ++a) {
+      double time = TimeConv(&conv, algorithms[a], input, &outputs[a]);
+      total[a] += time;
+      std::cout << std::setw(10) << time * 1000 << "ms";
+    }
+    int dst_size = layer.src_size - 2;
+    std::cout << std::setw(10)
+      << AlgorithmName(conv.SelectAlgorithm(dst_size, dst_size));
+    for (int a = 1; a <= 2; ++a) {
+      float error = 0;
+      for (int i = 0; i < outputs[0].size(); ++i)
+        error = std::max(error, fabs(outputs[a][i] - outputs[0][i]));
+      if (error > kTolerance)
+        success = false;
+      std::cout << std::scientific << std::setprecision(1) << std::setw(12)
+        << error;
+    }
+    std::cout << std::endl;
+  }
+  std::cout << std::setw(8) << "total" << std::fixed << std::setprecision(2);
+  for (int a = 0; a < 4; ++a)
+    std::cout << std::setw(10) << total[a] * 1000 << "ms";
+  std::cout << std::endl;
+  if (success)
+    std::cout << "Test successful!" << std::endl;
+  else
+    std::cout << "ERROR: the Winograd convolutions exceed the tolerance."
+      << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  TEST(ConvNetTest, Winograd);
+  return 0;
+}
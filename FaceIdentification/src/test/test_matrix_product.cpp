@@ -0,0 +1,171 @@
+/*
+ *
+ * This file is part of the open-source SeetaFace engine, which includes three modules:
+ * SeetaFace Detection, SeetaFace Alignment, and SeetaFace Identification.
+ *
+ * This file is part of the SeetaFace Identification module, containing codes implementing the
+ * face identification method described in the following paper:
+ *
+ *   
+ *   VIPLFaceNet: An Open Source Deep Face Recognition SDK,
+ *   Xin Liu, Meina Kan, Wanglong Wu, Shiguang Shan, Xilin Chen.
+ *   In Frontiers of Computer Science.
+ *
+ *
+ * Copyright (C) 2016, Visual Information Processing and Learning (VIPL) group,
+ * Institute of Computing Technology, Chinese Academy of Sciences, Beijing, China.
+ *
+ * The codes are mainly developed by Zining Xu(a M.S. supervised by Prof. Shiguang Shan)
+ *
+ * As an open-source face recognition engine: you can redistribute SeetaFace source codes
+ * and/or modify it under the terms of the BSD 2-Clause License.
+ *
+ * You should have received a copy of the BSD 2-Clause License along with the software.
+ * If not, see < https://opensource.org/licenses/BSD-2-Clause>.
+ *
+ * Contact Info: you can send an email to SeetaFace@vipl.ict.ac.cn for any problems. 
+ *
+ * Note: the above information must be kept whenever or wherever the codes are used.
+ *
+ */
+
+#include "math_functions.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include <xmmintrin.h>
+
+#define TEST(major, minor) major##_##minor##_Tester()
+
+// The products of the layers of VIPLFaceNet on one 228x228 face, i.e. the
+// convolutions as computed by ConvNet (m = kernels, n = pixels, k = kernel
+// size) and the fully connected layers as by InnerProductNet (m = 1).
+struct LayerShape {
+  const char* name;
+  int m;
+  int n;
+  int k;
+};
+
+static const LayerShape kLayers[] = {
+  {"conv1", 48, 55 * 55, 3 * 9 * 9},
+  {"conv2", 128, 27 * 27, 48 * 3 * 3},
+  {"conv3", 128, 27 * 27, 128 * 3 * 3},
+  {"conv4", 256, 13 * 13, 128 * 3 * 3},
+  {"conv5", 192, 13 * 13, 256 * 3 * 3},
+  {"conv6", 192, 13 * 13, 192 * 3 * 3},
+  {"conv7", 128, 13 * 13, 192 * 3 * 3},
+  {"fc1", 1, 4096, 128 * 6 * 6},
+  {"fc2", 1, 2048, 4096},
+};
+
+// The inner product and the matrix product as computed before the packed
+// kernels, i.e. one SSE inner product per element of C.
+static float ReferenceDot(const float* x, const float* y, const long len) {
+  float temp[4];
+  __m128 acc = _mm_setzero_ps();
+  long i;
+  for (i = 0; i + 4 < len; i += 4) {
+    acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(y + i)));
+  }
+  _mm_storeu_ps(&temp[0], acc);
+  float inner_prod = temp[0] + temp[1] + temp[2] + temp[3];
+  for (; i < len; ++i) {
+    inner_prod += x[i] * y[i];
+  }
+  return inner_prod;
+}
+
+static void ReferenceProduct(const float* A, const float* B, float* C,
+    const int n, const int m, const int k) {
+  const float* x = B;
+  for (int i = 0, idx = 0; i < m; ++i) {
+    const float* y = A;
+    for (int j = 0; j < n; ++j, ++idx) {
+      C[idx] = ReferenceDot(x, y, k);
+      y += k;
+    }
+    x += k;
+  }
+}
+
+// Runs the product until at least 0.2s have passed, returning the time of one
+// run in seconds.
+template <typename Product>
+static double TimeProduct(Product product) {
+  product();
+  int runs = 0;
+  std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now();
+  double elapsed = 0;
+  do {
+    product();
+    ++runs;
+    elapsed = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  } while (elapsed < 0.2);
+  return elapsed / runs;
+}
+
+void TEST(MathFunctionsTest, MatrixProduct) {
+  srand(0);
+  std::cout << std::setw(8) << "layer" << std::setw(6) << "m"
+    << std::setw(7) << "n" << std::setw(7) << "k"
+    << std::setw(12) << "ref GF/s" << std::setw(12) << "new GF/s"
+    << std::setw(12) << "max error" << std::endl;
+  double ref_total = 0, new_total = 0;
+  bool success = true;
+  for (int l = 0; l < sizeof(kLayers) / sizeof(kLayers[0]); ++l) {
+    const LayerShape& layer = kLayers[l];
+    std::vector<float> A(layer.n * layer.k), B(layer.m * layer.k);
+    std::vector<float> C_ref(layer.m * layer.n), C_new(layer.m * layer.n);
+    for (int i = 0; i < A.size(); ++i)
+      A[i] = rand() / (float)RAND_MAX - 0.5f;
+    for (int i = 0; i < B.size(); ++i)
+      B[i] = rand() / (float)RAND_MAX - 0.5f;
+
+    double ref_time = TimeProduct([&]() {
+      ReferenceProduct(&A[0], &B[0], &C_ref[0], layer.n, layer.m, layer.k);
+    });
+    double new_time = TimeProduct([&]() {
+      matrix_procuct(&A[0], &B[0], &C_new[0], layer.n, layer.m, layer.k,
+        true, false);
+    });
+    ref_total += ref_time;
+    new_total += new_time;
+
+    // relative to the largest possible magnitude of an element, 0.25 * k
+    double error = 0;
+    for (int i = 0; i < C_ref.size(); ++i)
+      error = std::max(error, (double)fabs(C_ref[i] - C_new[i]));
+    error /= 0.25 * layer.k;
+    if (error > 1e-5)
+      success = false;
+
+    double flops = 2.0 * layer.m * layer.n * layer.k;
+    std::cout << std::setw(8) << layer.name << std::setw(6) << layer.m
+      << std::setw(7) << layer.n << std::setw(7) << layer.k
+      << std::fixed << std::setprecision(2)
+      << std::setw(12) << flops / ref_time * 1e-9
+      << std::setw(12) << flops / new_time * 1e-9
+      << std::scientific << std::setprecision(1)
+      << std::setw(12) << error << std::endl;
+  }
+  std::cout << std::fixed << std::setprecision(2)
+    << "Total time of the products: " << ref_total * 1000 << "ms before, "
+    << new_total * 1000 << "ms now." << std::endl;
+  if (success)
+    std::cout << "Test successful!" << std::endl;
+  else
+    std::cout << "ERROR: the products differ from the reference." << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  TEST(MathFunctionsTest, MatrixProduct);
+  return 0;
+}
@@ -0,0 +1,168 @@
+/*
+ *
+ * This file is part of the open-source SeetaFace engine, which includes three modules:
+ * SeetaFace Detection, SeetaFace Alignment, and SeetaFace Identification.
+ *
+ * This file is part of the SeetaFace Identification module, containing codes implementing the
+ * face identification method described in the following paper:
+ *
+ *   
+ *   VIPLFaceNet: An Open Source Deep Face Recognition SDK,
+ *   Xin Liu, Meina Kan, Wanglong Wu, Shiguang Shan, Xilin Chen.
+ *   In Frontiers of Computer Science.
+ *
+ *
+ * Copyright (C) 2016, Visual Information Processing and Learning (VIPL) group,
+ * Institute of Computing Technology, Chinese Academy of Sciences, Beijing, China.
+ *
+ * The codes are mainly developed by Zining Xu(a M.S. supervised by Prof. Shiguang Shan)
+ *
+ * As an open-source face recognition engine: you can redistribute SeetaFace source codes
+ * and/or modify it under the terms of the BSD 2-Clause License.
+ *
+ * You should have received a copy of the BSD 2-Clause License along with the software.
+ * If not, see < https://opensource.org/licenses/BSD-2-Clause>.
+ *
+ * Contact Info: you can send an email to SeetaFace@vipl.ict.ac.cn for any problems. 
+ *
+ * Note: the above information must be kept whenever or wherever the codes are used.
+ *
+ */
+
+#include "common_net.h"
+#include "model_writer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#define TEST(major, minor) major##_##minor##_Tester()
+
+// Loads the chain of test nets inside a common net, fused or not.
+static std::shared_ptr<Net> LoadModel(bool fuse) {
+  srand(0);
+  FILE* file = tmpfile();
+  ModelWriter writer(file);
+  writer.Begin("Common");
+  writer.Param("num_subnet", 1);
+  writer.Param("num_in", 1);
+  writer.Param("num_out", 1);
+  writer.End();
+  WriteChainModel(file);
+  writer.Link(-1, 0);
+  writer.Link(0, 0);
+  rewind(file);
+  std::shared_ptr<Net> net = CommonNet::Load(file, fuse);
+  fclose(file);
+  return net;
+}
+
+// Executes the net on the input, returning the output and the number of
+// allocations of blobs.
+static int Execute(Net* net, const Blob& input, std::vector<float>* output) {
+  Blob src(input);
+  int num_allocations = Blob::num_allocations();
+  net->input_blobs(0)->SetData(src);
+  net->Execute();
+  Blob* dst = net->output_blobs(0);
+  output->resize(dst->count());
+  dst->CopyTo(&(*output)[0]);
+  net->Release();
+  return Blob::num_allocations() - num_allocations;
+}
+
+void TEST(MemoryPlanTest, Chain) {
+  std::vector<float> data(2 * 3 * 50 * 50);
+  for (int i = 0; i < data.size(); ++i)
+    data[i] = rand() / (float)RAND_MAX;
+  Blob input(2, 3, 50, 50, &data[0]);
+
+  bool success = true;
+  for (int fuse = 0; fuse < 2; ++fuse) {
+    std::shared_ptr<Net> net = LoadModel(fuse != 0);
+    std::vector<float> expected;
+    int unplanned_new = Execute(net.get(), input, &expected);
+    // large enough already, so that any allocation is made by the nets
+    std::vector<float> output(expected.size());
+
+    net->input_blobs(0)->reshape(2, 3, 50, 50);
+    size_t total_size = 0;
+    size_t arena_size = CommonNet::Plan(net.get(), &total_size);
+    int planned_new = Execute(net.get(), input, &output);
+    int again_new = Execute(net.get(), input, &output);
+
+    float error = 0;
+    for (int i = 0; i < expected.size(); ++i)
+      error = std::max(error, fabs(output[i] - expected[i]));
+    std::cout << (fuse ? "fused:   " : "unfused: ")
+      << std::fixed << std::setprecision(1) << "arena "
+      << arena_size / 1024.0 << " KB of " << total_size / 1024.0
+      << " KB of blocks, allocations per execution " << unplanned_new
+      << " -> " << planned_new << ", " << again_new << ", max error "
+      << error << std::endl;
+    if (output.size() != expected.size() || error != 0 ||
+        planned_new != 0 || again_new != 0 || arena_size >= total_size)
+      success = false;
+  }
+  if (success)
+    std::cout << "Test successful!" << std::endl;
+  else
+    std::cout << "ERROR: the planned execution allocates memory or differs."
+      << std::endl;
+}
+
+void TEST(MemoryPlanTest, VIPLFaceNet) {
+  srand(0);
+  FILE* file = tmpfile();
+  WriteVIPLFaceNet(file);
+  std::vector<char> model(ftell(file));
+  rewind(file);
+  fread(&model[0], sizeof(char), model.size(), file);
+  fclose(file);
+
+  std::vector<float> data(3 * 228 * 228);
+  for (int i = 0; i < data.size(); ++i)
+    data[i] = rand() / (float)RAND_MAX * 255;
+  Blob input(1, 3, 228, 228, &data[0]);
+
+  bool success = true;
+  for (int fuse = 0; fuse < 2; ++fuse) {
+    file = tmpfile();
+    fwrite(&model[0], sizeof(char), model.size(), file);
+    rewind(file);
+    std::shared_ptr<Net> net = CommonNet::Load(file, fuse != 0);
+    fclose(file);
+
+    std::vector<float> expected;
+    int unplanned_new = Execute(net.get(), input, &expected);
+    std::vector<float> output(expected.size());
+    net->input_blobs(0)->reshape(1, 3, 228, 228);
+    size_t total_size = 0;
+    size_t arena_size = CommonNet::Plan(net.get(), &total_size);
+    int planned_new = Execute(net.get(), input, &output);
+    bool same = output == expected;
+    std::cout << (fuse ? "fused:   " : "unfused: ") << net->nets().size()
+      << " nets, arena " << std::fixed << std::setprecision(2)
+      << arena_size / 1048576.0 << " MB of " << total_size / 1048576.0
+      << " MB of blocks, allocations per execution " << unplanned_new
+      << " -> " << planned_new << (same ? "" : ", outputs differ")
+      << std::endl;
+    if (!same || planned_new != 0)
+      success = false;
+  }
+  if (success)
+    std::cout << "Test successful!" << std::endl;
+  else
+    std::cout << "ERROR: the planned execution allocates memory or differs."
+      << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  TEST(MemoryPlanTest, Chain);
+  TEST(MemoryPlanTest, VIPLFaceNet);
+  return 0;
+}
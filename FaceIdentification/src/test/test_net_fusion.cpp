@@ -0,0 +1,135 @@
+/*
+ *
+ * This file is part of the open-source SeetaFace engine, which includes three modules:
+ * SeetaFace Detection, SeetaFace Alignment, and SeetaFace Identification.
+ *
+ * This file is part of the SeetaFace Identification module, containing codes implementing the
+ * face identification method described in the following paper:
+ *
+ *   
+ *   VIPLFaceNet: An Open Source Deep Face Recognition SDK,
+ *   Xin Liu, Meina Kan, Wanglong Wu, Shiguang Shan, Xilin Chen.
+ *   In Frontiers of Computer Science.
+ *
+ *
+ * Copyright (C) 2016, Visual Information Processing and Learning (VIPL) group,
+ * Institute of Computing Technology, Chinese Academy of Sciences, Beijing, China.
+ *
+ * The codes are mainly developed by Zining Xu(a M.S. supervised by Prof. Shiguang Shan)
+ *
+ * As an open-source face recognition engine: you can redistribute SeetaFace source codes
+ * and/or modify it under the terms of the BSD 2-Clause License.
+ *
+ * You should have received a copy of the BSD 2-Clause License along with the software.
+ * If not, see < https://opensource.org/licenses/BSD-2-Clause>.
+ *
+ * Contact Info: you can send an email to SeetaFace@vipl.ict.ac.cn for any problems. 
+ *
+ * Note: the above information must be kept whenever or wherever the codes are used.
+ *
+ */
+
+#include "common_net.h"
+#include "model_writer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#define TEST(major, minor) major##_##minor##_Tester()
+
+// Largest absolute error of the fused nets allowed, for outputs of about 1.
+static const float kTolerance = 1e-4f;
+
+// The number of nets of the chain once fused.
+static const int kFusedNets = 5;
+
+// Loads the model, with or without fusion.
+static std::shared_ptr<Net> LoadModel(const std::vector<char>& model,
+    bool fuse) {
+  FILE* file = tmpfile();
+  fwrite(&model[0], sizeof(char), model.size(), file);
+  rewind(file);
+  std::shared_ptr<Net> net = CommonNet::Load(file, fuse);
+  fclose(file);
+  return net;
+}
+
+// Runs the net on the input until at least 0.2s have passed, returning the
+// time of one run in seconds and the output.
+static double TimeNet(Net* net, const Blob& input, std::vector<float>* output) {
+  int runs = 0;
+  double elapsed = 0;
+  std::chrono::steady_clock::time_point start;
+  do {
+    if (runs == 1)
+      start = std::chrono::steady_clock::now();
+    Blob src(input);
+    net->input_blobs(0)->SetData(src);
+    net->Execute();
+    ++runs;
+    if (runs > 1) {
+      elapsed = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    }
+    if (runs < 2 || elapsed < 0.2)
+      net->Release();
+  } while (runs < 2 || elapsed < 0.2);
+  Blob* dst = net->output_blobs(0);
+  output->resize(dst->count());
+  dst->CopyTo(&(*output)[0]);
+  net->Release();
+  return elapsed / (runs - 1);
+}
+
+void TEST(NetFusionTest, Chain) {
+  srand(0);
+  FILE* file = tmpfile();
+  WriteChainModel(file);
+  std::vector<char> model(ftell(file));
+  rewind(file);
+  fread(&model[0], sizeof(char), model.size(), file);
+  fclose(file);
+
+  std::shared_ptr<Net> plain = LoadModel(model, false);
+  std::shared_ptr<Net> fused = LoadModel(model, true);
+
+  // two images of 3x50x50, padded to 52x52 by the first Pad
+  std::vector<float> data(2 * 3 * 50 * 50);
+  for (int i = 0; i < data.size(); ++i)
+    data[i] = rand() / (float)RAND_MAX;
+  Blob input(2, 3, 50, 50, &data[0]);
+
+  std::vector<float> plain_output, fused_output;
+  double plain_time = TimeNet(plain.get(), input, &plain_output);
+  double fused_time = TimeNet(fused.get(), input, &fused_output);
+  float error = 0;
+  for (int i = 0; i < plain_output.size(); ++i)
+    error = std::max(error, fabs(fused_output[i] - plain_output[i]));
+
+  std::cout << std::fixed << std::setprecision(2)
+    << "unfused: " << plain->nets().size() << " nets, "
+    << plain_time * 1000 << "ms" << std::endl
+    << "fused:   " << fused->nets().size() << " nets, "
+    << fused_time * 1000 << "ms" << std::endl
+    << "max error: " << std::scientific << std::setprecision(1) << error
+    << std::endl;
+  if (plain->nets().size() == kChainNets && fused->nets().size() == kFusedNets
+      && plain_output.size() == 2 * 64 && fused_output.size() == 2 * 64
+      && error <= kTolerance)
+    std::cout << "Test successful!" << std::endl;
+  else
+    std::cout << "ERROR: the fused nets differ from the unfused ones."
+      << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  TEST(NetFusionTest, Chain);
+  return 0;
+}
@@ -41,6 +41,12 @@ void TransformationMakerNet::SetUp() {
   this->params().resize(1);
 }
 
+void TransformationMakerNet::InferShape() {
+  const int TFORM_SIZE = 6;
+  this->output_blobs(0)->reshape(this->input_blobs(0)->num(), TFORM_SIZE, 1,
+    1);
+}
+
 void TransformationMakerNet::Execute() {
   const float EPS = 1e-4;
   const int TFORM_SIZE = 6;
@@ -51,7 +57,8 @@ void TransformationMakerNet::Execute() {
   Blob* const param = this->params(0);
   const float* feat_points = input->data().get();
   const float* std_points = param->data().get();
-  float* out_data = new float[input->num() * TFORM_SIZE];
+  this->output_blobs(0)->SetData(input->num(), TFORM_SIZE, 1, 1);
+  float* out_data = this->output_blobs(0)->data().get();
 
   for (int n = 0; n < input->num(); ++ n) {
     double sum_x = 0, sum_y = 0;
@@ -98,8 +105,6 @@ void TransformationMakerNet::Execute() {
     tform[2] = c;
     tform[5] = d;
   }
-  this->output_blobs(0)->CopyData(input->num(), TFORM_SIZE, 1, 1, out_data);
-  delete[] out_data;
   CheckOutput();
 }
 
@@ -137,6 +137,14 @@ Aligner::~Aligner() {}
 void Aligner::Alignment(const ImageData &src_img,
     const float* const points,
     Blob* const dst_blob) {
+  Alignment(src_img, points, 1, dst_blob);
+}
+
+void Aligner::Alignment(const ImageData &src_img,
+    const float* const points,
+    int num,
+    Blob* const dst_blob) {
+  // the image is shared by the faces, one transformation each
   Blob* const input_data = net_->input_blobs(1);
   input_data->reshape(1, src_img.num_channels, src_img.height, src_img.width);
   input_data->SetData();
@@ -147,7 +155,7 @@ void Aligner::Alignment(const ImageData &src_img,
   input_data->Permute(1, 4, 2, 3);*/
   Blob* const input_point = net_->input_blobs(0);
   
-  input_point->CopyData(1, 5, 2, 1, points);
+  input_point->CopyData(num, 5, 2, 1, points);
 
   net_->Execute();
   dst_blob->SetData(*(net_->output_blobs(0)));
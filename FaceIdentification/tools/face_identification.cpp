@@ -112,6 +112,45 @@ uint8_t FaceIdentification::ExtractFeatureWithCrop(const ImageData &src_image,
   return 1;
 }
 
+uint8_t FaceIdentification::ExtractFeatures(
+    const std::vector<ImageData> &crops,
+    FaceFeatures const feats) {
+  if (feats == NULL) {
+    std::cout << "Face Recognizer: 'feats' must be initialized with size \
+           of crops.size() * GetFeatureSize(). " << std::endl;
+    return 0;
+  }
+  if (crops.empty())
+    return 1;
+  recognizer->ExtractFeatures(&crops[0], feats, crops.size());
+  return 1;
+}
+
+uint8_t FaceIdentification::ExtractFeaturesWithCrop(
+    const ImageData &src_image,
+    const std::vector<FacialLandmark> &llpoints,
+    FaceFeatures const feats) {
+  if (llpoints.size() % 5 != 0) {
+    std::cout << "Face Recognizer: 5 landmark points per face." << std::endl;
+    return 0;
+  }
+  if (feats == NULL) {
+    std::cout << "Face Recognizer: 'feats' must be initialized with size \
+           of llpoints.size() / 5 * GetFeatureSize(). " << std::endl;
+    return 0;
+  }
+  std::vector<float> point_data(llpoints.size() * 2);
+  for (int i = 0; i < llpoints.size(); ++i) {
+    point_data[i * 2] = llpoints[i].x;
+    point_data[i * 2 + 1] = llpoints[i].y;
+  }
+  if (!point_data.empty()) {
+    recognizer->ExtractFeatureWithCrop(src_image, &point_data[0], feats,
+      llpoints.size() / 5);
+  }
+  return 1;
+}
+
 float FaceIdentification::CalcSimilarity(FaceFeatures const fc1,
     FaceFeatures const fc2,
     long dim) {